@@ -0,0 +1,288 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "SerialController.h"
+
+#if ! JUCE_WINDOWS
+ #include <unistd.h>
+ #if JUCE_MAC
+  #include <util.h>
+ #else
+  #include <pty.h>
+ #endif
+#endif
+
+/*
+    The parser is fed byte streams directly. SerialController is pointed at the slave
+    side of a pseudo-terminal from openpty(), with the test writing to the master side
+    the way the board's sketch would, so the port handling, the queues and the MIDI it
+    adds to a block are all exercised without a board plugged in.
+*/
+
+//==============================================================================
+static Array<ControllerEvent> parse (ControllerParser& parser, const char* text)
+{
+    Array<ControllerEvent> events;
+    parser.feed (text, (int) strlen (text), 0, [&] (const ControllerEvent& e) { events.add (e); });
+    return events;
+}
+
+class ControllerParserTests  : public UnitTest
+{
+public:
+    ControllerParserTests()  : UnitTest ("ControllerParser") {}
+
+    void runTest() override
+    {
+        beginTest ("Complete messages");
+        {
+            ControllerParser parser;
+            auto events = parse (parser, "A1]\r\nX123]\r\nF0]\n");
+
+            expectEquals (events.size(), 3);
+            expect (events[0].control == 'A' && events[0].value == 1);
+            expect (events[1].control == 'X' && events[1].value == 123);
+            expect (events[2].control == 'F' && events[2].value == 0);
+        }
+
+        beginTest ("Messages split across reads");
+        {
+            ControllerParser parser;
+            expectEquals (parse (parser, "X1").size(), 0);
+            expectEquals (parse (parser, "2").size(), 0);
+
+            auto events = parse (parser, "7]\r\n");
+            expectEquals (events.size(), 1);
+            expectEquals (events[0].value, 127);
+        }
+
+        beginTest ("Noise is dropped up to the next letter");
+        {
+            ControllerParser parser;
+            auto events = parse (parser, "3]?x9]B7]");
+
+            expectEquals (events.size(), 1);
+            expect (events[0].control == 'B' && events[0].value == 7);
+
+            expectEquals (parse (parser, "C]").size(), 0);
+            expectEquals (parse (parser, "D123456]").size(), 0);
+            expectEquals (parse (parser, "E2]").size(), 1);
+        }
+
+        beginTest ("Reset drops a partial message");
+        {
+            ControllerParser parser;
+            parse (parser, "F1");
+            parser.reset();
+            expectEquals (parse (parser, "]").size(), 0);
+        }
+
+        beginTest ("Events");
+        {
+            ControllerEvent e;
+            e.control = 'B';
+            expect (e.isPress());
+            expectEquals (e.getButtonIndex(), 1);
+
+            e.control = 'A';
+            expect (! e.isPress());
+
+            auto encoder = ControllerEvent::fromControllerIndex (6, 40);
+            expect (encoder.isEncoder() && encoder.value == 40);
+            expectEquals (encoder.getControllerIndex(), 6);
+            expectEquals (ControllerEvent::fromControllerIndex (3, 1).getButtonIndex(), 3);
+        }
+
+        beginTest ("MIDI conversion");
+        {
+            ControllerMidiConverter converter;
+            converter.setMidiChannel (5);
+            MidiMessage m;
+
+            expect (converter.createMessage (ControllerEvent::fromControllerIndex (2, 1), m));
+            expect (m.isController() && m.getChannel() == 5);
+            expectEquals (m.getControllerNumber(), ControllerMidiConverter::firstButtonController + 2);
+            expectEquals (m.getControllerValue(), 127);
+
+            expect (! converter.createMessage (ControllerEvent::fromControllerIndex (6, 250), m));
+
+            // the board's count wraps at a byte, so 250 to 3 is nine steps up
+            expect (converter.createMessage (ControllerEvent::fromControllerIndex (6, 3), m));
+            expectEquals (m.getControllerNumber(), (int) ControllerMidiConverter::encoderController);
+            expectEquals (m.getControllerValue(), 73);
+
+            converter.resetEncoder();
+            expect (! converter.createMessage (ControllerEvent::fromControllerIndex (6, 0), m));
+        }
+    }
+};
+
+static ControllerParserTests controllerParserTests;
+
+//==============================================================================
+class SerialControllerTests  : public UnitTest
+{
+public:
+    SerialControllerTests()  : UnitTest ("SerialController") {}
+
+    void runTest() override
+    {
+       #if ! JUCE_WINDOWS
+        int master = -1, slave = -1;
+        char slaveName[256] = {};
+
+        beginTest ("Opening a pseudo-terminal");
+        expect (openpty (&master, &slave, slaveName, nullptr, nullptr) == 0);
+
+        if (master < 0)
+            return;
+
+        Array<ControllerEvent> received;
+        SerialController controller;
+        controller.setMidiChannel (3);
+        controller.onEvent = [&] (const ControllerEvent& e) { received.add (e); };
+
+        beginTest ("Connecting");
+        expect (controller.start (slaveName).wasOk());
+        expect (waitFor ([&] { return controller.isConnected(); }));
+
+        // once the controller has its own descriptor, closing the master side is an unplugged board
+        ::close (slave);
+
+        beginTest ("The board's messages become controller messages");
+        {
+            writeToBoard (master, "A1]\r\nX10]\r\nX12]\r\nA0]\r\n");
+
+            // the encoder's first position only sets where the next movement is counted from
+            auto messages = collectMessages (controller, 3);
+            expectEquals (messages.size(), 3);
+
+            if (messages.size() == 3)
+            {
+                expectController (messages[0], 3, ControllerMidiConverter::firstButtonController, 127);
+                expectController (messages[1], 3, ControllerMidiConverter::encoderController, 66);
+                expectController (messages[2], 3, ControllerMidiConverter::firstButtonController, 0);
+            }
+        }
+
+       #if JUCE_MODAL_LOOPS_PERMITTED
+        beginTest ("The message thread gets every event in order");
+        {
+            auto deadline = Time::getMillisecondCounter() + 2000;
+
+            while (received.size() < 4 && Time::getMillisecondCounter() < deadline)
+                MessageManager::getInstance()->runDispatchLoopUntil (10);
+
+            expectEquals (received.size(), 4);
+            expect (received[1].isEncoder() && received[2].value == 12);
+        }
+       #endif
+
+        beginTest ("Injected events reach the graph, but not onEvent");
+        {
+            auto numReceived = received.size();
+            controller.injectEvent (ControllerEvent::fromControllerIndex (1, 1));
+
+            auto messages = collectMessages (controller, 1);
+            expectEquals (messages.size(), 1);
+
+            if (messages.size() == 1)
+                expectController (messages[0], 3, ControllerMidiConverter::firstButtonController + 1, 127);
+
+           #if JUCE_MODAL_LOOPS_PERMITTED
+            MessageManager::getInstance()->runDispatchLoopUntil (50);
+           #endif
+            expectEquals (received.size(), numReceived);
+        }
+
+        beginTest ("Unplugging the board");
+        {
+            ::close (master);
+            expect (waitFor ([&] { return ! controller.isConnected(); }));
+        }
+
+        controller.stop();
+       #endif
+    }
+
+private:
+    template <typename Condition>
+    static bool waitFor (Condition&& condition)
+    {
+        for (int i = 0; i < 200; ++i)
+        {
+            if (condition())
+                return true;
+
+            Thread::sleep (10);
+        }
+
+        return false;
+    }
+
+   #if ! JUCE_WINDOWS
+    void writeToBoard (int master, const char* text)
+    {
+        auto numBytes = (ssize_t) strlen (text);
+        expect (::write (master, text, (size_t) numBytes) == numBytes);
+    }
+   #endif
+
+    /** Plays blocks the way the graph would until enough messages have come out, or two seconds pass. */
+    static Array<MidiMessage> collectMessages (SerialController& controller, int numWanted)
+    {
+        Array<MidiMessage> messages;
+
+        waitFor ([&]
+        {
+            MidiBuffer block;
+            controller.addNextBlockOfMessages (block, 256);
+
+            MidiBuffer::Iterator i (block);
+            MidiMessage m;
+            int position;
+
+            while (i.getNextEvent (m, position))
+                messages.add (m);
+
+            return messages.size() >= numWanted;
+        });
+
+        return messages;
+    }
+
+    void expectController (const MidiMessage& m, int channel, int controllerNumber, int value)
+    {
+        expect (m.isController());
+        expectEquals (m.getChannel(), channel);
+        expectEquals (m.getControllerNumber(), controllerNumber);
+        expectEquals (m.getControllerValue(), value);
+    }
+};
+
+static SerialControllerTests serialControllerTests;
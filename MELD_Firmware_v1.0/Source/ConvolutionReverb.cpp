@@ -0,0 +1,674 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "ConvolutionReverb.h"
+
+
+//==============================================================================
+/**
+    A uniformly partitioned convolution of one segment of an impulse response.
+
+    It's fed whole blocks of its partition size. Each block's result is the
+    2 * blockSize samples that the newest block and the ones before it contribute,
+    starting at the newest block's own position, and the caller adds them in
+    'offset' samples later.
+*/
+struct ConvolutionReverbProcessor::Partitioned
+{
+    Partitioned (const float* ir, int irLength, int segmentOffset, int partitionSize, int maxSegments)
+        : blockSize (partitionSize),
+          fftSize (partitionSize * 2),
+          spectrumSize (partitionSize * 4),
+          offset (segmentOffset),
+          numSegments (jlimit (1, maxSegments, (irLength - segmentOffset + partitionSize - 1) / partitionSize)),
+          fft (roundToInt (std::log2 ((double) fftSize)))
+    {
+        output.calloc ((size_t) spectrumSize);
+        inputSpectra.calloc ((size_t) (spectrumSize * numSegments));
+        irSpectra.calloc ((size_t) (spectrumSize * numSegments));
+
+        for (int i = 0; i < numSegments; ++i)
+        {
+            auto* segment = irSpectra + i * spectrumSize;
+            auto start = offset + i * blockSize;
+
+            FloatVectorOperations::copy (segment, ir + start, jmin (blockSize, irLength - start));
+            fft.performRealOnlyForwardTransform (segment, true);
+        }
+    }
+
+    /** The position just after the last part of the response this covers. */
+    int getEnd() const noexcept                 { return offset + numSegments * blockSize; }
+
+    void reset() noexcept
+    {
+        FloatVectorOperations::clear (inputSpectra, spectrumSize * numSegments);
+        currentSegment = 0;
+    }
+
+    /** Takes the next blockSize input samples and returns fftSize output samples,
+        which stay valid until the next call.
+    */
+    const float* process (const float* in) noexcept
+    {
+        auto* spectrum = inputSpectra + currentSegment * spectrumSize;
+        FloatVectorOperations::copy (spectrum, in, blockSize);
+        FloatVectorOperations::clear (spectrum + blockSize, spectrumSize - blockSize);
+        fft.performRealOnlyForwardTransform (spectrum, true);
+
+        FloatVectorOperations::clear (output, spectrumSize);
+
+        for (int i = 0; i < numSegments; ++i)
+            multiplyAdd (inputSpectra + ((currentSegment + i) % numSegments) * spectrumSize,
+                         irSpectra + i * spectrumSize, output);
+
+        fillNegativeFrequencies (output);
+        fft.performRealOnlyInverseTransform (output);
+
+        currentSegment = (currentSegment > 0 ? currentSegment : numSegments) - 1;
+        return output;
+    }
+
+    const int blockSize, fftSize, spectrumSize, offset, numSegments;
+
+private:
+    dsp::FFT fft;
+    HeapBlock<float> output, inputSpectra, irSpectra;
+    int currentSegment = 0;
+
+    void multiplyAdd (const float* a, const float* b, float* dest) const noexcept
+    {
+        for (int i = 0; i <= fftSize; i += 2)
+        {
+            auto re = a[i] * b[i] - a[i + 1] * b[i + 1];
+            auto im = a[i] * b[i + 1] + a[i + 1] * b[i];
+            dest[i]     += re;
+            dest[i + 1] += im;
+        }
+    }
+
+    void fillNegativeFrequencies (float* data) const noexcept
+    {
+        for (int bin = 1; bin < fftSize / 2; ++bin)
+        {
+            data[(fftSize - bin) * 2]     =  data[bin * 2];
+            data[(fftSize - bin) * 2 + 1] = -data[bin * 2 + 1];
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (Partitioned)
+};
+
+//==============================================================================
+/**
+    The convolvers for both channels, built for one impulse response and sample rate.
+
+    The first headLength samples of the response are applied as a direct-form FIR.
+    After that come segments of partitionsPerSize partitions each, with the partition
+    size doubling from one segment to the next up to largestPartition, which the last
+    segment uses for as much of the response as is left. A segment's results are due
+    'offset' samples after its input block starts, and each segment starts at least one
+    of its partitions in, so there's never any latency.
+
+    Segments with partitions up to largestSyncPartition run on the audio thread as
+    their input blocks fill. The rest start at least two partitions in, so they get a
+    whole partition of time on this object's own thread. That thread polls for input,
+    and hands back its output a region at a time through a ring, where a region is
+    only played if its tag says the thread finished it in time.
+*/
+struct ConvolutionReverbProcessor::Engine  : private Thread
+{
+    Engine (const AudioBuffer<float>& ir)
+        : Thread ("Convolution tail")
+    {
+        auto irLength = ir.getNumSamples();
+        int largestUsed = headLength, syncReach = 0, workerReach = 0;
+
+        headTaps.setSize (2, headLength);
+        headTaps.clear();
+        history.setSize (2, headLength * 2);
+        history.clear();
+
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            auto* data = ir.getReadPointer (jmin (ch, ir.getNumChannels() - 1));
+            headTaps.copyFrom (ch, 0, data, jmin (irLength, (int) headLength));
+
+            for (int offset = headLength, size = headLength; offset < irLength; size = jmin (size * 2, (int) largestPartition))
+            {
+                auto* segment = new Partitioned (data, irLength, offset, size,
+                                                 size < largestPartition ? (int) partitionsPerSize : std::numeric_limits<int>::max());
+
+                auto reach = offset + size * 2;
+
+                if (size <= largestSyncPartition)
+                {
+                    jassert (offset >= size);
+                    syncSegments[ch].add (segment);
+                    syncReach = jmax (syncReach, reach);
+                }
+                else
+                {
+                    jassert (offset >= size * 2);
+                    workerSegments[ch].add (segment);
+                    workerReach = jmax (workerReach, reach);
+                }
+
+                largestUsed = jmax (largestUsed, size);
+                offset = segment->getEnd();
+            }
+        }
+
+        inputRing.setSize (2, nextPowerOfTwo (largestUsed * 4));
+        inputRing.clear();
+
+        if (syncReach > 0)
+        {
+            syncOutput.setSize (2, nextPowerOfTwo (syncReach));
+            syncOutput.clear();
+        }
+
+        if (workerReach > 0)
+        {
+            workerOutput.setSize (2, nextPowerOfTwo (workerReach));
+            workerOutput.clear();
+            regions.setSize (2, regionSize * numRegions);
+            regions.clear();
+
+            // nothing reaches the first two regions, so they start out finished
+            for (int i = 0; i < numRegions; ++i)
+                regionTags[i] = i < 2 ? i : -1;
+
+            startThread (8);
+        }
+    }
+
+    ~Engine()
+    {
+        signalThreadShouldExit();
+        notify();
+        stopThread (4000);
+    }
+
+    /** Called on the audio thread. The input and output mustn't overlap. */
+    void process (const float* const* in, float* const* out, int num, std::atomic<int>& underruns) noexcept
+    {
+        auto hasWorker = workerOutput.getNumSamples() > 0;
+
+        for (int done = 0; done < num;)
+        {
+            // chunks never cross a head block, so they never wrap around any of the rings
+            auto n = jmin (num - done, headLength - (int) (samplePosition % headLength));
+            auto region = samplePosition / regionSize;
+
+            if (hasWorker && samplePosition % regionSize == 0)
+            {
+                regionReady = regionTags[region % numRegions].load (std::memory_order_acquire) == region;
+
+                if (! regionReady)
+                    ++underruns;
+            }
+
+            for (int ch = 0; ch < 2; ++ch)
+            {
+                auto* dest = out[ch] + done;
+                runHead (ch, in[ch] + done, dest, n);
+
+                FloatVectorOperations::copy (inputRing.getWritePointer (ch, ringIndex (inputRing, samplePosition)), in[ch] + done, n);
+
+                if (syncOutput.getNumSamples() > 0)
+                {
+                    auto* synced = syncOutput.getWritePointer (ch, ringIndex (syncOutput, samplePosition));
+                    FloatVectorOperations::add (dest, synced, n);
+                    FloatVectorOperations::clear (synced, n);
+                }
+
+                if (hasWorker && regionReady)
+                    FloatVectorOperations::add (dest, regions.getReadPointer (ch, (int) (region % numRegions) * regionSize
+                                                                                    + (int) (samplePosition % regionSize)), n);
+            }
+
+            samplePosition += n;
+            done += n;
+
+            if (samplePosition % headLength == 0)
+                for (int ch = 0; ch < 2; ++ch)
+                    runSegments (syncSegments[ch], ch, samplePosition, syncOutput);
+
+            if (hasWorker && samplePosition % regionSize == 0)
+                submitted.store (samplePosition / regionSize, std::memory_order_release);
+        }
+    }
+
+private:
+    enum
+    {
+        headLength = 64,
+        partitionsPerSize = 3,
+        largestSyncPartition = 512,
+        largestPartition = 8192,
+        regionSize = largestSyncPartition * 2,
+        numRegions = 4,
+        pollMilliseconds = 1
+    };
+
+    AudioBuffer<float> headTaps, history, inputRing, syncOutput, workerOutput, regions;
+    OwnedArray<Partitioned> syncSegments[2], workerSegments[2];
+
+    // the audio thread's side
+    int64 samplePosition = 0;
+    bool regionReady = true;
+
+    std::atomic<int64> submitted { 0 };
+    std::atomic<int64> regionTags[numRegions];
+
+    static int ringIndex (const AudioBuffer<float>& ring, int64 position) noexcept
+    {
+        return (int) (position & (ring.getNumSamples() - 1));
+    }
+
+    void runHead (int ch, const float* in, float* out, int num) noexcept
+    {
+        auto* taps = headTaps.getReadPointer (ch);
+        auto* h = history.getWritePointer (ch);
+        auto* newest = h + headLength - 1;
+
+        FloatVectorOperations::copy (newest, in, num);
+        FloatVectorOperations::multiply (out, newest, taps[0], num);
+
+        for (int k = 1; k < headLength; ++k)
+            FloatVectorOperations::addWithMultiply (out, newest - k, taps[k], num);
+
+        memmove (h, h + num, sizeof (float) * (headLength - 1));
+    }
+
+    /** Runs every segment whose input block has just been completed. */
+    void runSegments (OwnedArray<Partitioned>& segments, int ch, int64 position, AudioBuffer<float>& ring) noexcept
+    {
+        for (auto* segment : segments)
+        {
+            if (position % segment->blockSize != 0)
+                continue;
+
+            auto blockStart = position - segment->blockSize;
+            auto* result = segment->process (inputRing.getReadPointer (ch, ringIndex (inputRing, blockStart)));
+
+            // the ring can wrap part way through the result
+            auto start = ringIndex (ring, blockStart + segment->offset);
+            auto first = jmin (segment->fftSize, ring.getNumSamples() - start);
+
+            FloatVectorOperations::add (ring.getWritePointer (ch, start), result, first);
+            FloatVectorOperations::add (ring.getWritePointer (ch), result + first, segment->fftSize - first);
+        }
+    }
+
+    void run() override
+    {
+        int64 next = 1;
+
+        while (! threadShouldExit())
+        {
+            auto latest = submitted.load (std::memory_order_acquire);
+
+            if (latest < next)
+            {
+                wait (pollMilliseconds);
+                continue;
+            }
+
+            // far enough behind that the output can't catch up, so start again from the newest block
+            if (latest - next >= numRegions - 1)
+            {
+                for (auto& segments : workerSegments)
+                    for (auto* s : segments)
+                        s->reset();
+
+                workerOutput.clear();
+                next = latest;
+            }
+
+            auto position = next * regionSize;
+
+            for (int ch = 0; ch < 2; ++ch)
+                runSegments (workerSegments[ch], ch, position, workerOutput);
+
+            // every block that can reach the region after next has now been added in
+            auto finished = next + 1;
+            auto slot = (int) (finished % numRegions);
+
+            regionTags[slot].store (-1, std::memory_order_release);
+
+            for (int ch = 0; ch < 2; ++ch)
+            {
+                auto* src = workerOutput.getWritePointer (ch, ringIndex (workerOutput, finished * regionSize));
+                regions.copyFrom (ch, slot * regionSize, src, regionSize);
+                FloatVectorOperations::clear (src, regionSize);
+            }
+
+            regionTags[slot].store (finished, std::memory_order_release);
+            ++next;
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (Engine)
+};
+
+//==============================================================================
+struct ConvolutionReverbProcessor::Loader  : public Thread
+{
+    Loader (ConvolutionReverbProcessor& p)  : Thread ("Impulse response loader"), owner (p)
+    {
+        formats.registerBasicFormats();
+        startThread (3);
+    }
+
+    ~Loader()
+    {
+        signalThreadShouldExit();
+        notify();
+        stopThread (4000);
+    }
+
+    void load (const File& f)
+    {
+        {
+            const ScopedLock sl (lock);
+            fileToLoad = f;
+        }
+
+        notify();
+    }
+
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            delete owner.retiredEngine.exchange (nullptr);
+
+            File f;
+
+            {
+                const ScopedLock sl (lock);
+                std::swap (f, fileToLoad);
+            }
+
+            if (f != File())
+                read (f);
+
+            wait (200);
+        }
+    }
+
+    void read (const File& f)
+    {
+        ScopedPointer<AudioFormatReader> reader (formats.createReaderFor (f));
+
+        if (reader == nullptr || reader->sampleRate <= 0)
+            return;
+
+        auto length = (int) jmin (reader->lengthInSamples, (int64) (reader->sampleRate * maxSeconds));
+        AudioBuffer<float> ir (jlimit (1, 2, (int) reader->numChannels), length);
+        reader->read (&ir, 0, length, 0, true, ir.getNumChannels() > 1);
+
+        // unit energy, so that swapping responses doesn't jump in level
+        float energy = 0;
+
+        for (int ch = 0; ch < ir.getNumChannels(); ++ch)
+            for (int i = 0; i < length; ++i)
+                energy += ir.getSample (ch, i) * ir.getSample (ch, i);
+
+        if (energy > 0)
+            ir.applyGain (1.0f / std::sqrt (energy / ir.getNumChannels()));
+
+        {
+            const ScopedLock sl (owner.irLock);
+            owner.irFile = f;
+            owner.irData = std::move (ir);
+            owner.irSampleRate = reader->sampleRate;
+        }
+
+        owner.publishEngine();
+    }
+
+    enum { maxSeconds = 12 };
+
+    ConvolutionReverbProcessor& owner;
+    AudioFormatManager formats;
+    CriticalSection lock;
+    File fileToLoad;
+};
+
+//==============================================================================
+struct ConvolutionReverbProcessor::Editor  : public AudioProcessorEditor,
+                                             private Timer
+{
+    Editor (ConvolutionReverbProcessor& p)  : AudioProcessorEditor (p), owner (p)
+    {
+        loadButton.setButtonText ("Load impulse response...");
+        loadButton.onClick = [this] { chooseFile(); };
+        addAndMakeVisible (loadButton);
+        addAndMakeVisible (fileLabel);
+        addAndMakeVisible (statusLabel);
+
+        setSize (360, 100);
+        timerCallback();
+        startTimer (500);
+    }
+
+    void paint (Graphics& g) override
+    {
+        g.fillAll (getLookAndFeel().findColour (ResizableWindow::backgroundColourId));
+    }
+
+    void resized() override
+    {
+        auto area = getLocalBounds().reduced (8);
+        loadButton.setBounds (area.removeFromTop (28));
+        fileLabel.setBounds (area.removeFromTop (24));
+        statusLabel.setBounds (area.removeFromTop (24));
+    }
+
+    void timerCallback() override
+    {
+        auto file = owner.getImpulseResponseFile();
+        fileLabel.setText (file == File() ? String ("No impulse response") : file.getFileName(), dontSendNotification);
+        statusLabel.setText ("Tail underruns: " + String (owner.getNumTailUnderruns()), dontSendNotification);
+    }
+
+    void chooseFile()
+    {
+        chooser = new FileChooser ("Choose an impulse response", owner.getImpulseResponseFile(), "*.wav;*.aif;*.aiff;*.flac");
+
+        chooser->launchAsync (FileBrowserComponent::openMode | FileBrowserComponent::canSelectFiles,
+                              [this] (const FileChooser& fc)
+                              {
+                                  if (fc.getResult() != File())
+                                      owner.loadImpulseResponse (fc.getResult());
+                              });
+    }
+
+    ConvolutionReverbProcessor& owner;
+    TextButton loadButton;
+    Label fileLabel, statusLabel;
+    ScopedPointer<FileChooser> chooser;
+};
+
+//==============================================================================
+ConvolutionReverbProcessor::ConvolutionReverbProcessor()
+    : InternalPlugin (InternalPluginFormat::convolutionReverbName, "Reverb",
+                      BusesProperties().withInput  ("Input",  AudioChannelSet::stereo())
+                                       .withOutput ("Output", AudioChannelSet::stereo()))
+{
+    addParameter (wet = new AudioParameterFloat ("wet", "Wet", NormalisableRange<float> (-60.0f, 6.0f), -12.0f, "dB"));
+    addParameter (dry = new AudioParameterFloat ("dry", "Dry", NormalisableRange<float> (-60.0f, 0.0f), 0.0f, "dB"));
+
+    loader = new Loader (*this);
+}
+
+ConvolutionReverbProcessor::~ConvolutionReverbProcessor()
+{
+    loader = nullptr;
+    delete pendingEngine.exchange (nullptr);
+    delete retiredEngine.exchange (nullptr);
+}
+
+//==============================================================================
+void ConvolutionReverbProcessor::loadImpulseResponse (const File& f)
+{
+    loader->load (f);
+}
+
+File ConvolutionReverbProcessor::getImpulseResponseFile() const
+{
+    const ScopedLock sl (irLock);
+    return irFile;
+}
+
+double ConvolutionReverbProcessor::getTailLengthSeconds() const
+{
+    const ScopedLock sl (irLock);
+    return irSampleRate > 0 ? irData.getNumSamples() / irSampleRate : 0.0;
+}
+
+void ConvolutionReverbProcessor::writeState (XmlElement& xml) const
+{
+    xml.setAttribute ("impulseResponse", getImpulseResponseFile().getFullPathName());
+}
+
+void ConvolutionReverbProcessor::readState (const XmlElement& xml)
+{
+    auto path = xml.getStringAttribute ("impulseResponse");
+
+    if (File::isAbsolutePath (path))
+        loadImpulseResponse (File (path));
+}
+
+//==============================================================================
+ConvolutionReverbProcessor::Engine* ConvolutionReverbProcessor::createEngine() const
+{
+    const ScopedLock sl (irLock);
+
+    if (irData.getNumSamples() == 0 || currentSampleRate <= 0)
+        return nullptr;
+
+    if (irSampleRate == currentSampleRate)
+        return new Engine (irData);
+
+    auto ratio = irSampleRate / currentSampleRate;
+    auto length = (int) (irData.getNumSamples() / ratio);
+    AudioBuffer<float> resampled (irData.getNumChannels(), length);
+
+    for (int ch = 0; ch < irData.getNumChannels(); ++ch)
+    {
+        LagrangeInterpolator interpolator;
+        interpolator.process (ratio, irData.getReadPointer (ch), resampled.getWritePointer (ch), length);
+    }
+
+    return new Engine (resampled);
+}
+
+void ConvolutionReverbProcessor::publishEngine()
+{
+    ScopedPointer<Engine> newEngine (createEngine());
+
+    if (newEngine == nullptr)
+        return;
+
+    // an engine the audio thread hasn't picked up yet is simply replaced, so this never
+    // waits on the audio thread, which may not be running at all
+    delete retiredEngine.exchange (nullptr);
+    delete pendingEngine.exchange (newEngine.release());
+}
+
+void ConvolutionReverbProcessor::prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock)
+{
+    {
+        const ScopedLock sl (irLock);
+        currentSampleRate = sampleRate;
+    }
+
+    delete pendingEngine.exchange (nullptr);
+    delete retiredEngine.exchange (nullptr);
+
+    engine = createEngine();
+    dryBuffer.setSize (2, jmax (1, maximumExpectedSamplesPerBlock));
+    tailUnderruns = 0;
+}
+
+void ConvolutionReverbProcessor::releaseResources()
+{
+    engine = nullptr;
+    dryBuffer.setSize (2, 0);
+}
+
+void ConvolutionReverbProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer&)
+{
+    ScopedNoDenormals noDenormals;
+
+    // only the loader empties the retired slot, so once it's seen empty it stays that way
+    if (retiredEngine.load() == nullptr)
+    {
+        if (auto* next = pendingEngine.exchange (nullptr))
+        {
+            retiredEngine.store (engine.release());
+            engine = next;
+        }
+    }
+
+    auto wetGain = Decibels::decibelsToGain (wet->get(), -60.0f);
+    auto dryGain = Decibels::decibelsToGain (dry->get(), -60.0f);
+
+    if (engine == nullptr || dryBuffer.getNumSamples() == 0 || buffer.getNumChannels() < 2)
+    {
+        buffer.applyGain (dryGain);
+        return;
+    }
+
+    for (int start = 0; start < buffer.getNumSamples(); start += dryBuffer.getNumSamples())
+    {
+        auto num = jmin (dryBuffer.getNumSamples(), buffer.getNumSamples() - start);
+
+        for (int ch = 0; ch < 2; ++ch)
+            dryBuffer.copyFrom (ch, 0, buffer, ch, start, num);
+
+        const float* in[] = { dryBuffer.getReadPointer (0), dryBuffer.getReadPointer (1) };
+        float* out[] = { buffer.getWritePointer (0, start), buffer.getWritePointer (1, start) };
+
+        engine->process (in, out, num, tailUnderruns);
+
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            FloatVectorOperations::multiply (out[ch], wetGain, num);
+            FloatVectorOperations::addWithMultiply (out[ch], in[ch], dryGain, num);
+        }
+    }
+}
+
+AudioProcessorEditor* ConvolutionReverbProcessor::createEditor()
+{
+    return new Editor (*this);
+}
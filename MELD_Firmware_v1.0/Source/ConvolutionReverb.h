@@ -0,0 +1,102 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "InternalFilters.h"
+
+
+//==============================================================================
+/**
+    A zero-latency convolution reverb with non-uniform partitions.
+
+    The start of the impulse response is a short direct-form FIR. The rest is split
+    into segments whose partitions double in size along the response, each starting
+    far enough in that its results are ready before they're due. The small ones run
+    on the audio thread, which works in blocks of any length, and the large ones on
+    a worker thread of their own that always has a whole partition of time.
+
+    Impulse responses are read, resampled and transformed on a loader thread, and
+    the audio thread swaps to the new engine between blocks.
+*/
+class ConvolutionReverbProcessor  : public InternalPlugin
+{
+public:
+    ConvolutionReverbProcessor();
+    ~ConvolutionReverbProcessor();
+
+    //==============================================================================
+    /** Starts loading an impulse response. The current one keeps playing until it's ready. */
+    void loadImpulseResponse (const File&);
+    File getImpulseResponseFile() const;
+
+    /** How many tail blocks the worker has delivered too late to be played. */
+    int getNumTailUnderruns() const noexcept                { return tailUnderruns.load(); }
+
+    //==============================================================================
+    void prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock) override;
+    void releaseResources() override;
+    void processBlock (AudioBuffer<float>&, MidiBuffer&) override;
+    double getTailLengthSeconds() const override;
+
+    bool hasEditor() const override                         { return true; }
+    AudioProcessorEditor* createEditor() override;
+
+protected:
+    void writeState (XmlElement&) const override;
+    void readState (const XmlElement&) override;
+
+private:
+    //==============================================================================
+    struct Partitioned;
+    struct Engine;
+    struct Loader;
+    struct Editor;
+
+    AudioParameterFloat* wet;
+    AudioParameterFloat* dry;
+
+    // everything under this lock belongs to the message and loader threads
+    CriticalSection irLock;
+    File irFile;
+    AudioBuffer<float> irData;
+    double irSampleRate = 0, currentSampleRate = 0;
+
+    // the audio thread owns the current engine, and hands engines back and forth
+    // with the loader through these two slots
+    ScopedPointer<Engine> engine;
+    std::atomic<Engine*> pendingEngine { nullptr };
+    std::atomic<Engine*> retiredEngine { nullptr };
+    std::atomic<int> tailUnderruns { 0 };
+
+    AudioBuffer<float> dryBuffer;
+    ScopedPointer<Loader> loader;
+
+    Engine* createEngine() const;
+    void publishEngine();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ConvolutionReverbProcessor)
+};
@@ -0,0 +1,674 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "MainHostWindow.h"
+#include "InternalFilters.h"
+#include "OfflineRenderer.h"
+#include "PluginWrapper.h"
+#include "Sampler.h"
+#include "ConvolutionReverb.h"
+#include "Looper.h"
+#include "Statistics.h"
+#include "ToolSupport.h"
+#include <iostream>
+#include <map>
+
+/*
+    Renders a set of reference sessions offline and checks their cost against
+    stored baselines, so a change to the graph engine or the internal processors
+    comes with numbers:
+
+        MeldDspBench [--sessions folder] [--baselines folder] [--update-baselines]
+                     [--blocks 32,64,128,256,512,1024] [--rate 48000] [--repeats 3]
+                     [--tolerance 15] [--output results.json]
+
+    The built-in sessions are always run, plus any .filtergraph files in the sessions
+    folder, which may only use the host's internal processors. The built-in samplers
+    and reverb use a sample set and impulse response that are synthesised into a temp
+    folder, and each render drives any looper through a record, playback and overdub
+    pass, so the numbers cover the processors doing real work. Each is rendered at
+    every block size, in single and then double precision, driven by the same MIDI
+    pattern, and the median of the repeats is kept for both the realtime factor and
+    the p99 block time.
+
+    Baselines are one JSON file per session, and are only ever written by a run
+    with --update-baselines, on the machine they're for. Otherwise the results are
+    compared with them: anything more than the tolerance worse than its baseline
+    is a regression, making the exit code 2, and a result with no baseline to
+    compare against makes it 1.
+*/
+
+//==============================================================================
+/** Writes a session out the way FilterGraph saves one, without needing a graph to do it. */
+class SessionBuilder
+{
+public:
+    SessionBuilder()  : xml ("FILTERGRAPH") {}
+
+    int add (const PluginDescription& desc, int slot = -1, const XmlElement* state = nullptr)
+    {
+        auto uid = ++lastUID;
+        auto* e = xml.createNewChildElement ("FILTER");
+        e->setAttribute ("uid", uid);
+        e->setAttribute ("x", 0.5);
+        e->setAttribute ("y", 0.5);
+
+        if (slot >= 0)
+            e->setAttribute ("slot", slot);
+
+        e->addChildElement (desc.createXml());
+
+        if (state != nullptr)
+        {
+            MemoryBlock m;
+            AudioProcessor::copyXmlToBinary (*state, m);
+            e->createNewChildElement ("STATE")->addTextElement (m.toBase64Encoding());
+        }
+
+        return uid;
+    }
+
+    void connect (int source, int sourceChannel, int dest, int destChannel)
+    {
+        auto* e = xml.createNewChildElement ("CONNECTION");
+        e->setAttribute ("srcFilter", source);
+        e->setAttribute ("srcChannel", sourceChannel);
+        e->setAttribute ("dstFilter", dest);
+        e->setAttribute ("dstChannel", destChannel);
+    }
+
+    void connectStereo (int source, int dest, int destChannelOffset = 0)
+    {
+        for (int ch = 0; ch < 2; ++ch)
+            connect (source, ch, dest, destChannelOffset + ch);
+    }
+
+    enum { midiChannel = 0x1000 };
+
+    XmlElement xml;
+
+private:
+    int lastUID = 0;
+};
+
+struct Session
+{
+    String name;
+    ScopedPointer<XmlElement> xml;
+};
+
+//==============================================================================
+static void writeWavFile (const File& file, const AudioBuffer<float>& buffer, double sampleRate)
+{
+    file.deleteFile();
+    ScopedPointer<OutputStream> out (file.createOutputStream());
+
+    if (out == nullptr)
+        return;
+
+    WavAudioFormat wav;
+    ScopedPointer<AudioFormatWriter> writer (wav.createWriterFor (out, sampleRate, (unsigned int) buffer.getNumChannels(),
+                                                                  16, {}, 0));
+    if (writer != nullptr)
+    {
+        out.release();
+        writer->writeFromAudioSampleBuffer (buffer, 0, buffer.getNumSamples());
+    }
+}
+
+/** Fills the folder with a few stereo samples, spread across the keyboard. */
+static void writeBenchmarkSamples (const File& folder)
+{
+    // at this rate a sample fits in the sampler's resident attack, so the render never
+    // waits on its streaming thread, yet each note still lasts about a second and a half
+    const double sampleRate = 11025.0;
+    const int numFrames = 16384;
+    Random random (1);
+
+    for (auto root : { 36, 48, 60, 72, 84 })
+    {
+        AudioBuffer<float> buffer (2, numFrames);
+        auto frequency = MidiMessage::getMidiNoteInHertz (root);
+
+        for (int i = 0; i < numFrames; ++i)
+        {
+            auto phase = MathConstants<double>::twoPi * frequency * i / sampleRate;
+            auto envelope = std::exp (-2.0 * i / numFrames);
+            auto tone = std::sin (phase) + 0.3 * std::sin (2.0 * phase) + 0.05 * (random.nextFloat() - 0.5f);
+
+            buffer.setSample (0, i, (float) (0.5 * envelope * tone));
+            buffer.setSample (1, i, (float) (0.5 * envelope * std::sin (phase + 0.3)));
+        }
+
+        writeWavFile (folder.getChildFile ("Bench " + String (root) + ".wav"), buffer, sampleRate);
+    }
+}
+
+/** A second and a half of decaying stereo noise, which is about as long as a room gets. */
+static File writeBenchmarkImpulseResponse (const File& folder)
+{
+    const double sampleRate = 48000.0;
+    const int numFrames = (int) (sampleRate * 1.5);
+    AudioBuffer<float> buffer (2, numFrames);
+    Random random (2);
+
+    for (int ch = 0; ch < 2; ++ch)
+        for (int i = 0; i < numFrames; ++i)
+            buffer.setSample (ch, i, (float) ((random.nextFloat() * 2.0f - 1.0f) * std::exp (-6.0 * i / numFrames) * 0.3));
+
+    auto file = folder.getChildFile ("Bench IR.wav");
+    writeWavFile (file, buffer, sampleRate);
+    return file;
+}
+
+/** The sessions that are always run: an empty graph, then eight slots of samplers,
+    then the same again through a reverb and a looper.
+*/
+static void addBuiltInSessions (OwnedArray<Session>& sessions)
+{
+    InternalPluginFormat internal;
+
+    // the assets are rewritten every run, so a stale or half-written folder can't skew anything
+    auto assets = File::getSpecialLocation (File::tempDirectory).getChildFile ("MeldDspBench");
+    assets.createDirectory();
+    writeBenchmarkSamples (assets);
+
+    XmlElement samplerState ("STATE"), reverbState ("STATE");
+    samplerState.setAttribute ("folder", assets.getFullPathName());
+    reverbState.setAttribute ("impulseResponse", writeBenchmarkImpulseResponse (assets).getFullPathName());
+
+    // a full set of slots would mostly measure the mixer, so this is a busy session rather than a maximal one
+    const int numSlotsUsed = 8;
+
+    auto build = [&] (const String& name, int numSamplers, bool withEffects)
+    {
+        SessionBuilder b;
+        auto midiIn = b.add (internal.midiInDesc);
+        auto output = b.add (internal.audioOutDesc);
+        auto mixer  = b.add (internal.layerMixerDesc);
+
+        for (int slot = 0; slot < numSamplers; ++slot)
+        {
+            auto router  = b.add (internal.midiRouterDesc);
+            auto sampler = b.add (internal.samplerDesc, slot, &samplerState);
+
+            b.connect (midiIn, SessionBuilder::midiChannel, router, SessionBuilder::midiChannel);
+            b.connect (router, SessionBuilder::midiChannel, sampler, SessionBuilder::midiChannel);
+            b.connectStereo (sampler, mixer, slot * 2);
+        }
+
+        if (withEffects)
+        {
+            auto reverb = b.add (internal.convolutionReverbDesc, -1, &reverbState);
+            auto looper = b.add (internal.looperDesc);
+
+            b.connectStereo (mixer, reverb);
+            b.connectStereo (reverb, looper);
+            b.connectStereo (looper, output);
+        }
+        else
+        {
+            b.connectStereo (mixer, output);
+        }
+
+        auto* s = sessions.add (new Session());
+        s->name = name;
+        s->xml = new XmlElement (b.xml);
+    };
+
+    build ("empty", 0, false);
+    build ("eight-slots", numSlotsUsed, false);
+    build ("eight-slots-with-effects", numSlotsUsed, true);
+}
+
+static void addSessionsFromFolder (const File& folder, OwnedArray<Session>& sessions)
+{
+    Array<File> files;
+    folder.findChildFiles (files, File::findFiles, false, FilterGraph::getFilenameWildcard());
+    files.sort();
+
+    for (auto& f : files)
+    {
+        ScopedPointer<XmlElement> xml (XmlDocument::parse (f));
+
+        if (xml == nullptr || ! xml->hasTagName ("FILTERGRAPH"))
+        {
+            std::cerr << "skipping " << f.getFileName() << ", which isn't a filter graph" << std::endl;
+            continue;
+        }
+
+        auto* s = sessions.add (new Session());
+        s->name = f.getFileNameWithoutExtension();
+        s->xml = xml.release();
+    }
+}
+
+//==============================================================================
+// slotted processors sit inside the timing and oversampling wrappers
+static AudioProcessor* unwrapProcessor (AudioProcessor* processor)
+{
+    while (auto* wrapper = dynamic_cast<PluginWrapper*> (processor))
+        processor = &wrapper->getWrappedPlugin();
+
+    return processor;
+}
+
+static Array<LooperProcessor*> findLoopers (FilterGraph& filterGraph)
+{
+    Array<LooperProcessor*> found;
+
+    for (auto* node : filterGraph.graph.getNodes())
+        if (auto* looper = dynamic_cast<LooperProcessor*> (unwrapProcessor (node->getProcessor())))
+            found.add (looper);
+
+    return found;
+}
+
+static bool hasStateAttribute (const XmlElement& filter, StringRef attribute)
+{
+    if (auto* state = filter.getChildByName ("STATE"))
+    {
+        MemoryBlock m;
+        m.fromBase64Encoding (state->getAllSubText());
+
+        ScopedPointer<XmlElement> xml (AudioProcessor::getXmlFromBinary (m.getData(), (int) m.getSize()));
+        return xml != nullptr && xml->getStringAttribute (attribute).isNotEmpty();
+    }
+
+    return false;
+}
+
+/** Samples and impulse responses arrive on loader threads, so this waits for every one the session names. */
+static bool waitForAssets (FilterGraph& filterGraph, const XmlElement& session, double timeoutSeconds)
+{
+    Array<SamplerProcessor*> samplers;
+    Array<ConvolutionReverbProcessor*> reverbs;
+
+    forEachXmlChildElementWithTagName (session, e, "FILTER")
+    {
+        if (auto* node = filterGraph.getNodeForId ((FilterGraph::NodeID) e->getIntAttribute ("uid")))
+        {
+            auto* processor = unwrapProcessor (node->getProcessor());
+
+            if (auto* sampler = dynamic_cast<SamplerProcessor*> (processor))
+                if (hasStateAttribute (*e, "folder"))
+                    samplers.add (sampler);
+
+            if (auto* reverb = dynamic_cast<ConvolutionReverbProcessor*> (processor))
+                if (hasStateAttribute (*e, "impulseResponse"))
+                    reverbs.add (reverb);
+        }
+    }
+
+    auto deadline = Time::getMillisecondCounterHiRes() + timeoutSeconds * 1000.0;
+
+    for (;;)
+    {
+        auto ready = true;
+
+        for (auto* s : samplers)
+            ready = ready && s->getNumLoadedSamples() > 0;
+
+        for (auto* r : reverbs)
+            ready = ready && r->getTailLengthSeconds() > 0;
+
+        if (ready)
+            return true;
+
+        if (Time::getMillisecondCounterHiRes() > deadline)
+            return false;
+
+        Thread::sleep (10);
+    }
+}
+
+//==============================================================================
+struct BenchResult
+{
+    int blockSize = 0;
+    bool doublePrecision = false;
+    double realtimeFactor = 0, p99Us = 0;
+
+    String getKey() const       { return String (blockSize) + (doublePrecision ? "/double" : "/single"); }
+
+    var toJson() const
+    {
+        auto* o = new DynamicObject();
+        o->setProperty ("blockSize", blockSize);
+        o->setProperty ("precision", doublePrecision ? "double" : "single");
+        o->setProperty ("realtimeFactor", realtimeFactor);
+        o->setProperty ("p99Us", p99Us);
+        return var (o);
+    }
+
+    static BenchResult fromJson (const var& v)
+    {
+        BenchResult r;
+        r.blockSize = v["blockSize"];
+        r.doublePrecision = v["precision"].toString() == "double";
+        r.realtimeFactor = v["realtimeFactor"];
+        r.p99Us = v["p99Us"];
+        return r;
+    }
+};
+
+static Array<BenchResult> runSession (AudioPluginFormatManager& formatManager, Session& session, const Array<int64>& blockSizes,
+                                 double sampleRate, int repeats, const MidiMessageSequence& pattern, String& error)
+{
+    Array<BenchResult> results;
+
+    FilterGraph filterGraph (formatManager);
+    removeOpenWindows (*session.xml);
+    filterGraph.restoreFromXml (*session.xml);
+    filterGraph.flushPendingChanges();
+
+    // anything that isn't built in can't be loaded here, and would make the numbers meaningless
+    forEachXmlChildElementWithTagName (*session.xml, e, "FILTER")
+    {
+        if (filterGraph.getNodeForId ((FilterGraph::NodeID) e->getIntAttribute ("uid")) == nullptr)
+        {
+            error = "it uses plugins that aren't built into the host";
+            return {};
+        }
+    }
+
+    if (! waitForAssets (filterGraph, *session.xml, 10.0))
+    {
+        error = "its samples or impulse responses didn't load";
+        return {};
+    }
+
+    // record two seconds, play them back, overdub a pass over the top, then keep playing
+    struct LooperCue  { double time; LooperProcessor::Command command; };
+    const Array<LooperCue> looperCues { { 0.0, LooperProcessor::record }, { 2.0, LooperProcessor::record },
+                                        { 4.0, LooperProcessor::record }, { 6.0, LooperProcessor::play } };
+
+    auto loopers = findLoopers (filterGraph);
+    OfflineRenderer renderer (filterGraph.graph);
+
+    for (int precision = 0; precision < 2; ++precision)
+    {
+        auto useDouble = (precision == 1);
+
+        if (useDouble && ! filterGraph.graph.supportsDoublePrecisionProcessing())
+            continue;
+
+        for (auto blockSize : blockSizes)
+        {
+            OfflineRenderer::Settings settings;
+            settings.sampleRate = sampleRate;
+            settings.blockSize = (int) blockSize;
+            settings.tailSeconds = 1.0;
+            settings.doublePrecision = useDouble;
+
+            if (! loopers.isEmpty())
+            {
+                settings.beforeBlock = [=] (int64 position)
+                {
+                    for (auto& cue : looperCues)
+                    {
+                        auto cuePosition = (int64) (cue.time * sampleRate);
+
+                        if (cuePosition >= position && cuePosition < position + blockSize)
+                            for (auto* looper : loopers)
+                                looper->sendCommand (cue.command);
+                    }
+                };
+            }
+
+            BenchResult r;
+            r.blockSize = (int) blockSize;
+            r.doublePrecision = useDouble;
+
+            // the median, so one run disturbed by something else on the machine can't move it
+            Array<double> realtimeFactors, p99s;
+
+            for (int i = 0; i < repeats; ++i)
+            {
+                auto report = renderer.render (pattern, settings);
+
+                realtimeFactors.add (report.getRealtimeFactor());
+                p99s.add (report.getBlockPercentile (0.99) * 1.0e6);
+            }
+
+            r.realtimeFactor = percentile (realtimeFactors, 0.5);
+            r.p99Us = percentile (p99s, 0.5);
+
+            results.add (r);
+        }
+    }
+
+    return results;
+}
+
+//==============================================================================
+static var createBaseline (const String& sessionName, double sampleRate, const Array<BenchResult>& results)
+{
+    Array<var> entries;
+
+    for (auto& r : results)
+        entries.add (r.toJson());
+
+    auto* o = new DynamicObject();
+    o->setProperty ("session", sessionName);
+    o->setProperty ("sampleRate", sampleRate);
+    o->setProperty ("version", ProjectInfo::versionString);
+    o->setProperty ("time", Time::getCurrentTime().toISO8601 (true));
+    o->setProperty ("system", SystemStats::getOperatingSystemName());
+    o->setProperty ("results", entries);
+    return var (o);
+}
+
+static void printResult (const String& sessionName, const BenchResult& r)
+{
+    std::cout << "  " << sessionName.paddedRight (' ', 28).substring (0, 28)
+              << r.getKey().paddedRight (' ', 12)
+              << String (r.realtimeFactor, 1).paddedLeft (' ', 9) << "x"
+              << String (r.p99Us, 1).paddedLeft (' ', 10) << " us";
+}
+
+/** Prints each result against its baseline, and returns how many got worse by more than the
+    tolerance. Any that have no baseline at the same sample rate are added to numMissing.
+*/
+static int compareWithBaseline (const String& sessionName, const var& baseline, double sampleRate,
+                                const Array<BenchResult>& results, double tolerance, int& numMissing)
+{
+    std::map<String, BenchResult> expected;
+
+    if (baseline.isObject() && (double) baseline["sampleRate"] == sampleRate)
+        if (auto* entries = baseline["results"].getArray())
+            for (auto& e : *entries)
+                expected[BenchResult::fromJson (e).getKey()] = BenchResult::fromJson (e);
+
+    int numRegressions = 0;
+
+    for (auto& r : results)
+    {
+        printResult (sessionName, r);
+
+        auto found = expected.find (r.getKey());
+
+        if (found == expected.end())
+        {
+            std::cout << "    NO BASELINE" << std::endl;
+            ++numMissing;
+            continue;
+        }
+
+        auto& b = found->second;
+        auto speedChange = b.realtimeFactor > 0 ? r.realtimeFactor / b.realtimeFactor - 1.0 : 0.0;
+        auto p99Change   = b.p99Us > 0 ? r.p99Us / b.p99Us - 1.0 : 0.0;
+        auto regressed   = speedChange < -tolerance || p99Change > tolerance;
+
+        std::cout << "    " << (speedChange >= 0 ? "+" : "") << String (speedChange * 100.0, 1) << "% speed, "
+                  << (p99Change >= 0 ? "+" : "") << String (p99Change * 100.0, 1) << "% p99"
+                  << (regressed ? "  REGRESSION" : "") << std::endl;
+
+        if (regressed)
+            ++numRegressions;
+    }
+
+    return numRegressions;
+}
+
+//==============================================================================
+static void printUsage()
+{
+    std::cerr << "usage: MeldDspBench [--sessions folder] [--baselines folder] [--update-baselines]" << std::endl
+              << "         [--blocks 32,64,128,256,512,1024] [--rate 48000] [--repeats 3]" << std::endl
+              << "         [--tolerance 15] [--output results.json]" << std::endl;
+}
+
+int main (int argc, char* argv[])
+{
+    StringArray args;
+
+    for (int i = 1; i < argc; ++i)
+        args.add (argv[i]);
+
+    auto cwd = File::getCurrentWorkingDirectory();
+    File sessionsFolder, baselinesFolder (cwd.getChildFile ("Benchmarks/Baselines"));
+    Array<int64> blockSizes { 32, 64, 128, 256, 512, 1024 };
+    double sampleRate = 48000.0, tolerance = 0.15;
+    int repeats = 3;
+    bool updateBaselines = false;
+    String outputPath;
+
+    for (int i = 0; i < args.size(); ++i)
+    {
+        auto& arg = args[i];
+
+        if (arg == "--sessions")                sessionsFolder = cwd.getChildFile (args[++i]);
+        else if (arg == "--baselines")          baselinesFolder = cwd.getChildFile (args[++i]);
+        else if (arg == "--update-baselines")   updateBaselines = true;
+        else if (arg == "--blocks")             blockSizes = parseList (args[++i]);
+        else if (arg == "--rate")               sampleRate = args[++i].getDoubleValue();
+        else if (arg == "--repeats")            repeats = args[++i].getIntValue();
+        else if (arg == "--tolerance")          tolerance = args[++i].getDoubleValue() / 100.0;
+        else if (arg == "--output")             outputPath = args[++i];
+        else                                    { printUsage(); return 1; }
+    }
+
+    for (int i = blockSizes.size(); --i >= 0;)
+        if (blockSizes[i] <= 0)
+            blockSizes.remove (i);
+
+    if (blockSizes.isEmpty() || sampleRate <= 0 || repeats <= 0 || tolerance < 0)
+    {
+        printUsage();
+        return 1;
+    }
+
+    ScopedJuceInitialiser_GUI juceInitialiser;
+    ToolEnvironment environment ("MELD DSP Benchmark");
+
+    // the graph logs every plugin it adds, which would swamp the results
+    QuietLogger quietLogger;
+    Logger::setCurrentLogger (&quietLogger);
+
+    AudioPluginFormatManager formatManager;
+    formatManager.addFormat (new InternalPluginFormat());
+
+    OwnedArray<Session> sessions;
+    addBuiltInSessions (sessions);
+
+    if (sessionsFolder != File())
+        addSessionsFromFolder (sessionsFolder, sessions);
+
+    auto pattern = OfflineRenderer::createTestPattern (8.0);
+    Array<var> allResults;
+    int numRegressions = 0, numMissing = 0;
+    bool failedToWrite = false;
+
+    std::cout << "session                     block/precision  realtime     p99" << std::endl;
+
+    for (auto* session : sessions)
+    {
+        String error;
+        auto results = runSession (formatManager, *session, blockSizes, sampleRate, repeats, pattern, error);
+
+        if (error.isNotEmpty())
+        {
+            std::cerr << "skipping " << session->name << ": " << error << std::endl;
+            continue;
+        }
+
+        auto baseline = createBaseline (session->name, sampleRate, results);
+        auto baselineFile = baselinesFolder.getChildFile (session->name + ".json");
+
+        if (updateBaselines)
+        {
+            for (auto& r : results)
+            {
+                printResult (session->name, r);
+                std::cout << "    saved" << std::endl;
+            }
+
+            if (baselinesFolder.createDirectory().failed() || ! baselineFile.replaceWithText (JSON::toString (baseline)))
+            {
+                std::cerr << "couldn't write " << baselineFile.getFullPathName() << std::endl;
+                failedToWrite = true;
+            }
+        }
+        else
+        {
+            numRegressions += compareWithBaseline (session->name, JSON::parse (baselineFile), sampleRate,
+                                                   results, tolerance, numMissing);
+        }
+
+        allResults.add (baseline);
+    }
+
+    Logger::setCurrentLogger (nullptr);
+
+    if (outputPath.isNotEmpty() && ! cwd.getChildFile (outputPath).replaceWithText (JSON::toString (var (allResults))))
+    {
+        std::cerr << "MeldDspBench: couldn't write to " << outputPath << std::endl;
+        return 1;
+    }
+
+    if (failedToWrite)
+        return 1;
+
+    if (numRegressions > 0)
+    {
+        std::cout << std::endl << numRegressions << " result" << (numRegressions == 1 ? "" : "s")
+                  << " regressed by more than " << String (tolerance * 100.0, 0) << "%" << std::endl;
+        return 2;
+    }
+
+    // a missing baseline is never made up here, as a number from another machine would be meaningless
+    if (numMissing > 0)
+    {
+        std::cout << std::endl << numMissing << " result" << (numMissing == 1 ? " has" : "s have")
+                  << " no baseline; record them on this machine with --update-baselines" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
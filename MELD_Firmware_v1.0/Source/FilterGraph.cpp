@@ -40,6 +40,11 @@ FilterGraph::FilterGraph (AudioPluginFormatManager& fm)
                          "Save a filter graph"),
       formatManager (fm)
 {
+    for (auto& p : offThreadChanges)
+        p = nullptr;
+
+    analyser.setSource (numSlots);
+
     newDocument();
 
     graph.addListener (this);
@@ -52,9 +57,12 @@ FilterGraph::FilterGraph (AudioPluginFormatManager& fm)
 
 FilterGraph::~FilterGraph()
 {
-    graph.addListener (this);
+    cancelPendingUpdate();
+    stopTimer();
+    graph.removeListener (this);
     graph.removeChangeListener (this);
     graph.clear();
+    rebuildNodeIndex();
 }
 
 FilterGraph::NodeID FilterGraph::getNextUID() noexcept
@@ -65,85 +73,548 @@ FilterGraph::NodeID FilterGraph::getNextUID() noexcept
 //==============================================================================
 void FilterGraph::changeListenerCallback (ChangeBroadcaster*)
 {
-    changed();
+    rebuildNodeIndex();
+    graphEdited();
+    markTopologyChanged();
 
     for (int i = activePluginWindows.size(); --i >= 0;)
         if (! graph.getNodes().contains (activePluginWindows.getUnchecked(i)->node))
             activePluginWindows.remove (i);
 }
 
+void FilterGraph::graphEdited()
+{
+    // the graph also reports connections made outside this class, so this runs from
+    // its change message as well as straight after a restore
+    updateMasterStage();
+    updateMeterTaps();
+    updateRecorderTap();
+}
+
+void FilterGraph::audioProcessorParameterChanged (AudioProcessor* processor, int, float)
+{
+    audioProcessorChanged (processor);
+}
+
+void FilterGraph::audioProcessorChanged (AudioProcessor* processor)
+{
+    if (MessageManager::getInstance()->isThisTheMessageThread())
+    {
+        auto found = nodesByProcessor.find (processor);
+
+        if (found != nodesByProcessor.end())
+            markNodeChanged (found->second);
+
+        return;
+    }
+
+    for (auto& slot : offThreadChanges)
+    {
+        AudioProcessor* expected = nullptr;
+
+        // a processor that's already parked has had its update triggered, which matters
+        // for parameters being automated on the audio thread
+        if (slot.compare_exchange_strong (expected, processor))
+        {
+            triggerAsyncUpdate();
+            return;
+        }
+
+        if (expected == processor)
+            return;
+    }
+
+    // too many at once to keep track of, so the next flush just looks at everything
+    offThreadOverflow = true;
+    triggerAsyncUpdate();
+}
+
+//==============================================================================
+void FilterGraph::addListener (Listener* l)       { listeners.add (l); }
+void FilterGraph::removeListener (Listener* l)    { listeners.remove (l); }
+
+void FilterGraph::markNodeChanged (NodeID nodeID)
+{
+    pendingChangedNodes.insert (nodeID);
+    triggerAsyncUpdate();
+}
+
+void FilterGraph::markTopologyChanged()
+{
+    topologyChanged = true;
+    triggerAsyncUpdate();
+}
+
+void FilterGraph::handleAsyncUpdate()
+{
+    for (auto& slot : offThreadChanges)
+    {
+        if (auto* processor = slot.exchange (nullptr))
+        {
+            auto found = nodesByProcessor.find (processor);
+
+            if (found != nodesByProcessor.end())
+                pendingChangedNodes.insert (found->second);
+        }
+    }
+
+    if (offThreadOverflow.exchange (false))
+        for (auto* node : graph.getNodes())
+            pendingChangedNodes.insert (node->nodeID);
+
+    // the first change after a quiet spell goes out straight away, anything that
+    // follows it is held back until the next frame
+    if (! isTimerRunning())
+    {
+        sendDelta();
+        startTimerHz (60);
+    }
+}
+
+void FilterGraph::timerCallback()
+{
+    if (topologyChanged || ! pendingChangedNodes.empty())
+        sendDelta();
+    else
+        stopTimer();
+}
+
+void FilterGraph::sendDelta()
+{
+    Delta delta;
+
+    if (topologyChanged)
+    {
+        topologyChanged = false;
+
+        std::unordered_set<NodeID> currentNodes;
+        std::unordered_set<AudioProcessorGraph::Connection, ConnectionHash> currentConnections;
+
+        for (auto* node : graph.getNodes())
+        {
+            currentNodes.insert (node->nodeID);
+
+            if (knownNodes.find (node->nodeID) == knownNodes.end())
+                delta.nodesAdded.add (node->nodeID);
+        }
+
+        for (auto nodeID : knownNodes)
+            if (currentNodes.find (nodeID) == currentNodes.end())
+                delta.nodesRemoved.add (nodeID);
+
+        for (auto& c : graph.getConnections())
+        {
+            currentConnections.insert (c);
+
+            if (knownConnections.find (c) == knownConnections.end())
+                delta.connectionsAdded.add (c);
+        }
+
+        for (auto& c : knownConnections)
+            if (currentConnections.find (c) == currentConnections.end())
+                delta.connectionsRemoved.add (c);
+
+        knownNodes.swap (currentNodes);
+        knownConnections.swap (currentConnections);
+    }
+
+    for (auto nodeID : pendingChangedNodes)
+        if (knownNodes.find (nodeID) != knownNodes.end() && ! delta.nodesAdded.contains (nodeID))
+            delta.nodesChanged.add (nodeID);
+
+    pendingChangedNodes.clear();
+
+    if (delta.isEmpty())
+        return;
+
+    changed();
+    listeners.call ([&] (Listener& l) { l.filterGraphChanged (delta); });
+}
+
+//==============================================================================
+void FilterGraph::indexNode (AudioProcessorGraph::Node* node)
+{
+    nodesByID[node->nodeID] = node;
+
+    // like the old linear search, the first node added with a name wins
+    if (auto* p = node->getProcessor())
+    {
+        nodesByName.emplace (p->getName().toLowerCase(), node);
+        nodesByProcessor[p] = node->nodeID;
+        p->addListener (this);
+    }
+
+    if (node->properties.contains ("slot"))
+    {
+        auto slot = (int) node->properties["slot"];
+
+        if (isPositiveAndBelow (slot, (int) numSlots))
+            slotNodes[slot] = node->nodeID;
+    }
+}
+
+void FilterGraph::rebuildNodeIndex()
+{
+    // the index's references keep removed nodes' processors alive until this point
+    for (auto& entry : nodesByID)
+        if (auto* p = entry.second->getProcessor())
+            p->removeListener (this);
+
+    nodesByID.clear();
+    nodesByName.clear();
+    nodesByProcessor.clear();
+
+    for (auto& slotNode : slotNodes)
+        slotNode = 0;
+
+    for (auto* node : graph.getNodes())
+        indexNode (node);
+}
+
+void FilterGraph::assignSlot (AudioProcessorGraph::Node* node, int slot)
+{
+    if (! isPositiveAndBelow (slot, (int) numSlots))
+        return;
+
+    node->properties.set ("slot", slot);
+    slotNodes[slot] = node->nodeID;
+    markNodeChanged (node->nodeID);
+}
+
+AudioProcessorGraph::Node* FilterGraph::getNodeForId (NodeID nodeID) const
+{
+    auto found = nodesByID.find (nodeID);
+    return found != nodesByID.end() ? found->second.get() : nullptr;
+}
+
 AudioProcessorGraph::Node::Ptr FilterGraph::getNodeForName (const String& name) const
+{
+    auto found = nodesByName.find (name.toLowerCase());
+    return found != nodesByName.end() ? found->second : nullptr;
+}
+
+AudioProcessorGraph::Node* FilterGraph::getNodeForSlot (int slot) const
+{
+    if (isPositiveAndBelow (slot, (int) numSlots) && slotNodes[slot] != 0)
+        return getNodeForId (slotNodes[slot]);
+
+    return nullptr;
+}
+
+int FilterGraph::getSlotForNode (NodeID nodeID) const
+{
+    if (auto* node = getNodeForId (nodeID))
+        if (node->properties.contains ("slot"))
+            return (int) node->properties["slot"];
+
+    return -1;
+}
+
+int FilterGraph::getFirstFreeSlot() const
+{
+    for (int i = 0; i < numSlots; ++i)
+        if (slotNodes[i] == 0)
+            return i;
+
+    return -1;
+}
+
+AudioProcessorGraph::Node* FilterGraph::getAudioOutputNode() const
 {
     for (auto* node : graph.getNodes())
-        if (auto p = node->getProcessor())
-            if (p->getName().equalsIgnoreCase (name))
-                
+        if (auto* io = dynamic_cast<AudioProcessorGraph::AudioGraphIOProcessor*> (node->getProcessor()))
+            if (io->getType() == AudioProcessorGraph::AudioGraphIOProcessor::audioOutputNode)
                 return node;
-    
+
     return nullptr;
 }
 
-void FilterGraph::addPlugin (const PluginDescription& desc, Point<double> p) //where plugin is added
+void FilterGraph::updateMasterStage()
+{
+    auto* output = getAudioOutputNode();
+
+    if (output == nullptr)
+        return;
+
+    auto limiter = getNodeForName (InternalPluginFormat::masterLimiterName);
+
+    if (limiter == nullptr)
+    {
+        limiter = graph.addNode (InternalPluginFormat::createMasterLimiter());
+
+        if (limiter == nullptr)
+            return;
+
+        limiter->properties.set ("x", 0.5);
+        limiter->properties.set ("y", 0.8);
+        indexNode (limiter);
+    }
+
+    // anything wired straight to the output, old sessions included, goes through the limiter instead
+    for (auto& c : graph.getConnections())
+    {
+        if (c.destination.nodeID == output->nodeID && c.destination.channelIndex < 2
+             && c.source.nodeID != limiter->nodeID)
+        {
+            graph.removeConnection (c);
+            graph.addConnection ({ c.source, { limiter->nodeID, c.destination.channelIndex } });
+        }
+    }
+
+    for (int ch = 0; ch < 2; ++ch)
+        if (! graph.isConnected ({ { limiter->nodeID, ch }, { output->nodeID, ch } }))
+            graph.addConnection ({ { limiter->nodeID, ch }, { output->nodeID, ch } });
+}
+
+void FilterGraph::updateMeterTaps()
+{
+    auto tapNode = graph.getNodeForId (meterTapID);
+    auto* tap = tapNode != nullptr ? dynamic_cast<MeterTapProcessor*> (tapNode->getProcessor()) : nullptr;
+
+    if (tap == nullptr)
+    {
+        // always given a fresh ID, and moved by moveTapsAwayFrom() if a restored node wants it
+        tap = new MeterTapProcessor (meters, numSlots + 1, &analyser);
+        tapNode = graph.addNode (tap);
+
+        if (tapNode == nullptr)
+            return;
+
+        meterTapID = tapNode->nodeID;
+        indexNode (tapNode);
+    }
+
+    Array<AudioProcessorGraph::Connection> wanted;
+    uint32 activeMeters = 0;
+
+    for (int slot = 0; slot < numSlots; ++slot)
+    {
+        if (auto* node = getNodeForSlot (slot))
+        {
+            for (int ch = 0; ch < 2; ++ch)
+                wanted.add ({ { node->nodeID, ch }, { meterTapID, slot * 2 + ch } });
+
+            activeMeters |= (1u << slot);
+        }
+    }
+
+    // the master meter hears the same sum the output node does
+    if (auto* output = getAudioOutputNode())
+    {
+        for (auto& c : graph.getConnections())
+        {
+            if (c.destination.nodeID == output->nodeID && c.destination.channelIndex < 2)
+            {
+                wanted.add ({ c.source, { meterTapID, numSlots * 2 + c.destination.channelIndex } });
+                activeMeters |= (1u << numSlots);
+            }
+        }
+    }
+
+    for (auto& c : graph.getConnections())
+        if (c.destination.nodeID == meterTapID && ! wanted.contains (c))
+            graph.removeConnection (c);
+
+    for (auto& c : wanted)
+        if (! graph.isConnected (c))
+            graph.addConnection (c);
+
+    tap->setActiveMeters (activeMeters);
+}
+
+/*  Restored nodes keep the IDs they were saved with, which a tap may already have in a
+    replay or a render. The tap gives way, and is rebuilt on the next update with an ID
+    the graph picks above every one it has seen, so the user's node is never dropped.
+*/
+void FilterGraph::moveTapsAwayFrom (NodeID uid)
+{
+    if (uid == 0 || (uid != meterTapID && uid != recorderTapID))
+        return;
+
+    removeSingleNode (uid);
+
+    if (uid == meterTapID)
+        meterTapID = 0;
+    else
+        recorderTapID = 0;
+}
+
+void FilterGraph::updateRecorderTap()
+{
+    auto tapNode = graph.getNodeForId (recorderTapID);
+
+    if (tapNode == nullptr || dynamic_cast<RecorderTapProcessor*> (tapNode->getProcessor()) == nullptr)
+    {
+        tapNode = graph.addNode (new RecorderTapProcessor (recorder));
+
+        if (tapNode == nullptr)
+            return;
+
+        recorderTapID = tapNode->nodeID;
+        indexNode (tapNode);
+    }
+
+    // like the master meter, it's wired in parallel with the output node
+    Array<AudioProcessorGraph::Connection> wanted;
+
+    if (auto* output = getAudioOutputNode())
+        for (auto& c : graph.getConnections())
+            if (c.destination.nodeID == output->nodeID && c.destination.channelIndex < 2)
+                wanted.add ({ c.source, { recorderTapID, c.destination.channelIndex } });
+
+    for (auto& c : graph.getConnections())
+        if (c.destination.nodeID == recorderTapID && ! wanted.contains (c))
+            graph.removeConnection (c);
+
+    for (auto& c : wanted)
+        if (! graph.isConnected (c))
+            graph.addConnection (c);
+}
+
+AudioProcessorGraph::Node* FilterGraph::addMidiRouterFor (AudioProcessorGraph::Node& target)
+{
+    auto router = graph.addNode (InternalPluginFormat::createMidiRouter());
+
+    if (router == nullptr)
+        return nullptr;
+
+    auto pos = getNodePosition (target.nodeID);
+    router->properties.set ("x", pos.x);
+    router->properties.set ("y", jmax (0.0, pos.y - 0.1));
+    indexNode (router);
+
+    graph.addConnection ({ { 1, 0x1000 }, { router->nodeID, 0x1000 } });
+    return router;
+}
+
+bool FilterGraph::removeNode (NodeID nodeID)
+{
+    Array<NodeID> routers;
+
+    // a router only exists to feed one node, so it goes too
+    for (auto& c : graph.getConnections())
+        if (c.destination.nodeID == nodeID && c.destination.channelIndex == 0x1000)
+            if (auto* source = getNodeForId (c.source.nodeID))
+                if (source->getProcessor()->getName() == InternalPluginFormat::midiRouterName)
+                    routers.add (source->nodeID);
+
+    if (! removeSingleNode (nodeID))
+        return false;
+
+    for (auto router : routers)
+        removeSingleNode (router);
+
+    return true;
+}
+
+bool FilterGraph::removeSingleNode (NodeID nodeID)
+{
+    if (! graph.removeNode (nodeID))
+        return false;
+
+    rebuildNodeIndex();
+    markTopologyChanged();
+    return true;
+}
+
+//==============================================================================
+void FilterGraph::addPlugin (const PluginDescription& desc, Point<double> p, int slot) //where plugin is added
 {
 
     struct AsyncCallback : public AudioPluginFormat::InstantiationCompletionCallback
     {
-        AsyncCallback (FilterGraph& g, Point<double> pos)  : owner (g), position (pos)
+        AsyncCallback (FilterGraph& g, Point<double> pos, int s)  : owner (g), position (pos), slot (s)
         {}
         
         void completionCallback (AudioPluginInstance* instance, const String& error) override //where plugin is initiated
         {
-            //String message;
-            int test = (int) owner.graph.getNumNodes(); //gets last index in NodeID array as an int variable
-            
-            owner.addFilterCallback(instance, error, position);
-            
-            int testi = (int) owner.graph.getNode(test)->nodeID;
-            //message << testi << newLine;
-            //Logger::getCurrentLogger()->writeToLog(message);
+            auto hasSlot = isPositiveAndBelow (slot, (int) FilterGraph::numSlots);
+
+            if (instance != nullptr)
+            {
+                owner.pluginLoadTimes.record ((Time::getMillisecondCounterHiRes() - startTime) * 0.001);
+
+                if (hasSlot)
+                {
+                    instance->enableAllBuses();
+                    instance = new TimedPluginWrapper (instance, owner.slotLoads[slot]);
+                }
+            }
+
+            auto* node = owner.addFilterCallback (instance, error, position);
+
+            if (node == nullptr)
+                return;
+
+            auto nodeID = node->nodeID;
+
+            // with a layer mixer in the graph, slots stack up on its inputs instead of
+            // taking turns on the output
+            auto mixer = hasSlot ? owner.getNodeForName (InternalPluginFormat::layerMixerName) : nullptr;
             
-            AudioProcessorGraph::Connection midiInConnection {{1, 0x1000},{static_cast<NodeID>(testi), 0x1000}};
+            AudioProcessorGraph::Connection midiInConnection {{1, 0x1000},{nodeID, 0x1000}};
+
+            // a slotted instrument gets its own router, so it only hears the notes meant for it
+            if (hasSlot && instance->acceptsMidi())
+                if (auto* router = owner.addMidiRouterFor (*node))
+                    midiInConnection = { { router->nodeID, 0x1000 }, { nodeID, 0x1000 } };
+
             owner.graph.addConnection(midiInConnection);
             
-            
-            AudioProcessorGraph::Connection audioLeftOutConnection { {static_cast<NodeID>(testi), 0}, {2, 0} };
-            owner.graph.addConnection(audioLeftOutConnection);
-            AudioProcessorGraph::Connection audioRightOutConnection { {static_cast<NodeID>(testi), 1}, {2, 1} };
-            owner.graph.addConnection(audioRightOutConnection);
+            if (mixer != nullptr)
+            {
+                for (int ch = 0; ch < 2; ++ch)
+                    owner.graph.addConnection ({ { nodeID, ch }, { mixer->nodeID, slot * 2 + ch } });
+            }
+            else
+            {
+                AudioProcessorGraph::Connection audioLeftOutConnection { {nodeID, 0}, {2, 0} };
+                owner.graph.addConnection(audioLeftOutConnection);
+                AudioProcessorGraph::Connection audioRightOutConnection { {nodeID, 1}, {2, 1} };
+                owner.graph.addConnection(audioRightOutConnection);
+            }
             
             String message;
-            message << "filter added: " << testi << newLine;
+            message << "filter added: " << (int) nodeID << newLine;
             Logger::getCurrentLogger()->writeToLog(message);
             
-            if (testi > 2)
+            if (hasSlot)
             {
-                owner.getOrCreateWindowFor(owner.graph.getNode(test), PluginWindow::Type::normal);
-            }
-            
-            if (testi > 3) {
-                int rm = testi - 1;
-                owner.graph.removeNode(rm);
-                message << "filter removed: " << rm << newLine;
-                Logger::getCurrentLogger()->writeToLog(message);
-            }
+                // without a mixer only one slot sounds at a time, so whatever was loaded
+                // makes way; with one, only the plugin this replaces does
+                for (int i = 0; i < FilterGraph::numSlots; ++i)
+                {
+                    if (mixer != nullptr && i != slot)
+                        continue;
 
-            
-            
-            
+                    if (auto* previous = owner.getNodeForSlot (i))
+                    {
+                        auto rm = previous->nodeID;
+                        owner.removeNode (rm);
+                        message << "filter removed: " << (int) rm << newLine;
+                        Logger::getCurrentLogger()->writeToLog(message);
+                    }
+                }
+
+                owner.assignSlot (node, slot);
+                owner.getOrCreateWindowFor (node, PluginWindow::Type::normal);
             }
+        }
         
         FilterGraph& owner;
         Point<double> position;
+        int slot;
+        const double startTime = Time::getMillisecondCounterHiRes();
  
     };
 
     formatManager.createPluginInstanceAsync (desc,
                                              graph.getSampleRate(),
                                              graph.getBlockSize(),
-                                             new AsyncCallback (*this, p));
+                                             new AsyncCallback (*this, p, slot));
 }
 
-void FilterGraph::addFilterCallback (AudioPluginInstance* instance, const String& error, Point<double> pos)
+AudioProcessorGraph::Node* FilterGraph::addFilterCallback (AudioPluginInstance* instance, const String& error, Point<double> pos)
 {
     
     if (instance == nullptr)
@@ -160,23 +631,28 @@ void FilterGraph::addFilterCallback (AudioPluginInstance* instance, const String
         {
             node->properties.set ("x", pos.x);
             node->properties.set ("y", pos.y);
-            changed();
+            indexNode (node);
+            markTopologyChanged();
+            return node;
         }
     }
+
+    return nullptr;
 }
 
 void FilterGraph::setNodePosition (NodeID nodeID, Point<double> pos)
 {
-    if (auto* n = graph.getNodeForId (nodeID))
+    if (auto* n = getNodeForId (nodeID))
     {
         n->properties.set ("x", jlimit (0.0, 1.0, pos.x));
         n->properties.set ("y", jlimit (0.0, 1.0, pos.y));
+        markNodeChanged (nodeID);
     }
 }
 
 Point<double> FilterGraph::getNodePosition (NodeID nodeID) const
 {
-    if (auto* n = graph.getNodeForId (nodeID))        
+    if (auto* n = getNodeForId (nodeID))
         return { static_cast<double> (n->properties ["x"]),
                  static_cast<double> (n->properties ["y"]) };
     
@@ -188,7 +664,8 @@ void FilterGraph::clear()
 {
     closeAnyOpenPluginWindows();
     graph.clear();
-    changed();
+    rebuildNodeIndex();
+    markTopologyChanged();
 }
 
 PluginWindow* FilterGraph::getOrCreateWindowFor (AudioProcessorGraph::Node* node, PluginWindow::Type type)
@@ -205,7 +682,7 @@ PluginWindow* FilterGraph::getOrCreateWindowFor (AudioProcessorGraph::Node* node
         {
             auto description = plugin->getPluginDescription();
 
-            if (description.pluginFormatName == "Internal")
+            if (description.pluginFormatName == "Internal" && ! processor->hasEditor())
             {
                 getCommandManager().invokeDirectly (CommandIDs::showAudioSettings, false);
                 return nullptr;
@@ -219,6 +696,13 @@ PluginWindow* FilterGraph::getOrCreateWindowFor (AudioProcessorGraph::Node* node
     return nullptr;
 }
 
+void FilterGraph::closeCurrentlyOpenWindowsFor (AudioProcessorGraph::NodeID nodeID)
+{
+    for (int i = activePluginWindows.size(); --i >= 0;)
+        if (activePluginWindows.getUnchecked (i)->node->nodeID == nodeID)
+            activePluginWindows.remove (i);
+}
+
 bool FilterGraph::closeAnyOpenPluginWindows()
 {
     bool wasEmpty = activePluginWindows.isEmpty();
@@ -245,6 +729,7 @@ void FilterGraph::newDocument()
     //addPlugin (internalFormat.audioInDesc,  { 0.5,  0.1 });
     addPlugin (internalFormat.midiInDesc,   { 0.25, 0.1 });
     addPlugin (internalFormat.audioOutDesc, { 0.5,  0.9 });
+    addPlugin (internalFormat.layerMixerDesc, { 0.5, 0.7 });
 
     setChangedFlag (false);
 }
@@ -353,6 +838,22 @@ static XmlElement* createBusLayoutXml (const AudioProcessor::BusesLayout& layout
     return xml;
 }
 
+static bool isSamePlugin (const XmlElement& a, const XmlElement& b)
+{
+    PluginDescription descA, descB;
+
+    forEachXmlChildElement (a, e)
+        if (descA.loadFromXml (*e))
+            break;
+
+    forEachXmlChildElement (b, e)
+        if (descB.loadFromXml (*e))
+            break;
+
+    return descA.isDuplicateOf (descB)
+            && a.getIntAttribute ("oversampling", 1) == b.getIntAttribute ("oversampling", 1);
+}
+
 static XmlElement* createNodeXml (AudioProcessorGraph::Node* const node) noexcept
 {
     if (auto* plugin = dynamic_cast<AudioPluginInstance*> (node->getProcessor()))
@@ -362,6 +863,12 @@ static XmlElement* createNodeXml (AudioProcessorGraph::Node* const node) noexcep
         e->setAttribute ("x", node->properties ["x"].toString());
         e->setAttribute ("y", node->properties ["y"].toString());
 
+        if (node->properties.contains ("slot"))
+            e->setAttribute ("slot", (int) node->properties ["slot"]);
+
+        if (auto* wrapper = dynamic_cast<OversamplingWrapper*> (TimedPluginWrapper::unwrap (plugin)))
+            e->setAttribute ("oversampling", wrapper->getFactor());
+
         for (int i = 0; i < (int) PluginWindow::Type::numTypes; ++i)
         {
             auto type = (PluginWindow::Type) i;
@@ -410,6 +917,11 @@ void FilterGraph::createNodeFromXml (const XmlElement& xml)
     }
 
     String errorMessage;
+    auto startTime = Time::getMillisecondCounterHiRes();
+
+    // sessions saved before slots existed just fill them up in order
+    auto slot = xml.hasAttribute ("slot") ? xml.getIntAttribute ("slot")
+                                          : (pd.pluginFormatName != "Internal" ? getFirstFreeSlot() : -1);
 
     if (auto* instance = formatManager.createPluginInstance (pd, graph.getSampleRate(),
                                                              graph.getBlockSize(), errorMessage))
@@ -424,8 +936,23 @@ void FilterGraph::createNodeFromXml (const XmlElement& xml)
             instance->setBusesLayout (layout);
         }
 
-        if (auto node = graph.addNode (instance, (NodeID) xml.getIntAttribute ("uid")))
+        AudioPluginInstance* processor = instance;
+        auto factor = xml.getIntAttribute ("oversampling", 1);
+
+        if (OversamplingWrapper::isValidFactor (factor))
+            processor = new OversamplingWrapper (instance, factor);
+
+        if (isPositiveAndBelow (slot, (int) numSlots))
+            processor = new TimedPluginWrapper (processor, slotLoads[slot]);
+
+        auto uid = (NodeID) xml.getIntAttribute ("uid");
+        moveTapsAwayFrom (uid);
+
+        if (auto node = graph.addNode (processor, uid))
         {
+            indexNode (node);
+            assignSlot (node, slot);
+
             if (auto* state = xml.getChildByName ("STATE"))
             {
                 MemoryBlock m;
@@ -434,6 +961,8 @@ void FilterGraph::createNodeFromXml (const XmlElement& xml)
                 node->getProcessor()->setStateInformation (m.getData(), (int) m.getSize());
             }
 
+            pluginLoadTimes.record ((Time::getMillisecondCounterHiRes() - startTime) * 0.001);
+
             node->properties.set ("x", xml.getDoubleAttribute ("x"));
             node->properties.set ("y", xml.getDoubleAttribute ("y"));
 
@@ -460,15 +989,66 @@ void FilterGraph::createNodeFromXml (const XmlElement& xml)
     }
 }
 
+//==============================================================================
+int FilterGraph::getOversamplingFactor (NodeID nodeID) const
+{
+    if (auto* node = getNodeForId (nodeID))
+        if (auto* wrapper = dynamic_cast<OversamplingWrapper*> (TimedPluginWrapper::unwrap (node->getProcessor())))
+            return wrapper->getFactor();
+
+    return 1;
+}
+
+bool FilterGraph::setOversamplingFactor (NodeID nodeID, int factor)
+{
+    auto* node = getNodeForId (nodeID);
+
+    if (node == nullptr || getOversamplingFactor (nodeID) == factor
+         || (factor != 1 && ! OversamplingWrapper::isValidFactor (factor)))
+        return false;
+
+    // the graph can't swap the processor inside a node, so the plugin is rebuilt from
+    // its saved form with the new factor, under the same ID and with the same wiring
+    ScopedPointer<XmlElement> xml (createNodeXml (node));
+
+    if (xml == nullptr)
+        return false;
+
+    xml->setAttribute ("oversampling", factor);
+
+    Array<AudioProcessorGraph::Connection> connections;
+
+    for (auto& c : graph.getConnections())
+        if (c.source.nodeID == nodeID || c.destination.nodeID == nodeID)
+            connections.add (c);
+
+    // the slot's router stays, and is reconnected to the new node below
+    closeCurrentlyOpenWindowsFor (nodeID);
+    removeSingleNode (nodeID);
+    createNodeFromXml (*xml);
+
+    for (auto& c : connections)
+        graph.addConnection (c);
+
+    changed();
+
+    return getNodeForId (nodeID) != nullptr;
+}
+
 XmlElement* FilterGraph::createXml() const
 {
     auto* xml = new XmlElement ("FILTERGRAPH");
 
+    // the taps aren't plugins, and are rebuilt by the graph after a restore
     for (auto* node : graph.getNodes())
-        xml->addChildElement (createNodeXml (node));
+        if (dynamic_cast<AudioPluginInstance*> (node->getProcessor()) != nullptr)
+            xml->addChildElement (createNodeXml (node));
 
     for (auto& connection : graph.getConnections())
     {
+        if (connection.destination.nodeID == meterTapID || connection.destination.nodeID == recorderTapID)
+            continue;
+
         auto e = xml->createNewChildElement ("CONNECTION");
 
         e->setAttribute ("srcFilter", (int) connection.source.nodeID);
@@ -487,9 +1067,10 @@ void FilterGraph::restoreFromXml (const XmlElement& xml)
     forEachXmlChildElementWithTagName (xml, e, "FILTER")
     {
         createNodeFromXml (*e);
-        changed();
     }
 
+    markTopologyChanged();
+
     forEachXmlChildElementWithTagName (xml, e, "CONNECTION")
     {
         graph.addConnection ({ { (NodeID) e->getIntAttribute ("srcFilter"), e->getIntAttribute ("srcChannel") },
@@ -497,4 +1078,111 @@ void FilterGraph::restoreFromXml (const XmlElement& xml)
     }
 
     graph.removeIllegalConnections();
+    graphEdited();
+}
+
+void FilterGraph::updateFromXml (const XmlElement& xml)
+{
+    std::unordered_set<NodeID> wantedNodes;
+
+    forEachXmlChildElementWithTagName (xml, e, "FILTER")
+        wantedNodes.insert ((NodeID) e->getIntAttribute ("uid"));
+
+    // the taps aren't plugins and are never saved, so they're left for the graph to manage
+    Array<NodeID> unwantedNodes;
+
+    for (auto* node : graph.getNodes())
+        if (wantedNodes.count (node->nodeID) == 0 && dynamic_cast<AudioPluginInstance*> (node->getProcessor()) != nullptr)
+            unwantedNodes.add (node->nodeID);
+
+    // an ID that now belongs to a different plugin, or to the same one wrapped differently,
+    // needs a new node; anything else is brought up to date where it stands
+    forEachXmlChildElementWithTagName (xml, e, "FILTER")
+    {
+        auto nodeID = (NodeID) e->getIntAttribute ("uid");
+        auto* node = getNodeForId (nodeID);
+
+        if (node == nullptr || dynamic_cast<AudioPluginInstance*> (node->getProcessor()) == nullptr)
+            continue;
+
+        ScopedPointer<XmlElement> current (createNodeXml (node));
+
+        if (! isSamePlugin (*current, *e))
+        {
+            unwantedNodes.add (nodeID);
+            continue;
+        }
+
+        if (current->getIntAttribute ("slot", -1) != e->getIntAttribute ("slot", -1))
+        {
+            if (e->hasAttribute ("slot"))
+                node->properties.set ("slot", e->getIntAttribute ("slot"));
+            else
+                node->properties.remove ("slot");
+
+            markNodeChanged (nodeID);
+        }
+
+        auto* state = e->getChildByName ("STATE");
+        auto* currentState = current->getChildByName ("STATE");
+
+        if (state != nullptr && (currentState == nullptr || state->getAllSubText() != currentState->getAllSubText()))
+        {
+            MemoryBlock m;
+            m.fromBase64Encoding (state->getAllSubText());
+            node->getProcessor()->setStateInformation (m.getData(), (int) m.getSize());
+        }
+    }
+
+    for (auto nodeID : unwantedNodes)
+    {
+        closeCurrentlyOpenWindowsFor (nodeID);
+        removeSingleNode (nodeID);
+    }
+
+    forEachXmlChildElementWithTagName (xml, e, "FILTER")
+        if (getNodeForId ((NodeID) e->getIntAttribute ("uid")) == nullptr)
+            createNodeFromXml (*e);
+
+    std::unordered_set<AudioProcessorGraph::Connection, ConnectionHash> wantedConnections;
+
+    forEachXmlChildElementWithTagName (xml, e, "CONNECTION")
+        wantedConnections.insert ({ { (NodeID) e->getIntAttribute ("srcFilter"), e->getIntAttribute ("srcChannel") },
+                                    { (NodeID) e->getIntAttribute ("dstFilter"), e->getIntAttribute ("dstChannel") } });
+
+    for (auto& c : graph.getConnections())
+        if (c.destination.nodeID != meterTapID && c.destination.nodeID != recorderTapID
+             && wantedConnections.count (c) == 0)
+            graph.removeConnection (c);
+
+    for (auto& c : wantedConnections)
+        if (! graph.isConnected (c))
+            graph.addConnection (c);
+
+    rebuildNodeIndex();
+    markTopologyChanged();
+}
+
+//==============================================================================
+void FilterGraph::Graph::setMidiSource (MidiSource* newSource)
+{
+    const ScopedLock sl (getCallbackLock());
+    midiSource = newSource;
+}
+
+// the player holds the callback lock around these, so the source can't change underneath them
+void FilterGraph::Graph::processBlock (AudioBuffer<float>& buffer, MidiBuffer& midiMessages)
+{
+    if (midiSource != nullptr)
+        midiSource->addNextBlockOfMessages (midiMessages, buffer.getNumSamples());
+
+    AudioProcessorGraph::processBlock (buffer, midiMessages);
+}
+
+void FilterGraph::Graph::processBlock (AudioBuffer<double>& buffer, MidiBuffer& midiMessages)
+{
+    if (midiSource != nullptr)
+        midiSource->addNextBlockOfMessages (midiMessages, buffer.getNumSamples());
+
+    AudioProcessorGraph::processBlock (buffer, midiMessages);
 }
@@ -27,6 +27,14 @@
 #pragma once
 
 #include "PluginWindow.h"
+#include "HostMetrics.h"
+#include "LevelMeter.h"
+#include "MasterRecorder.h"
+#include "Oversampler.h"
+#include "SpectrumAnalyser.h"
+#include <unordered_map>
+#include <unordered_set>
+#include <atomic>
 
 //==============================================================================
 /**
@@ -34,7 +42,9 @@
 */
 class FilterGraph   : public FileBasedDocument,
                       public AudioProcessorListener,
-                      private ChangeListener
+                      private ChangeListener,
+                      private AsyncUpdater,
+                      private Timer
 {
 public:
     //==============================================================================
@@ -44,16 +54,86 @@ public:
     //==============================================================================
     typedef AudioProcessorGraph::NodeID NodeID;
 
+    /** The number of plugin slots the panel can show. */
+    enum { numSlots = 18 };
 
-    void addPlugin (const PluginDescription&, Point<double>);
-    
+    struct ConnectionHash
+    {
+        size_t operator() (const AudioProcessorGraph::Connection& c) const noexcept
+        {
+            auto h = (size_t) c.source.nodeID;
+            h = h * 31 + (size_t) c.source.channelIndex;
+            h = h * 31 + (size_t) c.destination.nodeID;
+            return h * 31 + (size_t) c.destination.channelIndex;
+        }
+    };
 
-    
+    //==============================================================================
+    /** Everything that changed in the graph since the last Delta was sent. */
+    struct Delta
+    {
+        Array<NodeID> nodesAdded, nodesRemoved, nodesChanged;
+        Array<AudioProcessorGraph::Connection> connectionsAdded, connectionsRemoved;
+
+        bool isEmpty() const noexcept
+        {
+            return nodesAdded.isEmpty() && nodesRemoved.isEmpty() && nodesChanged.isEmpty()
+                    && connectionsAdded.isEmpty() && connectionsRemoved.isEmpty();
+        }
+    };
+
+    /** Receives graph changes, coalesced to at most one Delta per UI frame. */
+    struct Listener
+    {
+        virtual ~Listener() {}
+        virtual void filterGraphChanged (const Delta&) = 0;
+    };
+
+    void addListener (Listener*);
+    void removeListener (Listener*);
+
+    /** Adds a plugin, putting it in the given slot if that's a valid slot index. */
+    void addPlugin (const PluginDescription&, Point<double>, int slot = -1);
+
+    /** Removes a node, keeping the slot table and lookups in sync. */
+    bool removeNode (NodeID);
+
+    AudioProcessorGraph::Node* getNodeForId (NodeID) const;
     AudioProcessorGraph::Node::Ptr getNodeForName (const String& name) const;
 
+    //==============================================================================
+    AudioProcessorGraph::Node* getNodeForSlot (int slot) const;
+    int getSlotForNode (NodeID) const;
+    int getFirstFreeSlot() const;
+
+    /** Runs a node's plugin at 1, 2, 4 or 8 times the graph's rate. Changing it reloads
+        the plugin from its saved state, keeping its ID, slot and connections.
+    */
+    bool setOversamplingFactor (NodeID, int factor);
+    int getOversamplingFactor (NodeID) const;
+
     void setNodePosition (NodeID, Point<double>);
     Point<double> getNodePosition (NodeID) const;
 
+    /** The levels of whatever is loaded into a slot, and of the master output. */
+    LevelMeter& getSlotMeter (int slot) noexcept        { return meters[jlimit (0, (int) numSlots - 1, slot)]; }
+    LevelMeter& getMasterMeter() noexcept               { return meters[numSlots]; }
+
+    /** Watches one slot, or the master at index numSlots, through the meter tap. */
+    SpectrumAnalyser& getAnalyser() noexcept            { return analyser; }
+
+    /** Records whatever the output node plays. */
+    MasterRecorder& getRecorder() noexcept              { return recorder; }
+
+    /** How much of the audio thread whatever is loaded into a slot has been taking. */
+    const ProcessLoad& getSlotLoad (int slot) const noexcept    { return slotLoads[jlimit (0, (int) numSlots - 1, slot)]; }
+
+    /** How long plugins have taken to load, from asking for one to its node being ready. */
+    const TimingHistogram& getPluginLoadTimes() const noexcept  { return pluginLoadTimes; }
+
+    /** Applies any topology changes still waiting for the message loop, for callers that don't run one. */
+    void flushPendingChanges()                          { handleUpdateNowIfNeeded(); }
+
     //==============================================================================
     void clear();
 
@@ -62,13 +142,21 @@ public:
     bool closeAnyOpenPluginWindows();
 
     //==============================================================================
-    void audioProcessorParameterChanged (AudioProcessor*, int, float) override {}
-    void audioProcessorChanged (AudioProcessor*) override { changed(); }
+    /** Each node's processor reports to the graph, so its changes reach the next Delta. */
+    void audioProcessorParameterChanged (AudioProcessor*, int, float) override;
+    void audioProcessorChanged (AudioProcessor*) override;
 
     //==============================================================================
     XmlElement* createXml() const;
     void restoreFromXml (const XmlElement& xml);
 
+    /** Makes the graph's nodes and connections match a saved graph, only creating the nodes
+        it doesn't already have. A node that's in both keeps its plugin if it's still the same
+        plugin with the same oversampling, and takes the saved slot and state; otherwise it's
+        rebuilt from the saved graph.
+    */
+    void updateFromXml (const XmlElement& xml);
+
     static const char* getFilenameSuffix()      { return ".filtergraph"; }
     static const char* getFilenameWildcard()    { return "*.filtergraph"; }
 
@@ -81,7 +169,36 @@ public:
     void setLastDocumentOpened (const File& file) override;
 
     //==============================================================================
-    AudioProcessorGraph graph;
+    /** Something outside the graph that adds its own MIDI to each block it plays.
+        It's called on the audio thread, so it mustn't lock or allocate.
+    */
+    struct MidiSource
+    {
+        virtual ~MidiSource() {}
+        virtual void addNextBlockOfMessages (MidiBuffer&, int numSamples) = 0;
+    };
+
+    /** The graph, which merges a MidiSource's messages into each block before its
+        MIDI input node sees them.
+    */
+    class Graph  : public AudioProcessorGraph
+    {
+    public:
+        Graph() {}
+
+        /** Takes the callback lock, so it's safe while playing. Pass nullptr to remove the source. */
+        void setMidiSource (MidiSource*);
+
+        void processBlock (AudioBuffer<float>&, MidiBuffer&) override;
+        void processBlock (AudioBuffer<double>&, MidiBuffer&) override;
+
+    private:
+        MidiSource* midiSource = nullptr;
+
+        JUCE_DECLARE_NON_COPYABLE (Graph)
+    };
+
+    Graph graph;
 
 private:
     //==============================================================================
@@ -92,8 +209,67 @@ private:
     NodeID lastUID = 0;
     NodeID getNextUID() noexcept;
 
+    struct StringHash
+    {
+        size_t operator() (const String& s) const noexcept     { return (size_t) s.hashCode64(); }
+    };
+
+    // The graph only offers linear searches, so these are kept alongside it. Anything in
+    // this class that takes a node out of the graph must do it with removeNode() or
+    // removeSingleNode(), which resync them. They hold references rather than raw pointers, so a node removed
+    // from the graph directly stays alive and merely findable until the graph's change
+    // message triggers a full resync.
+    std::unordered_map<NodeID, AudioProcessorGraph::Node::Ptr> nodesByID;
+    std::unordered_map<String, AudioProcessorGraph::Node::Ptr, StringHash> nodesByName;
+    std::unordered_map<AudioProcessor*, NodeID> nodesByProcessor;
+    NodeID slotNodes[numSlots] = {};
+
+    // one meter per slot plus the master, fed by a tap node that the graph keeps in
+    // step with the slots and the output node's connections
+    LevelMeter meters[numSlots + 1];
+    NodeID meterTapID = 0;
+    SpectrumAnalyser analyser;
+
+    MasterRecorder recorder;
+    NodeID recorderTapID = 0;
+
+    // slotted plugins are loaded inside a TimedPluginWrapper that reports to these
+    ProcessLoad slotLoads[numSlots];
+    TimingHistogram pluginLoadTimes { 0.01, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0 };
+
+    // what the listeners were last told about, so the next Delta can be worked out
+    ListenerList<Listener> listeners;
+    std::unordered_set<NodeID> knownNodes;
+    std::unordered_set<AudioProcessorGraph::Connection, ConnectionHash> knownConnections;
+    std::unordered_set<NodeID> pendingChangedNodes;
+    bool topologyChanged = false;
+
+    // processors may announce changes from any thread, so those are parked here without
+    // locking or allocating until the message thread picks them up
+    enum { maxOffThreadChanges = 32 };
+    std::atomic<AudioProcessor*> offThreadChanges[maxOffThreadChanges];
+    std::atomic<bool> offThreadOverflow { false };
+
+    void markNodeChanged (NodeID);
+    void markTopologyChanged();
+    void handleAsyncUpdate() override;
+    void timerCallback() override;
+    void sendDelta();
+
+    void indexNode (AudioProcessorGraph::Node*);
+    void rebuildNodeIndex();
+    bool removeSingleNode (NodeID);
+    void assignSlot (AudioProcessorGraph::Node*, int slot);
+    AudioProcessorGraph::Node* addMidiRouterFor (AudioProcessorGraph::Node&);
+    AudioProcessorGraph::Node* getAudioOutputNode() const;
+    void graphEdited();
+    void updateMasterStage();
+    void updateMeterTaps();
+    void updateRecorderTap();
+    void moveTapsAwayFrom (NodeID);
+
     void createNodeFromXml (const XmlElement& xml);
-    void addFilterCallback (AudioPluginInstance*, const String& error, Point<double>);
+    AudioProcessorGraph::Node* addFilterCallback (AudioPluginInstance*, const String& error, Point<double>);
     void changeListenerCallback (ChangeBroadcaster*) override;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FilterGraph)
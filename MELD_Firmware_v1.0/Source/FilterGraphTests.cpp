@@ -0,0 +1,198 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "FilterGraph.h"
+#include "InternalFilters.h"
+#include "Oversampler.h"
+
+
+//==============================================================================
+class FilterGraphTests  : public UnitTest
+{
+public:
+    FilterGraphTests()  : UnitTest ("FilterGraph") {}
+
+    void runTest() override
+    {
+        AudioPluginFormatManager formatManager;
+        formatManager.addFormat (new InternalPluginFormat());
+
+        InternalPluginFormat internalFormat;
+
+        beginTest ("Lookups follow a restored graph");
+        {
+            FilterGraph graph (formatManager);
+            restore (graph, internalFormat);
+
+            expect (graph.getNodeForId (midiInID) != nullptr);
+            expect (graph.getNodeForId (audioOutID) != nullptr);
+            expect (graph.getNodeForId (audioOutID + 1) == nullptr);
+
+            auto named = graph.getNodeForName (internalFormat.audioOutDesc.name.toUpperCase());
+            expect (named != nullptr && named->nodeID == audioOutID);
+
+            auto* inSlot = graph.getNodeForSlot (audioOutSlot);
+            expect (inSlot != nullptr && inSlot->nodeID == audioOutID);
+            expectEquals (graph.getSlotForNode (audioOutID), (int) audioOutSlot);
+            expectEquals (graph.getSlotForNode (midiInID), -1);
+            expectEquals (graph.getFirstFreeSlot(), 0);
+        }
+
+        beginTest ("Removing a node takes it out of every lookup");
+        {
+            FilterGraph graph (formatManager);
+            restore (graph, internalFormat);
+
+            expect (graph.removeNode (audioOutID));
+
+            expect (graph.getNodeForId (audioOutID) == nullptr);
+            expect (graph.getNodeForName (internalFormat.audioOutDesc.name) == nullptr);
+            expect (graph.getNodeForSlot (audioOutSlot) == nullptr);
+            expectEquals (graph.getSlotForNode (audioOutID), -1);
+            expect (graph.getNodeForId (midiInID) != nullptr);
+
+            expect (! graph.removeNode (audioOutID));
+        }
+
+        beginTest ("Changing a node's oversampling leaves every lookup on the new node");
+        {
+            FilterGraph graph (formatManager);
+
+            XmlElement xml ("FILTERGRAPH");
+            xml.addChildElement (createFilterXml (internalFormat.looperDesc, looperID, looperSlot));
+            graph.restoreFromXml (xml);
+
+            expect (graph.getNodeForId (looperID) != nullptr);
+            expect (graph.setOversamplingFactor (looperID, 2));
+            expectEquals (graph.getOversamplingFactor (looperID), 2);
+
+            // the old node is gone, so anything still finding it would see an unwrapped looper
+            auto isWrapped = [] (AudioProcessorGraph::Node* node)
+            {
+                return node != nullptr && dynamic_cast<OversamplingWrapper*> (node->getProcessor()) != nullptr;
+            };
+
+            expect (isWrapped (graph.getNodeForId (looperID)));
+            expect (isWrapped (graph.getNodeForName (internalFormat.looperDesc.name).get()));
+            expect (isWrapped (graph.getNodeForSlot (looperSlot)));
+            expectEquals (graph.getSlotForNode (looperID), (int) looperSlot);
+        }
+
+        beginTest ("A parameter change is sent as a delta naming its node");
+        {
+            FilterGraph graph (formatManager);
+            restore (graph, internalFormat);
+
+            auto* processor = new ParameterProcessor();
+            auto node = graph.graph.addNode (processor);
+            expect (node != nullptr);
+
+            DeltaCollector collector;
+            graph.addListener (&collector);
+
+            // lets the graph's change message index the new node and announce it
+            dispatchUntil ([&] { return collector.addedNodes.contains (node->nodeID); });
+            expect (graph.getNodeForId (node->nodeID) != nullptr);
+            collector.changedNodes.clear();
+
+            processor->gain->setValueNotifyingHost (0.25f);
+            dispatchUntil ([&] { return collector.changedNodes.contains (node->nodeID); });
+
+            expect (collector.changedNodes.contains (node->nodeID));
+            expect (! collector.changedNodes.contains (audioOutID));
+
+            graph.removeListener (&collector);
+        }
+    }
+
+private:
+    enum { midiInID = 3, audioOutID = 7, audioOutSlot = 5, looperID = 11, looperSlot = 0 };
+
+    struct ParameterProcessor  : public AudioProcessor
+    {
+        ParameterProcessor()    { addParameter (gain = new AudioParameterFloat ("gain", "Gain", 0.0f, 1.0f, 1.0f)); }
+
+        const String getName() const override                               { return "Parameter Test"; }
+        void prepareToPlay (double, int) override                           {}
+        void releaseResources() override                                    {}
+        void processBlock (AudioBuffer<float>&, MidiBuffer&) override       {}
+        double getTailLengthSeconds() const override                        { return 0.0; }
+        bool acceptsMidi() const override                                   { return false; }
+        bool producesMidi() const override                                  { return false; }
+        AudioProcessorEditor* createEditor() override                       { return nullptr; }
+        bool hasEditor() const override                                     { return false; }
+        int getNumPrograms() override                                       { return 1; }
+        int getCurrentProgram() override                                    { return 0; }
+        void setCurrentProgram (int) override                               {}
+        const String getProgramName (int) override                          { return {}; }
+        void changeProgramName (int, const String&) override                {}
+        void getStateInformation (MemoryBlock&) override                    {}
+        void setStateInformation (const void*, int) override                {}
+
+        AudioParameterFloat* gain;
+    };
+
+    struct DeltaCollector  : public FilterGraph::Listener
+    {
+        void filterGraphChanged (const FilterGraph::Delta& delta) override
+        {
+            addedNodes.addArray (delta.nodesAdded);
+            changedNodes.addArray (delta.nodesChanged);
+        }
+
+        Array<FilterGraph::NodeID> addedNodes, changedNodes;
+    };
+
+    static void dispatchUntil (std::function<bool()> done)
+    {
+        for (int i = 0; i < 100 && ! done(); ++i)
+            MessageManager::getInstance()->runDispatchLoopUntil (10);
+    }
+
+    static void restore (FilterGraph& graph, InternalPluginFormat& internalFormat)
+    {
+        XmlElement xml ("FILTERGRAPH");
+        xml.addChildElement (createFilterXml (internalFormat.midiInDesc, midiInID, -1));
+        xml.addChildElement (createFilterXml (internalFormat.audioOutDesc, audioOutID, audioOutSlot));
+
+        graph.restoreFromXml (xml);
+    }
+
+    static XmlElement* createFilterXml (const PluginDescription& desc, int uid, int slot)
+    {
+        auto* e = new XmlElement ("FILTER");
+        e->setAttribute ("uid", uid);
+
+        if (slot >= 0)
+            e->setAttribute ("slot", slot);
+
+        e->addChildElement (desc.createXml());
+        return e;
+    }
+};
+
+static FilterGraphTests filterGraphTests;
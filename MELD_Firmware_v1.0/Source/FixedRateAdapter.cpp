@@ -0,0 +1,229 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "FixedRateAdapter.h"
+
+
+//==============================================================================
+/** Describes the graph's side of the adapter to the player, which only looks at
+    the rate, block size and channel counts.
+*/
+struct FixedRateAdapter::InternalDevice  : public AudioIODevice
+{
+    InternalDevice (double rate, int block, int ins, int outs)
+        : AudioIODevice ("Internal", "Internal"),
+          sampleRate (rate), blockSize (block), numIns (ins), numOuts (outs)
+    {
+    }
+
+    StringArray getOutputChannelNames() override                { return {}; }
+    StringArray getInputChannelNames() override                 { return {}; }
+    Array<double> getAvailableSampleRates() override            { return { sampleRate }; }
+    Array<int> getAvailableBufferSizes() override               { return { blockSize }; }
+    int getDefaultBufferSize() override                         { return blockSize; }
+
+    String open (const BigInteger&, const BigInteger&, double, int) override   { return {}; }
+    void close() override                                       {}
+    bool isOpen() override                                      { return true; }
+    void start (AudioIODeviceCallback*) override                {}
+    void stop() override                                        {}
+    bool isPlaying() override                                   { return true; }
+    String getLastError() override                              { return {}; }
+
+    int getCurrentBufferSizeSamples() override                  { return blockSize; }
+    double getCurrentSampleRate() override                      { return sampleRate; }
+    int getCurrentBitDepth() override                           { return 32; }
+    BigInteger getActiveOutputChannels() const override         { return getChannelMask (numOuts); }
+    BigInteger getActiveInputChannels() const override          { return getChannelMask (numIns); }
+    int getOutputLatencyInSamples() override                    { return 0; }
+    int getInputLatencyInSamples() override                     { return 0; }
+
+    static BigInteger getChannelMask (int numChannels)
+    {
+        BigInteger mask;
+        mask.setRange (0, numChannels, true);
+        return mask;
+    }
+
+    const double sampleRate;
+    const int blockSize, numIns, numOuts;
+};
+
+//==============================================================================
+static void discardFromStart (AudioBuffer<float>& queue, int& numQueued, int num) noexcept
+{
+    num = jmin (num, numQueued);
+    numQueued -= num;
+
+    if (num > 0 && numQueued > 0)
+        for (int ch = 0; ch < queue.getNumChannels(); ++ch)
+            std::memmove (queue.getWritePointer (ch), queue.getReadPointer (ch, num), sizeof (float) * (size_t) numQueued);
+}
+
+//==============================================================================
+FixedRateAdapter::FixedRateAdapter (AudioIODeviceCallback& p)  : player (p)
+{
+}
+
+FixedRateAdapter::~FixedRateAdapter() {}
+
+void FixedRateAdapter::setInternalRate (double newRate)
+{
+    internalRate = jmax (0.0, newRate);
+}
+
+double FixedRateAdapter::getAddedLatencySeconds() const noexcept
+{
+    if (! resampling || deviceRate <= 0)
+        return 0;
+
+    return inputResampler.getLatencyInInputFrames() / deviceRate
+             + (outputResampler.getLatencyInInputFrames() + internalBlockSize) / internalRate;
+}
+
+//==============================================================================
+void FixedRateAdapter::audioDeviceAboutToStart (AudioIODevice* device)
+{
+    resampling = internalRate > 0;
+
+    if (! resampling)
+    {
+        playerPrepared = false;
+        player.audioDeviceAboutToStart (device);
+        return;
+    }
+
+    deviceRate = device->getCurrentSampleRate();
+    auto ins  = device->getActiveInputChannels().countNumberOfSetBits();
+    auto outs = device->getActiveOutputChannels().countNumberOfSetBits();
+
+    // the graph only needs preparing again if its own side of the adapter has changed
+    if (! playerPrepared || preparedRate != internalRate || ins != numInputs || outs != numOutputs)
+    {
+        InternalDevice internalDevice (internalRate, internalBlockSize, ins, outs);
+        player.audioDeviceAboutToStart (&internalDevice);
+
+        playerPrepared = true;
+        preparedRate = internalRate;
+        numInputs = ins;
+        numOutputs = outs;
+    }
+
+    inputResampler.prepare (deviceRate, internalRate, numInputs);
+    outputResampler.prepare (internalRate, deviceRate, numOutputs);
+
+    // room for a device block's worth at the internal rate, a graph block, and the filters' lookahead
+    auto perDeviceBlock = (int) std::ceil (device->getCurrentBufferSizeSamples() * internalRate / deviceRate);
+    auto capacity = 2 * (perDeviceBlock + internalBlockSize + outputResampler.getLatencyInInputFrames()) + 16;
+
+    inputQueue.setSize (jmax (1, numInputs), capacity);
+    outputQueue.setSize (jmax (1, numOutputs), capacity);
+    inputQueue.clear();
+    outputQueue.clear();
+    inputQueued = outputQueued = 0;
+
+    readPointers.calloc ((size_t) jmax (1, numInputs, numOutputs));
+    writePointers.calloc ((size_t) jmax (1, numInputs, numOutputs));
+}
+
+void FixedRateAdapter::audioDeviceStopped()
+{
+    // the graph stays prepared at the internal rate, ready for whichever device comes next
+    if (! resampling)
+        player.audioDeviceStopped();
+}
+
+void FixedRateAdapter::audioDeviceError (const String& errorMessage)
+{
+    player.audioDeviceError (errorMessage);
+}
+
+//==============================================================================
+void FixedRateAdapter::audioDeviceIOCallback (const float** inputChannelData, int numInputChannels,
+                                              float** outputChannelData, int numOutputChannels, int numSamples)
+{
+    if (! resampling)
+    {
+        player.audioDeviceIOCallback (inputChannelData, numInputChannels, outputChannelData, numOutputChannels, numSamples);
+        return;
+    }
+
+    int consumed = 0;
+
+    if (numInputs > 0 && numInputChannels >= numInputs)
+    {
+        for (int ch = 0; ch < numInputs; ++ch)
+            writePointers[ch] = inputQueue.getWritePointer (ch, inputQueued);
+
+        inputQueued += inputResampler.process (inputChannelData, numSamples, writePointers,
+                                               inputQueue.getNumSamples() - inputQueued, consumed);
+    }
+
+    auto needed = outputResampler.getNumInputsNeeded (numSamples);
+
+    while (outputQueued < needed && outputQueued + internalBlockSize <= outputQueue.getNumSamples())
+        runGraphBlock();
+
+    int produced = 0;
+
+    if (numOutputs > 0 && numOutputChannels >= numOutputs)
+    {
+        for (int ch = 0; ch < numOutputs; ++ch)
+            readPointers[ch] = outputQueue.getReadPointer (ch);
+
+        produced = outputResampler.process (readPointers, outputQueued, outputChannelData, numSamples, consumed);
+        discardFromStart (outputQueue, outputQueued, consumed);
+    }
+
+    for (int ch = 0; ch < numOutputChannels; ++ch)
+        if (outputChannelData[ch] != nullptr)
+            FloatVectorOperations::clear (outputChannelData[ch] + produced, numSamples - produced);
+}
+
+void FixedRateAdapter::runGraphBlock() noexcept
+{
+    // at start-up the input can be a few frames short, so it's padded with silence
+    if (inputQueued < internalBlockSize)
+    {
+        for (int ch = 0; ch < inputQueue.getNumChannels(); ++ch)
+            FloatVectorOperations::clear (inputQueue.getWritePointer (ch, inputQueued), internalBlockSize - inputQueued);
+
+        inputQueued = internalBlockSize;
+    }
+
+    for (int ch = 0; ch < numInputs; ++ch)
+        readPointers[ch] = inputQueue.getReadPointer (ch);
+
+    for (int ch = 0; ch < numOutputs; ++ch)
+        writePointers[ch] = outputQueue.getWritePointer (ch, outputQueued);
+
+    player.audioDeviceIOCallback (readPointers, numInputs,
+                                  writePointers, numOutputs, internalBlockSize);
+
+    discardFromStart (inputQueue, inputQueued, internalBlockSize);
+    outputQueued += internalBlockSize;
+}
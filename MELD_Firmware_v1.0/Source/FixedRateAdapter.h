@@ -0,0 +1,93 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "PolyphaseResampler.h"
+
+
+//==============================================================================
+/**
+    Sits between the audio device and the graph's player, and can run the graph at
+    a fixed rate of its own.
+
+    With an internal rate set, the device's input is resampled to that rate, the
+    graph is run in fixed-size blocks, and its output is resampled back. The player
+    is only prepared again when the internal side changes. Switching interfaces or
+    device rates just rebuilds the resamplers, so the plugins never notice.
+
+    With no internal rate, every call goes straight through to the player.
+*/
+class FixedRateAdapter  : public AudioIODeviceCallback
+{
+public:
+    FixedRateAdapter (AudioIODeviceCallback& player);
+    ~FixedRateAdapter();
+
+    /** 0 lets the graph follow the device. Only call this while the adapter isn't
+        registered with a device manager.
+    */
+    void setInternalRate (double newRate);
+    double getInternalRate() const noexcept                 { return internalRate; }
+
+    enum { internalBlockSize = 128 };
+
+    /** What the resamplers' filters and the fixed blocks add to the round trip, or 0 when
+        the graph is following the device.
+    */
+    double getAddedLatencySeconds() const noexcept;
+
+    //==============================================================================
+    void audioDeviceAboutToStart (AudioIODevice*) override;
+    void audioDeviceIOCallback (const float** inputChannelData, int numInputChannels,
+                                float** outputChannelData, int numOutputChannels, int numSamples) override;
+    void audioDeviceStopped() override;
+    void audioDeviceError (const String&) override;
+
+private:
+    //==============================================================================
+    struct InternalDevice;
+
+    AudioIODeviceCallback& player;
+    double internalRate = 0;
+    bool resampling = false;
+    double deviceRate = 0;
+
+    // what the player was last prepared with, if it was prepared by this adapter
+    bool playerPrepared = false;
+    double preparedRate = 0;
+    int numInputs = 0, numOutputs = 0;
+
+    PolyphaseResampler inputResampler, outputResampler;
+    AudioBuffer<float> inputQueue, outputQueue;
+    int inputQueued = 0, outputQueued = 0;
+    HeapBlock<const float*> readPointers;
+    HeapBlock<float*> writePointers;
+
+    void runGraphBlock() noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FixedRateAdapter)
+};
@@ -0,0 +1,356 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "MainHostWindow.h"
+#include "InternalFilters.h"
+#include "Statistics.h"
+#include "ToolSupport.h"
+#include <iostream>
+
+/*
+    Times the graph's editing and persistence paths, which never show up in the
+    audio thread's numbers:
+
+        MeldGraphBench [--nodes 4,16,64,128,256,500] [--state 1024,65536,1048576,16777216]
+                       [--iterations 5] [--max-state-mb 256] [--output results.json]
+
+    Every combination of node count and per-node state size is run, apart from those
+    whose total state would go over the limit, using synthetic plugins that do no
+    processing and hold a block of state of the given size. The results are written
+    as JSON, one entry per scenario and operation.
+*/
+
+//==============================================================================
+/** A plugin that passes audio straight through and keeps a fixed amount of opaque state. */
+class SyntheticPlugin  : public AudioPluginInstance
+{
+public:
+    SyntheticPlugin (size_t numStateBytes)
+        : AudioPluginInstance (BusesProperties().withInput  ("Input",  AudioChannelSet::stereo())
+                                                .withOutput ("Output", AudioChannelSet::stereo())),
+          state (numStateBytes, true)
+    {
+    }
+
+    static const char* const formatName;
+
+    static String getIdentifier (size_t numStateBytes)      { return "synthetic/" + String ((int64) numStateBytes); }
+
+    static PluginDescription getDescription (size_t numStateBytes)
+    {
+        SyntheticPlugin p (0);
+        PluginDescription d;
+        p.fillInPluginDescription (d);
+        d.fileOrIdentifier = getIdentifier (numStateBytes);
+        return d;
+    }
+
+    //==============================================================================
+    const String getName() const override                   { return "Synthetic"; }
+    void prepareToPlay (double, int) override               {}
+    void releaseResources() override                        {}
+    void processBlock (AudioBuffer<float>&, MidiBuffer&) override {}
+    double getTailLengthSeconds() const override            { return 0; }
+    bool acceptsMidi() const override                       { return true; }
+    bool producesMidi() const override                      { return false; }
+    AudioProcessorEditor* createEditor() override           { return nullptr; }
+    bool hasEditor() const override                         { return false; }
+
+    int getNumPrograms() override                           { return 1; }
+    int getCurrentProgram() override                        { return 0; }
+    void setCurrentProgram (int) override                   {}
+    const String getProgramName (int) override              { return {}; }
+    void changeProgramName (int, const String&) override    {}
+
+    void getStateInformation (MemoryBlock& destData) override           { destData = state; }
+    void setStateInformation (const void* data, int size) override      { state.replaceWith (data, (size_t) size); }
+
+    void fillInPluginDescription (PluginDescription& d) const override
+    {
+        d.name              = getName();
+        d.descriptiveName   = getName();
+        d.pluginFormatName  = formatName;
+        d.category          = "Benchmark";
+        d.manufacturerName  = "MELD";
+        d.version           = ProjectInfo::versionString;
+        d.fileOrIdentifier  = getIdentifier (state.getSize());
+        d.uid               = d.fileOrIdentifier.hashCode();
+        d.isInstrument      = false;
+        d.numInputChannels  = getTotalNumInputChannels();
+        d.numOutputChannels = getTotalNumOutputChannels();
+    }
+
+private:
+    MemoryBlock state;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SyntheticPlugin)
+};
+
+const char* const SyntheticPlugin::formatName = "Synthetic";
+
+//==============================================================================
+/** Creates SyntheticPlugins, reading the state size back out of the identifier. */
+class SyntheticPluginFormat   : public AudioPluginFormat
+{
+public:
+    String getName() const override                                                     { return SyntheticPlugin::formatName; }
+    bool fileMightContainThisPluginType (const String&) override                        { return true; }
+    FileSearchPath getDefaultLocationsToSearch() override                               { return {}; }
+    bool canScanForPlugins() const override                                             { return false; }
+    void findAllTypesForFile (OwnedArray <PluginDescription>&, const String&) override  {}
+    bool doesPluginStillExist (const PluginDescription&) override                       { return true; }
+    String getNameOfPluginFromIdentifier (const String& fileOrIdentifier) override      { return fileOrIdentifier; }
+    bool pluginNeedsRescanning (const PluginDescription&) override                      { return false; }
+    StringArray searchPathsForPlugins (const FileSearchPath&, bool, bool) override      { return {}; }
+
+private:
+    void createPluginInstance (const PluginDescription& desc, double, int, void* userData,
+                               void (*callback) (void*, AudioPluginInstance*, const String&)) override
+    {
+        auto numStateBytes = desc.fileOrIdentifier.fromFirstOccurrenceOf ("/", false, false).getLargeIntValue();
+        callback (userData, new SyntheticPlugin ((size_t) jmax ((int64) 0, numStateBytes)), {});
+    }
+
+    bool requiresUnblockedMessageThreadDuringCreation (const PluginDescription&) const noexcept override
+    {
+        return false;
+    }
+};
+
+//==============================================================================
+/** The graph defers some of its own bookkeeping to the message loop, which this tool
+    doesn't run, so every timed operation includes delivering it by hand.
+*/
+static void settle (FilterGraph& filterGraph)
+{
+    filterGraph.graph.dispatchPendingMessages();
+    filterGraph.flushPendingChanges();
+}
+
+//==============================================================================
+class Timings
+{
+public:
+    template <typename Function>
+    void measure (Function&& f)
+    {
+        auto start = Time::getHighResolutionTicks();
+        f();
+        seconds.add (Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start));
+    }
+
+    var toJson (int numNodes, size_t numStateBytes, const String& operation, int64 numBytes = -1) const
+    {
+        double total = 0;
+
+        for (auto s : seconds)
+            total += s;
+
+        auto* result = new DynamicObject();
+        result->setProperty ("operation", operation);
+        result->setProperty ("nodes", numNodes);
+        result->setProperty ("stateBytesPerNode", (int64) numStateBytes);
+        result->setProperty ("count", seconds.size());
+        result->setProperty ("totalMs", total * 1.0e3);
+        result->setProperty ("meanUs", seconds.isEmpty() ? 0.0 : total * 1.0e6 / seconds.size());
+        result->setProperty ("medianUs", percentile (seconds, 0.5) * 1.0e6);
+        result->setProperty ("p99Us", percentile (seconds, 0.99) * 1.0e6);
+        result->setProperty ("maxUs", percentile (seconds, 1.0) * 1.0e6);
+
+        if (numBytes >= 0)
+            result->setProperty ("bytes", numBytes);
+
+        return var (result);
+    }
+
+private:
+    Array<double> seconds;
+};
+
+//==============================================================================
+static void runScenario (AudioPluginFormatManager& formatManager, int numNodes, size_t numStateBytes,
+                         int iterations, const File& tempFile, Array<var>& results)
+{
+    FilterGraph filterGraph (formatManager);
+    settle (filterGraph);
+
+    Timings adding, connecting, disconnecting, removingIllegal, creatingXml, restoringXml, saving, loading;
+    auto desc = SyntheticPlugin::getDescription (numStateBytes);
+
+    for (int i = 0; i < numNodes; ++i)
+        adding.measure ([&] { filterGraph.addPlugin (desc, { 0.5, (i + 1.0) / (numNodes + 1.0) }); settle (filterGraph); });
+
+    Array<FilterGraph::NodeID> nodes;
+
+    for (auto* node : filterGraph.graph.getNodes())
+        if (dynamic_cast<SyntheticPlugin*> (node->getProcessor()) != nullptr)
+            nodes.add (node->nodeID);
+
+    // a chain through every node, on top of the connections each one gets when it's added
+    Array<AudioProcessorGraph::Connection> chain;
+
+    for (int i = 1; i < nodes.size(); ++i)
+        for (int ch = 0; ch < 2; ++ch)
+            chain.add ({ { nodes[i - 1], ch }, { nodes[i], ch } });
+
+    for (int i = 0; i < iterations; ++i)
+    {
+        for (auto& c : chain)
+            connecting.measure ([&] { filterGraph.graph.addConnection (c); settle (filterGraph); });
+
+        if (i < iterations - 1)
+            for (auto& c : chain)
+                disconnecting.measure ([&] { filterGraph.graph.removeConnection (c); settle (filterGraph); });
+    }
+
+    for (int i = 0; i < iterations; ++i)
+        removingIllegal.measure ([&] { filterGraph.graph.removeIllegalConnections(); settle (filterGraph); });
+
+    ScopedPointer<XmlElement> xml;
+    int64 xmlBytes = 0;
+
+    for (int i = 0; i < iterations; ++i)
+        creatingXml.measure ([&] { xml = filterGraph.createXml(); });
+
+    if (xml != nullptr)
+        xmlBytes = (int64) xml->createDocument ({}).getNumBytesAsUTF8();
+
+    for (int i = 0; i < iterations; ++i)
+        restoringXml.measure ([&] { filterGraph.restoreFromXml (*xml); settle (filterGraph); });
+
+    xml = nullptr;
+
+    for (int i = 0; i < iterations; ++i)
+        saving.measure ([&] { filterGraph.saveDocument (tempFile); });
+
+    auto fileBytes = tempFile.getSize();
+
+    for (int i = 0; i < iterations; ++i)
+        loading.measure ([&] { filterGraph.loadDocument (tempFile); settle (filterGraph); });
+
+    tempFile.deleteFile();
+
+    results.add (adding.toJson (numNodes, numStateBytes, "addPlugin"));
+    results.add (connecting.toJson (numNodes, numStateBytes, "addConnection"));
+    results.add (disconnecting.toJson (numNodes, numStateBytes, "removeConnection"));
+    results.add (removingIllegal.toJson (numNodes, numStateBytes, "removeIllegalConnections"));
+    results.add (creatingXml.toJson (numNodes, numStateBytes, "createXml", xmlBytes));
+    results.add (restoringXml.toJson (numNodes, numStateBytes, "restoreFromXml", xmlBytes));
+    results.add (saving.toJson (numNodes, numStateBytes, "saveDocument", fileBytes));
+    results.add (loading.toJson (numNodes, numStateBytes, "loadDocument", fileBytes));
+}
+
+//==============================================================================
+static void printUsage()
+{
+    std::cerr << "usage: MeldGraphBench [--nodes 4,16,64,128,256,500] [--state 1024,65536,1048576,16777216]" << std::endl
+              << "         [--iterations 5] [--max-state-mb 256] [--output results.json]" << std::endl;
+}
+
+int main (int argc, char* argv[])
+{
+    StringArray args;
+
+    for (int i = 1; i < argc; ++i)
+        args.add (argv[i]);
+
+    Array<int64> nodeCounts { 4, 16, 64, 128, 256, 500 };
+    Array<int64> stateSizes { 1024, 65536, 1048576, 16777216 };
+    int iterations = 5;
+    int64 maxTotalState = 256 * 1024 * 1024;
+    String outputPath;
+
+    for (int i = 0; i < args.size(); ++i)
+    {
+        auto& arg = args[i];
+
+        if (arg == "--nodes")                   nodeCounts = parseList (args[++i]);
+        else if (arg == "--state")              stateSizes = parseList (args[++i]);
+        else if (arg == "--iterations")         iterations = args[++i].getIntValue();
+        else if (arg == "--max-state-mb")       maxTotalState = args[++i].getLargeIntValue() * 1024 * 1024;
+        else if (arg == "--output")             outputPath = args[++i];
+        else                                    { printUsage(); return 1; }
+    }
+
+    if (nodeCounts.isEmpty() || stateSizes.isEmpty() || iterations <= 0)
+    {
+        printUsage();
+        return 1;
+    }
+
+    ScopedJuceInitialiser_GUI juceInitialiser;
+    ToolEnvironment environment ("MELD Graph Benchmark");
+
+    // the graph logs every plugin it adds, which would swamp the results
+    QuietLogger quietLogger;
+    Logger::setCurrentLogger (&quietLogger);
+
+    AudioPluginFormatManager formatManager;
+    formatManager.addFormat (new InternalPluginFormat());
+    formatManager.addFormat (new SyntheticPluginFormat());
+
+    auto tempFile = File::createTempFile (FilterGraph::getFilenameSuffix());
+    Array<var> results;
+
+    for (auto numNodes : nodeCounts)
+    {
+        for (auto numStateBytes : stateSizes)
+        {
+            if (numNodes <= 0 || numStateBytes < 0 || numNodes * numStateBytes > maxTotalState)
+                continue;
+
+            std::cerr << numNodes << " nodes with " << numStateBytes << " bytes of state each..." << std::endl;
+
+            runScenario (formatManager, (int) numNodes, (size_t) numStateBytes, iterations, tempFile, results);
+        }
+    }
+
+    auto* root = new DynamicObject();
+    root->setProperty ("benchmark", "FilterGraph");
+    root->setProperty ("version", ProjectInfo::versionString);
+    root->setProperty ("time", Time::getCurrentTime().toISO8601 (true));
+    root->setProperty ("system", SystemStats::getOperatingSystemName());
+    root->setProperty ("cpus", SystemStats::getNumCpus());
+    root->setProperty ("iterations", iterations);
+    root->setProperty ("results", results);
+
+    auto json = JSON::toString (var (root));
+    Logger::setCurrentLogger (nullptr);
+
+    if (outputPath.isEmpty())
+    {
+        std::cout << json << std::endl;
+    }
+    else if (! File::getCurrentWorkingDirectory().getChildFile (outputPath).replaceWithText (json))
+    {
+        std::cerr << "MeldGraphBench: couldn't write to " << outputPath << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
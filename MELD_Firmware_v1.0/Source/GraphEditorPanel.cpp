@@ -36,7 +36,7 @@ struct GraphEditorPanel::PinComponent   : public Component,
     PinComponent (GraphEditorPanel& p, AudioProcessorGraph::NodeAndChannel pinToUse, bool isIn)
         : panel (p), graph (p.graph), pin (pinToUse), isInput (isIn)
     {
-        if (auto node = graph.graph.getNodeForId (pin.nodeID)) 
+        if (auto node = graph.getNodeForId (pin.nodeID)) 
         {
             String tip;
 
@@ -145,8 +145,6 @@ struct GraphEditorPanel::FilterComponent   : public Component
             graph.setNodePosition (pluginID,
                                    { pos.x / (double) getParentWidth(),
                                      pos.y / (double) getParentHeight() });
-
-            panel.updateComponents();
         }
     }
 
@@ -159,7 +157,7 @@ struct GraphEditorPanel::FilterComponent   : public Component
         else if (e.getNumberOfClicks() == 2)                //GRAPH DOUBLE CLICK
         {
             std::cout << pluginID << std::endl;
-           if (auto f = graph.graph.getNodeForId (pluginID))
+           if (auto f = graph.getNodeForId (pluginID))
                 if (auto* w = graph.getOrCreateWindowFor (f, PluginWindow::Type::normal))
                     w->toFront (true);
             
@@ -189,7 +187,7 @@ struct GraphEditorPanel::FilterComponent   : public Component
 //---------------------------------------------------------------------------------------------------
     void resized() override
     {
-        if (auto f = graph.graph.getNodeForId (pluginID))
+        if (auto f = graph.getNodeForId (pluginID))
         {
             if (auto* processor = f->getProcessor())
             {
@@ -225,7 +223,7 @@ struct GraphEditorPanel::FilterComponent   : public Component
 //---------------------------------------------------------------------------------------------------------------------
     void update()
     {
-        const AudioProcessorGraph::Node::Ptr f (graph.graph.getNodeForId (pluginID));
+        const AudioProcessorGraph::Node::Ptr f (graph.getNodeForId (pluginID));
         jassert (f != nullptr);
         
 
@@ -281,7 +279,7 @@ struct GraphEditorPanel::FilterComponent   : public Component
 
     AudioProcessor* getProcessor() const
     {
-        if (auto node = graph.graph.getNodeForId (pluginID))
+        if (auto node = graph.getNodeForId (pluginID))
             return node->getProcessor();
 
         return {};
@@ -302,7 +300,7 @@ struct GraphEditorPanel::FilterComponent   : public Component
 
         switch (m.show())
         {
-            case 1:   graph.graph.removeNode (pluginID); break;
+            case 1:   graph.removeNode (pluginID); break;
             case 2:   graph.graph.disconnectNode (pluginID); break;
             case 10:  showWindow (PluginWindow::Type::normal); break;//displays Plugin GUI
             case 11:  showWindow (PluginWindow::Type::programs); break;
@@ -325,7 +323,7 @@ struct GraphEditorPanel::FilterComponent   : public Component
 
     void showWindow (PluginWindow::Type type)
     {
-        if (auto node = graph.graph.getNodeForId (pluginID))
+        if (auto node = graph.getNodeForId (pluginID))
             if (auto* w = graph.getOrCreateWindowFor (node, type))
                 w->toFront (true);
     }
@@ -538,6 +536,298 @@ struct GraphEditorPanel::ConnectorComponent   : public Component,
 };
 
 
+//==============================================================================
+/** The slot picker: a search box over the plugin catalogue that filters as you type. */
+struct GraphEditorPanel::PluginPicker   : public Component,
+                                          private ListBoxModel,
+                                          private TextEditor::Listener,
+                                          private AsyncUpdater
+{
+    PluginPicker (const PluginCatalogue& c, KnownPluginList::SortMethod method,
+                  std::function<void (const PluginDescription&)> callback)
+        : catalogue (c), sortMethod (method), onChosen (callback)
+    {
+        searchBox.setTextToShowWhenEmpty ("Search plugins...", Colours::grey);
+        searchBox.addListener (this);
+        addAndMakeVisible (searchBox);
+
+        list.setModel (this);
+        list.setRowHeight (24);
+        addAndMakeVisible (list);
+
+        updateResults();
+        setSize (400, 500);
+    }
+
+    ~PluginPicker()
+    {
+        cancelPendingUpdate();
+        list.setModel (nullptr);
+    }
+
+    void focusSearchBox()
+    {
+        searchBox.grabKeyboardFocus();
+    }
+
+    void resized() override
+    {
+        auto area = getLocalBounds().reduced (4);
+
+        searchBox.setBounds (area.removeFromTop (28));
+        area.removeFromTop (4);
+        list.setBounds (area);
+    }
+
+    int getNumRows() override
+    {
+        return results.size();
+    }
+
+    void paintListBoxItem (int row, Graphics& g, int width, int height, bool isSelected) override
+    {
+        if (isSelected)
+            g.fillAll (findColour (TextEditor::highlightColourId));
+
+        if (isStale())
+            triggerAsyncUpdate();
+
+        if (auto* desc = getType (row))
+        {
+            g.setColour (findColour (ListBox::textColourId));
+            g.setFont (height * 0.6f);
+            g.drawText (desc->name, 5, 0, width - 10, height, Justification::centredLeft, true);
+
+            g.setColour (findColour (ListBox::textColourId).withAlpha (0.5f));
+            g.drawText (desc->manufacturerName, 5, 0, width - 10, height, Justification::centredRight, true);
+        }
+    }
+
+    void listBoxItemClicked (int row, const MouseEvent&) override    { choose (row); }
+    void returnKeyPressed (int row) override                         { choose (row); }
+
+    void textEditorTextChanged (TextEditor&) override
+    {
+        updateResults();
+        list.selectRow (0);
+    }
+
+    void handleAsyncUpdate() override
+    {
+        updateResults();
+    }
+
+    void updateResults()
+    {
+        results = catalogue.search (searchBox.getText(), sortMethod);
+        resultsVersion = catalogue.getVersion();
+        list.updateContent();
+        list.repaint();
+    }
+
+    // the known-plugin list can change under an open picker, which moves its indexes
+    bool isStale() const noexcept
+    {
+        return resultsVersion != catalogue.getVersion();
+    }
+
+    void textEditorReturnKeyPressed (TextEditor&) override
+    {
+        choose (jmax (0, list.getSelectedRow()));
+    }
+
+    const PluginDescription* getType (int row) const
+    {
+        if (isPositiveAndBelow (row, results.size()) && ! isStale())
+            return catalogue.getList().getType (results.getUnchecked (row));
+
+        return nullptr;
+    }
+
+    void choose (int row)
+    {
+        if (isStale())
+        {
+            updateResults();
+            return;
+        }
+
+        if (auto* desc = getType (row))
+        {
+            auto chosen = *desc;
+            auto callback = onChosen;
+
+            if (auto* box = findParentComponentOfClass<CallOutBox>())
+                box->dismiss();
+
+            callback (chosen);
+        }
+    }
+
+    const PluginCatalogue& catalogue;
+    const KnownPluginList::SortMethod sortMethod;
+    std::function<void (const PluginDescription&)> onChosen;
+
+    TextEditor searchBox;
+    ListBox list;
+    Array<int> results;
+    int resultsVersion = -1;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PluginPicker)
+};
+
+
+//==============================================================================
+/** A thin level bar: RMS filled in, peak as a line, and a light that holds after a clip. */
+struct GraphEditorPanel::MeterBar   : public Component
+{
+    MeterBar()
+    {
+        setInterceptsMouseClicks (false, false);
+    }
+
+    void setReading (const LevelMeter::Reading& r)
+    {
+        // fall away smoothly rather than jumping between frames
+        auto newPeak = jmax (r.peak, peak * 0.85f);
+        auto newRMS  = jmax (r.rms, rms * 0.85f);
+        auto newClipHold = r.clipped ? (int) clipHoldFrames : jmax (0, clipHold - 1);
+
+        if (std::abs (newPeak - peak) > 0.002f || std::abs (newRMS - rms) > 0.002f
+             || (newClipHold > 0) != (clipHold > 0))
+            repaint();
+
+        peak = newPeak;
+        rms = newRMS;
+        clipHold = newClipHold;
+    }
+
+    void paint (Graphics& g) override
+    {
+        auto area = getLocalBounds().toFloat();
+        auto lightArea = area.removeFromRight (area.getHeight());
+        area.removeFromRight (2.0f);
+
+        g.setColour (Colours::grey.withAlpha (0.3f));
+        g.fillRect (area);
+
+        g.setColour (Colours::limegreen);
+        g.fillRect (area.withWidth (area.getWidth() * jmin (1.0f, rms)));
+
+        g.setColour (peak >= 1.0f ? Colours::red : Colours::orange);
+        g.fillRect (area.getX() + area.getWidth() * jmin (1.0f, peak) - 1.0f, area.getY(), 2.0f, area.getHeight());
+
+        g.setColour (clipHold > 0 ? Colours::red : Colours::grey.withAlpha (0.3f));
+        g.fillEllipse (lightArea);
+    }
+
+    enum { clipHoldFrames = 45 };
+
+    float peak = 0, rms = 0;
+    int clipHold = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MeterBar)
+};
+
+//==============================================================================
+/** Draws the analyser's latest frame: the spectrum on a log frequency scale, with the scope over it. */
+struct GraphEditorPanel::AnalyserView   : public Component
+{
+    AnalyserView (FilterGraph& g)  : graph (g) {}
+
+    void setFrame (const SpectrumAnalyser::Frame& f)
+    {
+        frame = &f;
+        repaint();
+    }
+
+    void paint (Graphics& g) override
+    {
+        auto area = getLocalBounds().toFloat();
+
+        g.setColour (Colours::black.withAlpha (0.6f));
+        g.fillRoundedRectangle (area, 4.0f);
+
+        auto source = graph.getAnalyser().getSource();
+        auto label = source == FilterGraph::numSlots ? String ("Master") : "Slot " + String (source + 1);
+
+        g.setColour (Colours::white.withAlpha (0.7f));
+        g.setFont (11.0f);
+        g.drawText (label, area.reduced (4.0f), Justification::topLeft);
+
+        if (frame == nullptr || frame->sampleRate <= 0 || frame->source != source)
+            return;
+
+        area.reduce (2.0f, 2.0f);
+        auto nyquist = frame->sampleRate / 2.0;
+        auto binWidth = nyquist / SpectrumAnalyser::numBins;
+        auto logRange = std::log (nyquist / minFrequency);
+
+        Path spectrum;
+
+        for (int x = 0; x < (int) area.getWidth(); ++x)
+        {
+            auto frequency = minFrequency * std::exp (logRange * x / area.getWidth());
+            auto bin = jlimit (0, SpectrumAnalyser::numBins - 1, roundToInt (frequency / binWidth));
+            auto level = jmap (jlimit (minDecibels, 0.0f, frame->spectrum[bin]), minDecibels, 0.0f, area.getBottom(), area.getY());
+
+            if (x == 0)
+                spectrum.startNewSubPath (area.getX(), level);
+            else
+                spectrum.lineTo (area.getX() + x, level);
+        }
+
+        g.setColour (Colours::limegreen);
+        g.strokePath (spectrum, PathStrokeType (1.0f));
+
+        Path scope;
+        auto step = area.getWidth() / (SpectrumAnalyser::scopeSize - 1);
+
+        for (int i = 0; i < SpectrumAnalyser::scopeSize; ++i)
+        {
+            auto y = area.getCentreY() - jlimit (-1.0f, 1.0f, frame->scope[i]) * area.getHeight() * 0.5f;
+
+            if (i == 0)
+                scope.startNewSubPath (area.getX(), y);
+            else
+                scope.lineTo (area.getX() + i * step, y);
+        }
+
+        g.setColour (Colours::orange.withAlpha (0.6f));
+        g.strokePath (scope, PathStrokeType (1.0f));
+    }
+
+    void mouseDown (const MouseEvent&) override
+    {
+        auto& analyser = graph.getAnalyser();
+        PopupMenu m;
+        m.addItem (1, "Master", true, analyser.getSource() == FilterGraph::numSlots);
+
+        for (int slot = 0; slot < FilterGraph::numSlots; ++slot)
+            if (auto* node = graph.getNodeForSlot (slot))
+                m.addItem (slot + 2, String (slot + 1) + ": " + node->getProcessor()->getName(),
+                           true, analyser.getSource() == slot);
+
+        auto result = m.show();
+
+        if (result == 1)
+            analyser.setSource (FilterGraph::numSlots);
+        else if (result > 1)
+            analyser.setSource (result - 2);
+
+        repaint();
+    }
+
+    static constexpr float minDecibels = -90.0f;
+    static constexpr double minFrequency = 20.0;
+
+    FilterGraph& graph;
+    const SpectrumAnalyser::Frame* frame = nullptr;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AnalyserView)
+};
+
+
 ////////////////////////////////////////////////////////////////
 //                                                            //
 //                                                            //
@@ -555,16 +845,18 @@ struct GraphEditorPanel::ConnectorComponent   : public Component,
 
 GraphEditorPanel::GraphEditorPanel (FilterGraph& g)  : graph (g)
 {
-    graph.addChangeListener (this);
+    graph.addListener (this);
     setOpaque (true);
     
     openUp = false;
     selfieTime = false;
     
-    for(int i = 0; i < 4; i++)     // array storing the 18 button screen
+    for(int i = 0; i < FilterGraph::numSlots; i++)     // array storing the 18 button screen
     {
         defaultButtons[i].addListener(this);
         defaultButtons[i].setClickingTogglesState(true);
+        defaultButtons[i].getProperties().set ("slot", i);
+        addChildComponent (slotMeters.add (new MeterBar()));
         
        // defaultButtons[i].setImages(false, true, true, PLU, 1.0f, Colours::transparentBlack, PLH, 1.0f, Colours::transparentBlack, PLH, 1.0f, Colours::transparentBlack);
 
@@ -572,9 +864,6 @@ GraphEditorPanel::GraphEditorPanel (FilterGraph& g)  : graph (g)
         buttonLabels[i].setColour(0x1000281, juce::Colours::black);
         buttonLabels[i].setJustificationType(Justification::centred);
         buttonLabels[i].setFont(Font("Helvetica", 15, 2+1));
-        
-        pluginPointer[i] = nullptr;
-        buttonFilled[i] = false;
     }
     
     logo.addListener(this);
@@ -586,7 +875,7 @@ GraphEditorPanel::GraphEditorPanel (FilterGraph& g)  : graph (g)
     
     addAndMakeVisible(&maxButton);
     maxButton.addListener(this);
-    maxButton.setButtonText("18");
+    maxButton.setButtonText(String (FilterGraph::numSlots));
     maxButton.setColour(0x1000100, Colours::transparentBlack);
     maxButton.setColour(0x1000101, Colours::lightgrey);
     maxButton.setClickingTogglesState(true);
@@ -600,12 +889,16 @@ GraphEditorPanel::GraphEditorPanel (FilterGraph& g)  : graph (g)
     light = true;
     dark = false;
 
-    currentVST = 0;
+    addAndMakeVisible (masterMeter = new MeterBar());
+    addAndMakeVisible (analyserView = new AnalyserView (graph));
+    addChildComponent (recorderStatus);
+    recorderStatus.setFont (Font (12.0f));
+    startTimerHz (meterFrameRate);
 }
 
 GraphEditorPanel::~GraphEditorPanel()
 {
-    graph.removeChangeListener (this);
+    graph.removeListener (this);
     draggingConnector = nullptr;
     nodes.clear();
     connectors.clear();
@@ -620,12 +913,11 @@ void GraphEditorPanel::paint (Graphics& g)
     {
         Image background = ImageCache::getFromMemory (BinaryData::bglight_png, BinaryData::bglight_pngSize);
         g.drawImageAt (background, 0, 0);
-        repaint();
-        for (int i = 0; i < 4; i++)
+        for (int i = 0; i < FilterGraph::numSlots; i++)
         {
             defaultButtons[i].setImages(false, true, true, PLU, 1.0f, Colours::transparentBlack, PLH, 1.0f, Colours::transparentBlack, PLD, 1.0f, Colours::transparentBlack);
             buttonLabels[i].setColour(0x1000281, juce::Colours::black);
-            if (buttonFilled[i] == true)
+            if (isSlotFilled (i))
             {
                 defaultButtons[i].setImages(false, true, true, NPLU, 1.0f, Colours::transparentBlack, NPLH, 1.0f, Colours::transparentBlack, NPLD, 1.0f, Colours::transparentBlack);
             }
@@ -637,12 +929,11 @@ void GraphEditorPanel::paint (Graphics& g)
     {
         Image background = ImageCache::getFromMemory (BinaryData::bgdark_png, BinaryData::bgdark_pngSize);
         g.drawImageAt (background, 0, 0);
-        repaint();
-        for (int i = 0; i < 4; i++)
+        for (int i = 0; i < FilterGraph::numSlots; i++)
         {
             defaultButtons[i].setImages(false, true, true, PDU, 1.0f, Colours::transparentBlack, PDH, 1.0f, Colours::transparentBlack, PDD, 1.0f, Colours::transparentBlack);
             buttonLabels[i].setColour(0x1000281, juce::Colours::white);
-            if (buttonFilled[i] == true)
+            if (isSlotFilled (i))
             {
                 defaultButtons[i].setImages(false, true, true, NPDU, 1.0f, Colours::transparentBlack, NPDH, 1.0f, Colours::transparentBlack, NPDD, 1.0f, Colours::transparentBlack);
             }
@@ -660,10 +951,12 @@ void GraphEditorPanel::paint (Graphics& g)
     fbButtons.justifyContent = FlexBox::JustifyContent::center;
     fbButtons.alignContent = FlexBox::AlignContent::center;
 
-    for(int i = 0; i < 4; i++)
+    // sized so that a full grid is six slots across and three down
+    auto slotSize = jmin (getWidth() * 7.0f / 48.0f, getHeight() * 7.0f / 24.0f) - 20.0f;
+
+    for(int i = 0; i < FilterGraph::numSlots; i++)
     {
-        fbButtons.items.add((FlexItem(defaultButtons[i]).withMinWidth((9*getLocalBounds().getWidth()/48)-20.0f).withMinHeight((9*getLocalBounds().getWidth()/48)-20.0f)).withMargin(10.0f));
-            // to change size of buttons, change 1/8 to a SMALLER decimal, i.e., 1/16, 1/32
+        fbButtons.items.add((FlexItem(defaultButtons[i]).withMinWidth(slotSize).withMinHeight(slotSize)).withMargin(10.0f));
     }
       fbButtons.performLayout(Rectangle<float>(getWidth()/16.0f, getHeight()/16.0f, getWidth()*7.0f/8.0f, getHeight()*7.0f/8.0f));
     
@@ -672,86 +965,35 @@ void GraphEditorPanel::paint (Graphics& g)
     fbLabels.justifyContent = FlexBox::JustifyContent::center;
     fbLabels.alignContent = FlexBox::AlignContent::center;
 
-    for(int i = 0; i < 4; i++)
+    for(int i = 0; i < FilterGraph::numSlots; i++)
     {
-        fbLabels.items.add((FlexItem(buttonLabels[i]).withMinWidth((9*getLocalBounds().getWidth()/48)-20.0f).withMinHeight((9*getLocalBounds().getWidth()/48)-20.0f)).withMargin(10.0f));
+        fbLabels.items.add((FlexItem(buttonLabels[i]).withMinWidth(slotSize).withMinHeight(slotSize)).withMargin(10.0f));
     }
     fbLabels.performLayout(Rectangle<float>(getWidth()/16.0f, getHeight()/16.0f, getWidth()*7.0f/8.0f, getHeight()*7.0f/8.0f));
+
+    // each meter sits in the margin just under its button
+    for (int i = 0; i < FilterGraph::numSlots; i++)
+    {
+        auto b = defaultButtons[i].getBounds();
+        slotMeters.getUnchecked (i)->setBounds (b.getX(), b.getBottom() + 2, b.getWidth(), 6);
+    }
 }
 
 void GraphEditorPanel::buttonClicked (Button* button) //opens VST when the button is clicked
 {
-    for(int i = 0; i < 4; i++)
-    {
-        if (button == &defaultButtons[i])
-        {
-            if (buttonFilled[i] == false)
-            {
-                PopupMenu m;
-                //m.getMenu().getItem(2).setChecked(true);
-                if (auto* mainWindow = findParentComponentOfClass<MainHostWindow>())
-                {
-                    mainWindow->addPluginsToMenu (m);
-                    auto r = m.show();
-                    if (auto* desc = mainWindow->getChosenType (r))
-                    {
-                        createNewPlugin(*desc, Point<int>(0, 0)); //creates VST at position 0,0 (Top Left)
-                        buttonFilled[i] = true;
-                    }
-                    m.getNumItems();
-                    DBG(m.getNumItems());
-                }
-            }
-        }
-    }
-    
-    if (button ==&defaultButtons[0])
-    {
-        addAndMakeVisible(defaultButtons[1]);
-        buttonLabels[0].setText(vstNames[0], dontSendNotification);
-        if (buttonFilled[0] == true)
-        {
-                if (auto f = graph.graph.getNodeForId (3))
-                if (auto* w = graph.getOrCreateWindowFor (f, PluginWindow::Type::normal))
-                w->toFront (true);
-        }
-    }
+    auto slot = (int) button->getProperties().getWithDefault ("slot", -1);
 
-    if (button ==&defaultButtons[1])
+    if (isPositiveAndBelow (slot, (int) FilterGraph::numSlots))
     {
-        addAndMakeVisible(defaultButtons[2]);
-        buttonLabels[1].setText(vstNames[1], dontSendNotification);
-        if (buttonFilled[1] == true)
-        {
-            if (auto f = graph.graph.getNodeForId (4))
-                if (auto* w = graph.getOrCreateWindowFor (f, PluginWindow::Type::normal))
-                    w->toFront (true);
-        }
-    }
-    
-    if (button ==&defaultButtons[2])
-    {
-        addAndMakeVisible(defaultButtons[3]);
-            buttonLabels[2].setText(vstNames[2], dontSendNotification);
-        if (buttonFilled[2] == true){
-            if (auto f = graph.graph.getNodeForId (5))
-                if (auto* w = graph.getOrCreateWindowFor (f, PluginWindow::Type::normal))
-                    w->toFront (true);
-        }
+        if (onSlotPressed != nullptr)
+            onSlotPressed (slot);
 
+        pressSlot (slot);
     }
-    if (button ==&defaultButtons[3])
-    {
-        buttonLabels[3].setText(vstNames[3], dontSendNotification);
-        if (buttonFilled[3] == true){
-            if (auto f = graph.graph.getNodeForId (6))
-                if (auto* w = graph.getOrCreateWindowFor (f, PluginWindow::Type::normal))
-                    w->toFront (true);
-        }
-    }
+
     if (button ==&maxButton)
     {
-        for(int i = 0; i < 4; i++)
+        for(int i = 0; i < FilterGraph::numSlots; i++)
         {
             addAndMakeVisible(defaultButtons[i]);
         }
@@ -796,30 +1038,70 @@ void GraphEditorPanel::buttonClicked (Button* button) //opens VST when the butto
 }
 
 
+void GraphEditorPanel::pressSlot (int slot)
+{
+    if (! isPositiveAndBelow (slot, (int) FilterGraph::numSlots))
+        return;
 
-void GraphEditorPanel::createNewPlugin (const PluginDescription& desc, Point<int> position)
+    focusSlot (slot);
+
+    if (auto* node = graph.getNodeForSlot (slot))
+    {
+        if (auto* w = graph.getOrCreateWindowFor (node, PluginWindow::Type::normal))
+            w->toFront (true);
+    }
+    else
+    {
+        showPluginPicker (slot);
+    }
+}
+
+void GraphEditorPanel::focusSlot (int slot)
 {
-    graph.addPlugin (desc, position.toDouble() / Point<double> ((double) getWidth(), (double) getHeight()));
-    vstNames[currentVST] = desc.descriptiveName;
-    currentVST++;
+    if (! isPositiveAndBelow (slot, (int) FilterGraph::numSlots))
+        return;
+
+    // the grid grows one button at a time as slots get used
+    if (slot + 1 < FilterGraph::numSlots)
+        addAndMakeVisible (defaultButtons[slot + 1]);
+
+    if (defaultButtons[slot].isShowing())
+        defaultButtons[slot].grabKeyboardFocus();
 }
 
-GraphEditorPanel::FilterComponent* GraphEditorPanel::getComponentForFilter (const uint32 filterID) const
+void GraphEditorPanel::showPluginPicker (int slot)
 {
-    for (auto* fc : nodes)
-       if (fc->pluginID == filterID)
-            return fc;
+    if (auto* mainWindow = findParentComponentOfClass<MainHostWindow>())
+    {
+        auto* picker = new PluginPicker (mainWindow->pluginCatalogue, mainWindow->pluginSortMethod,
+                                         [this, slot] (const PluginDescription& desc)
+                                         {
+                                             createNewPlugin (desc, Point<int> (0, 0), slot); //creates VST at position 0,0 (Top Left)
+                                         });
+
+        CallOutBox::launchAsynchronously (picker, defaultButtons[slot].getBounds(), this);
+        picker->focusSearchBox();
+    }
+}
 
-    return nullptr;
+void GraphEditorPanel::createNewPlugin (const PluginDescription& desc, Point<int> position, int slot)
+{
+    if (slot < 0)
+        slot = graph.getFirstFreeSlot();
+
+    graph.addPlugin (desc, position.toDouble() / Point<double> ((double) getWidth(), (double) getHeight()), slot);
 }
 
-GraphEditorPanel::ConnectorComponent* GraphEditorPanel::getComponentForConnection (const AudioProcessorGraph::Connection& conn) const
+GraphEditorPanel::FilterComponent* GraphEditorPanel::getComponentForFilter (const uint32 filterID) const
 {
-    for (auto* cc : connectors)
-        if (cc->connection == conn)
-            return cc;
+    auto found = componentsByNode.find (filterID);
+    return found != componentsByNode.end() ? found->second : nullptr;
+}
 
-    return nullptr;
+GraphEditorPanel::ConnectorComponent* GraphEditorPanel::getComponentForConnection (const AudioProcessorGraph::Connection& conn) const
+{
+    auto found = componentsByConnection.find (conn);
+    return found != componentsByConnection.end() ? found->second : nullptr;
 }
 
 GraphEditorPanel::PinComponent* GraphEditorPanel::findPinAt (Point<float> pos) const
@@ -843,6 +1125,9 @@ void GraphEditorPanel::resized()
 
     maxButton.setBounds(getWidth() - getWidth() + 60, getHeight() - 100, 60, 60);
    lightMode.setBounds(getWidth() - getWidth() + 220, getHeight() - 100, 60, 60);
+    masterMeter->setBounds (300, getHeight() - 76, 240, 12);
+    recorderStatus.setBounds (300, getHeight() - 62, 320, 16);
+    analyserView->setBounds (640, getHeight() - 110, 480, 96);
     logo.setBounds(1260, getHeight() - 120, 150, 150);
     
 }
@@ -855,12 +1140,12 @@ void GraphEditorPanel::changeListenerCallback (ChangeBroadcaster*)
 void GraphEditorPanel::updateComponents()
 {
     for (int i = nodes.size(); --i >= 0;)
-        if (graph.graph.getNodeForId (nodes.getUnchecked(i)->pluginID) == nullptr)
-            nodes.remove (i);
+        if (graph.getNodeForId (nodes.getUnchecked(i)->pluginID) == nullptr)
+            removeComponentForNode (nodes.getUnchecked(i)->pluginID);
 
     for (int i = connectors.size(); --i >= 0;)
         if (! graph.graph.isConnected (connectors.getUnchecked(i)->connection))
-            connectors.remove (i);
+            removeComponentForConnection (connectors.getUnchecked(i)->connection);
 
     for (auto* fc : nodes)
         fc->update();
@@ -869,25 +1154,144 @@ void GraphEditorPanel::updateComponents()
         cc->update();
 
     for (auto* f : graph.graph.getNodes())
+        addComponentForNode (f->nodeID);
+
+    for (auto& c : graph.graph.getConnections())
+        addComponentForConnection (c);
+
+    updateSlots();
+}
+
+void GraphEditorPanel::filterGraphChanged (const FilterGraph::Delta& delta)
+{
+    for (auto& c : delta.connectionsRemoved)
+        removeComponentForConnection (c);
+
+    for (auto nodeID : delta.nodesRemoved)
+        removeComponentForNode (nodeID);
+
+    for (auto nodeID : delta.nodesAdded)
+        addComponentForNode (nodeID);
+
+    for (auto& c : delta.connectionsAdded)
+        addComponentForConnection (c);
+
+    if (! delta.nodesChanged.isEmpty())
     {
-        if (getComponentForFilter (f->nodeID) == 0)
+        for (auto nodeID : delta.nodesChanged)
+            if (auto* fc = getComponentForFilter (nodeID))
+                fc->update();
+
+        // a node that moved or changed its channels drags its wires along with it
+        for (auto* cc : connectors)
+            if (delta.nodesChanged.contains (cc->connection.source.nodeID)
+                 || delta.nodesChanged.contains (cc->connection.destination.nodeID))
+                cc->update();
+    }
+
+    updateSlots();
+}
+
+void GraphEditorPanel::addComponentForNode (AudioProcessorGraph::NodeID nodeID)
+{
+    if (getComponentForFilter (nodeID) != nullptr || graph.getNodeForId (nodeID) == nullptr)
+        return;
+
+    auto* comp = nodes.add (new FilterComponent (*this, nodeID));
+    componentsByNode[nodeID] = comp;
+    //   addAndMakeVisible (comp); //COMMENT OUT
+    comp->update();
+}
+
+void GraphEditorPanel::addComponentForConnection (const AudioProcessorGraph::Connection& c)
+{
+    if (getComponentForConnection (c) != nullptr)
+        return;
+
+    auto* comp = connectors.add (new ConnectorComponent (*this));
+    componentsByConnection[c] = comp;
+    //addAndMakeVisible (comp); //COMMENT OUR
+
+    comp->setInput (c.source);
+    comp->setOutput (c.destination);
+}
+
+void GraphEditorPanel::removeComponentForNode (AudioProcessorGraph::NodeID nodeID)
+{
+    if (auto* comp = getComponentForFilter (nodeID))
+    {
+        componentsByNode.erase (nodeID);
+        nodes.removeObject (comp);
+    }
+}
+
+void GraphEditorPanel::removeComponentForConnection (const AudioProcessorGraph::Connection& c)
+{
+    if (auto* comp = getComponentForConnection (c))
+    {
+        componentsByConnection.erase (c);
+        connectors.removeObject (comp);
+    }
+}
+
+void GraphEditorPanel::updateSlots()
+{
+    int lastFilledSlot = -1;
+
+    for (int i = 0; i < FilterGraph::numSlots; ++i)
+    {
+        if (auto* node = graph.getNodeForSlot (i))
+        {
+            buttonLabels[i].setText (node->getProcessor()->getName(), dontSendNotification);
+            lastFilledSlot = i;
+        }
+        else
         {
-            auto* comp = nodes.add (new FilterComponent (*this, f->nodeID));
-        //   addAndMakeVisible (comp); //COMMENT OUT
-            comp->update();
+            buttonLabels[i].setText ({}, dontSendNotification);
         }
     }
 
-    for (auto& c : graph.graph.getConnections())
+    // a restored session shows every slot it uses, plus the next empty one
+    for (int i = 0; i <= jmin (lastFilledSlot + 1, FilterGraph::numSlots - 1); ++i)
+        addAndMakeVisible (defaultButtons[i]);
+
+    repaint();
+}
+
+void GraphEditorPanel::timerCallback()
+{
+    for (int i = 0; i < FilterGraph::numSlots; ++i)
     {
-        if (getComponentForConnection (c) == 0)
-        {
-            auto* comp = connectors.add (new ConnectorComponent (*this));
-            //addAndMakeVisible (comp); //COMMENT OUR
+        auto* meter = slotMeters.getUnchecked (i);
+        meter->setVisible (isSlotFilled (i));
 
-            comp->setInput (c.source);
-            comp->setOutput (c.destination);
-        }
+        // always drained, so a slot that's just been filled doesn't start with stale levels
+        auto reading = graph.getSlotMeter (i).read();
+
+        if (meter->isVisible())
+            meter->setReading (reading);
+    }
+
+    masterMeter->setReading (graph.getMasterMeter().read());
+
+    // the analyser publishes at its own pace, so this only picks up what's new
+    if (auto* frame = graph.getAnalyser().getNewFrame())
+        analyserView->setFrame (*frame);
+
+    auto& recorder = graph.getRecorder();
+    recorderStatus.setVisible (recorder.isRecording());
+
+    if (recorder.isRecording())
+    {
+        auto seconds = (int) recorder.getSecondsRecorded();
+        auto text = String::formatted ("REC %d:%02d:%02d", seconds / 3600, (seconds / 60) % 60, seconds % 60)
+                      + "  buffer " + String (roundToInt (recorder.getFifoFillLevel() * 100.0f))
+                      + "% (peak " + String (roundToInt (recorder.getPeakFifoFillLevel() * 100.0f)) + "%)";
+
+        if (auto dropped = recorder.getNumDroppedSamples())
+            text << "  dropped " << dropped;
+
+        recorderStatus.setText (text, dontSendNotification);
     }
 }
 
@@ -896,6 +1300,10 @@ void GraphEditorPanel::beginConnectorDrag (AudioProcessorGraph::NodeAndChannel s
                                            const MouseEvent& e)
 {
     auto* c = dynamic_cast<ConnectorComponent*> (e.originalComponent);
+
+    if (c != nullptr)
+        componentsByConnection.erase (c->connection);
+
     connectors.removeObject (c, false);
     draggingConnector = c;
 
@@ -1035,9 +1443,42 @@ GraphDocumentComponent::GraphDocumentComponent (AudioPluginFormatManager& fm, Au
     //addAndMakeVisible (keyboardComp = new MidiKeyboardComponent (keyState, MidiKeyboardComponent::horizontalKeyboard));
     addAndMakeVisible (statusBar = new TooltipBar());
 
-    deviceManager.addAudioCallback (&graphPlayer);
+    // the controller board's MIDI is merged into each block by the graph itself, so the audio thread never waits on it
+    controller = new SerialController();
+    controller->setMidiChannel (getAppProperties().getUserSettings()->getIntValue ("controllerMidiChannel", 16));
+    controller->onEvent = [this] (const ControllerEvent& e) { handleControllerEvent (e); };
+    graph->graph.setMidiSource (controller);
+
+    rateAdapter.setInternalRate (getAppProperties().getUserSettings()->getDoubleValue ("internalSampleRate", 0.0));
+    deviceManager.addAudioCallback (&callbackMonitor);
     deviceManager.addMidiInputCallback (String(), &graphPlayer.getMidiMessageCollector());
 
+    // a port of 0 turns the metrics endpoint off
+    metrics = new MetricsServer (*graph, callbackMonitor, deviceManager);
+    auto metricsPort = getAppProperties().getUserSettings()->getIntValue ("metricsPort", 9464);
+
+    if (metricsPort > 0)
+    {
+        auto result = metrics->start (metricsPort);
+
+        if (result.failed())
+            Logger::writeToLog (result.getErrorMessage());
+    }
+
+    capture = new InputCapture (*graph, deviceManager);
+    graphPanel->onSlotPressed = [this] (int slot) { capture->slotPressed (slot); };
+
+    // an empty port turns the controller board off
+    auto controllerPort = getAppProperties().getUserSettings()->getValue ("controllerSerialPort", "/dev/ttyACM0");
+
+    if (controllerPort.isNotEmpty())
+    {
+        auto result = controller->start (controllerPort);
+
+        if (result.failed())
+            Logger::writeToLog (result.getErrorMessage());
+    }
+
     graphPanel->updateComponents();
 }
 
@@ -1070,7 +1511,15 @@ void GraphDocumentComponent::unfocusKeyboardComponent()
 
 void GraphDocumentComponent::releaseGraph()
 {
-    deviceManager.removeAudioCallback (&graphPlayer);
+    if (controller != nullptr)
+        graph->graph.setMidiSource (nullptr);
+
+    controller = nullptr;
+    replayer = nullptr;
+    capture = nullptr;
+    metrics = nullptr;
+
+    deviceManager.removeAudioCallback (&callbackMonitor);
     deviceManager.removeMidiInputCallback (String(), &graphPlayer.getMidiMessageCollector());
 
     if (graphPanel != nullptr)
@@ -1091,8 +1540,87 @@ void GraphDocumentComponent::setDoublePrecision (bool doublePrecision)
     graphPlayer.setDoublePrecisionProcessing (doublePrecision);
 }
 
+void GraphDocumentComponent::setInternalSampleRate (double rate)
+{
+    // detaching stops the callbacks, so the adapter can be reconfigured safely
+    deviceManager.removeAudioCallback (&callbackMonitor);
+    rateAdapter.setInternalRate (rate);
+    deviceManager.addAudioCallback (&callbackMonitor);
+}
+
 bool GraphDocumentComponent::closeAnyOpenPluginWindows()
 {
     return graphPanel->graph.closeAnyOpenPluginWindows();
 }
 
+void GraphDocumentComponent::handleControllerEvent (const ControllerEvent& e)
+{
+    // only the board's event is captured; replaying it brings the slot press back with it
+    if (capture != nullptr)
+        capture->controllerMoved (e.getControllerIndex(), (float) e.value);
+
+    // the five Cherry buttons do what clicking the first five slots does
+    auto button = e.getButtonIndex();
+
+    if (e.isPress() && button > 0 && button <= FilterGraph::numSlots && graphPanel != nullptr)
+        graphPanel->pressSlot (button - 1);
+}
+
+void GraphDocumentComponent::replayControllerEvent (int index, float value)
+{
+    auto e = ControllerEvent::fromControllerIndex (index, roundToInt (value));
+
+    if (controller != nullptr)
+        controller->injectEvent (e);
+
+    auto button = e.getButtonIndex();
+
+    if (e.isPress() && button > 0 && button <= FilterGraph::numSlots && graphPanel != nullptr)
+        graphPanel->focusSlot (button - 1);
+}
+
+LatencyReport GraphDocumentComponent::createLatencyReport() const
+{
+    return LatencyReport (graph->graph, deviceManager.getCurrentAudioDevice(), rateAdapter.getAddedLatencySeconds());
+}
+
+//==============================================================================
+Result GraphDocumentComponent::startCapture (const File& file)
+{
+    return capture->start (file);
+}
+
+void GraphDocumentComponent::stopCapture()
+{
+    capture->stop();
+}
+
+bool GraphDocumentComponent::isCapturing() const
+{
+    return capture != nullptr && capture->isCapturing();
+}
+
+Result GraphDocumentComponent::startReplay (const File& file)
+{
+    if (replayer == nullptr)
+    {
+        replayer = new CaptureReplayer (*graph, deviceManager, graphPlayer.getMidiMessageCollector());
+        replayer->onSlotPressed = [this] (int slot) { graphPanel->focusSlot (slot); };
+        replayer->onControllerMoved = [this] (int index, float value) { replayControllerEvent (index, value); };
+        replayer->onFinished = [] { getCommandManager().commandStatusChanged(); };
+    }
+
+    return replayer->start (file);
+}
+
+void GraphDocumentComponent::stopReplay()
+{
+    if (replayer != nullptr)
+        replayer->stop();
+}
+
+bool GraphDocumentComponent::isReplaying() const
+{
+    return replayer != nullptr && replayer->isReplaying();
+}
+
@@ -27,7 +27,12 @@
 #pragma once
 
 #include "FilterGraph.h"
+#include "FixedRateAdapter.h"
+#include "InputCapture.h"
+#include "LatencyReport.h"
 #include "MainHostWindow.h"
+#include "MetricsServer.h"
+#include "SerialController.h"
 
 
 //==============================================================================
@@ -36,21 +41,35 @@
 */
 class GraphEditorPanel   : public Component,
                            public ChangeListener,
-                           public TextButton::Listener
+                           public TextButton::Listener,
+                           private FilterGraph::Listener,
+                           private Timer
 {
 public:
     GraphEditorPanel (FilterGraph& graph);
     ~GraphEditorPanel();
 
-    void createNewPlugin (const PluginDescription&, Point<int> position);
+    void createNewPlugin (const PluginDescription&, Point<int> position, int slot = -1);
 
     void paint (Graphics&) override;
     void resized() override;
     void changeListenerCallback (ChangeBroadcaster*) override;
     void updateComponents();
     void buttonClicked(Button* button) override;
-    bool buttonFilled[4];
-    int currentVST;
+    bool isSlotFilled (int slot) const      { return graph.getNodeForSlot (slot) != nullptr; }
+
+    /** Does what clicking a slot's button does: opens its plugin, or offers to fill it. */
+    void pressSlot (int slot);
+
+    /** Shows and focuses a slot's button without opening anything, which is how a replay
+        presses it. Whatever the press led to is replayed from the capture's graph edits.
+    */
+    void focusSlot (int slot);
+
+    /** Called when a slot's button is clicked. The controller board's presses are captured
+        as the board's own events instead, so they aren't recorded twice.
+    */
+    std::function<void (int slot)> onSlotPressed;
 
     //Image background = ImageCache::getFromMemory(BinaryData::LOAD_PLUGIN_png, BinaryData::LOAD_PLUGIN_pngSize);
 
@@ -96,19 +115,41 @@ private:
     struct FilterComponent;
     struct ConnectorComponent;
     struct PinComponent;
+    struct PluginPicker;
+    struct MeterBar;
+    struct AnalyserView;
 
     OwnedArray<FilterComponent> nodes;
     OwnedArray<ConnectorComponent> connectors;
     ScopedPointer<ConnectorComponent> draggingConnector;
 
+    std::unordered_map<AudioProcessorGraph::NodeID, FilterComponent*> componentsByNode;
+    std::unordered_map<AudioProcessorGraph::Connection, ConnectorComponent*, FilterGraph::ConnectionHash> componentsByConnection;
+
     FilterComponent* getComponentForFilter (AudioProcessorGraph::NodeID) const;
     ConnectorComponent* getComponentForConnection (const AudioProcessorGraph::Connection&) const;
     PinComponent* findPinAt (Point<float>) const;
+    void showPluginPicker (int slot);
+    void updateSlots();
+
+    void filterGraphChanged (const FilterGraph::Delta&) override;
+    void addComponentForNode (AudioProcessorGraph::NodeID);
+    void addComponentForConnection (const AudioProcessorGraph::Connection&);
+    void removeComponentForNode (AudioProcessorGraph::NodeID);
+    void removeComponentForConnection (const AudioProcessorGraph::Connection&);
+
+    // the meters are polled rather than pushed, so the audio thread never waits on the UI
+    enum { meterFrameRate = 30 };
+    OwnedArray<MeterBar> slotMeters;
+    ScopedPointer<MeterBar> masterMeter;
+    ScopedPointer<AnalyserView> analyserView;
+    Label recorderStatus;
+    void timerCallback() override;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GraphEditorPanel)
     
-    ImageButton defaultButtons[4];
-    Label buttonLabels[4];
+    ImageButton defaultButtons[FilterGraph::numSlots];
+    Label buttonLabels[FilterGraph::numSlots];
     
     TextButton maxButton;
     TextButton lightMode;
@@ -117,8 +158,6 @@ private:
     bool light;
     bool dark;
     bool pluginOn;
-    const PluginDescription *pluginPointer[4];
-    String vstNames[4];
     int buttonClick;
     
     SafePointer<DocumentWindow> settingsWindow;
@@ -141,8 +180,25 @@ public:
     //==============================================================================
     void createNewPlugin (const PluginDescription&, Point<int> position);
     void setDoublePrecision (bool doublePrecision);
+
+    /** Runs the graph at a fixed rate, or follows the device if this is 0. */
+    void setInternalSampleRate (double rate);
     bool closeAnyOpenPluginWindows();
 
+    /** Describes the latency of every path through the graph, as it's playing now. */
+    LatencyReport createLatencyReport() const;
+
+    //==============================================================================
+    /** Captures MIDI, slot presses and graph edits to a file, timed on the audio clock. */
+    Result startCapture (const File&);
+    void stopCapture();
+    bool isCapturing() const;
+
+    /** Restores the graph from a capture and plays its events back in real time. */
+    Result startReplay (const File&);
+    void stopReplay();
+    bool isReplaying() const;
+
     //==============================================================================
     ScopedPointer<FilterGraph> graph;
 
@@ -158,12 +214,21 @@ private:
     //==============================================================================
     AudioDeviceManager& deviceManager;
     AudioProcessorPlayer graphPlayer;
+    FixedRateAdapter rateAdapter { graphPlayer };
+    CallbackMonitor callbackMonitor { rateAdapter };
+    ScopedPointer<MetricsServer> metrics;
+    ScopedPointer<SerialController> controller;
+    ScopedPointer<InputCapture> capture;
+    ScopedPointer<CaptureReplayer> replayer;
     //MidiKeyboardState keyState;
     
 
     struct TooltipBar;
     ScopedPointer<TooltipBar> statusBar;
 
+    void handleControllerEvent (const ControllerEvent&);
+    void replayControllerEvent (int index, float value);
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GraphDocumentComponent)
 };
 
@@ -0,0 +1,151 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "HostMetrics.h"
+
+
+//==============================================================================
+TimingHistogram::TimingHistogram (std::initializer_list<double> bucketBounds) noexcept
+{
+    jassert (bucketBounds.size() <= maxBuckets);
+
+    for (auto b : bucketBounds)
+        if (numBounds < maxBuckets)
+            bounds[numBounds++] = b;
+
+    for (auto& c : counts)
+        c.store (0, std::memory_order_relaxed);
+}
+
+void TimingHistogram::record (double seconds) noexcept
+{
+    for (int i = 0; i < numBounds; ++i)
+    {
+        if (seconds <= bounds[i])
+        {
+            counts[i].fetch_add (1, std::memory_order_relaxed);
+            break;
+        }
+    }
+
+    total.fetch_add (1, std::memory_order_relaxed);
+    sumMicroseconds.fetch_add ((int64) (seconds * 1.0e6), std::memory_order_relaxed);
+}
+
+//==============================================================================
+void ProcessLoad::addBlock (double processSeconds, double blockSeconds) noexcept
+{
+    busyMicroseconds.fetch_add ((int64) (processSeconds * 1.0e6), std::memory_order_relaxed);
+
+    if (blockSeconds <= 0)
+        return;
+
+    // a one-pole average with a time constant of about a quarter of a second of audio
+    auto blockLoad = (float) (processSeconds / blockSeconds);
+    auto coeff = (float) jmin (1.0, blockSeconds / 0.25);
+    auto previous = load.load (std::memory_order_relaxed);
+
+    load.store (previous + (blockLoad - previous) * coeff, std::memory_order_relaxed);
+}
+
+//==============================================================================
+CallbackMonitor::CallbackMonitor (AudioIODeviceCallback& c)  : callback (c) {}
+CallbackMonitor::~CallbackMonitor() {}
+
+void CallbackMonitor::audioDeviceAboutToStart (AudioIODevice* device)
+{
+    sampleRate = device->getCurrentSampleRate();
+    callback.audioDeviceAboutToStart (device);
+}
+
+void CallbackMonitor::audioDeviceIOCallback (const float** inputChannelData, int numInputChannels,
+                                             float** outputChannelData, int numOutputChannels, int numSamples)
+{
+    auto start = Time::getHighResolutionTicks();
+    callback.audioDeviceIOCallback (inputChannelData, numInputChannels, outputChannelData, numOutputChannels, numSamples);
+    auto seconds = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start);
+
+    auto budget = sampleRate > 0 ? numSamples / sampleRate : 0.0;
+
+    numCallbacks.fetch_add (1, std::memory_order_relaxed);
+    durations.record (seconds);
+    load.addBlock (seconds, budget);
+
+    if (budget > 0 && seconds > budget)
+        numDeadlineMisses.fetch_add (1, std::memory_order_relaxed);
+}
+
+void CallbackMonitor::audioDeviceStopped()
+{
+    callback.audioDeviceStopped();
+}
+
+void CallbackMonitor::audioDeviceError (const String& message)
+{
+    callback.audioDeviceError (message);
+}
+
+//==============================================================================
+TimedPluginWrapper::TimedPluginWrapper (AudioPluginInstance* pluginToWrap, ProcessLoad& l)
+    : PluginWrapper (pluginToWrap),
+      load (l)
+{
+}
+
+TimedPluginWrapper::~TimedPluginWrapper()
+{
+    load.clearLoad();
+}
+
+AudioProcessor* TimedPluginWrapper::unwrap (AudioProcessor* processor) noexcept
+{
+    if (auto* wrapper = dynamic_cast<TimedPluginWrapper*> (processor))
+        return &wrapper->getWrappedPlugin();
+
+    return processor;
+}
+
+//==============================================================================
+void TimedPluginWrapper::prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock)
+{
+    prepareWrappedPlugin (sampleRate, maximumExpectedSamplesPerBlock);
+}
+
+template <typename FloatType>
+void TimedPluginWrapper::processTimed (AudioBuffer<FloatType>& buffer, MidiBuffer& midi)
+{
+    auto start = Time::getHighResolutionTicks();
+    plugin->processBlock (buffer, midi);
+    auto seconds = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start);
+
+    auto rate = getSampleRate();
+    load.addBlock (seconds, rate > 0 ? buffer.getNumSamples() / rate : 0.0);
+}
+
+void TimedPluginWrapper::processBlock (AudioBuffer<float>& buffer, MidiBuffer& midi)   { processTimed (buffer, midi); }
+void TimedPluginWrapper::processBlock (AudioBuffer<double>& buffer, MidiBuffer& midi)  { processTimed (buffer, midi); }
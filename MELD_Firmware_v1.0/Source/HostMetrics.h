@@ -0,0 +1,169 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+
+#pragma once
+
+#include "PluginWrapper.h"
+#include <atomic>
+
+
+//==============================================================================
+/**
+    Counts durations into fixed buckets, for exporting as a Prometheus histogram.
+
+    record() can be called from any thread, the audio thread included, and the
+    buckets can be read from any other while that goes on. Each bucket only counts
+    what falls into it; they're summed up on the way out.
+*/
+class TimingHistogram
+{
+public:
+    /** The upper bounds of the buckets in seconds, in ascending order. */
+    TimingHistogram (std::initializer_list<double> bucketBounds) noexcept;
+
+    void record (double seconds) noexcept;
+
+    int getNumBuckets() const noexcept                      { return numBounds; }
+    double getBucketBound (int i) const noexcept            { return bounds[i]; }
+    int64 getBucketCount (int i) const noexcept             { return counts[i].load (std::memory_order_relaxed); }
+
+    /** Everything above the last bound ends up only in here. */
+    int64 getTotalCount() const noexcept                    { return total.load (std::memory_order_relaxed); }
+    double getSumSeconds() const noexcept                   { return sumMicroseconds.load (std::memory_order_relaxed) * 1.0e-6; }
+
+private:
+    enum { maxBuckets = 16 };
+
+    double bounds[maxBuckets] = {};
+    int numBounds = 0;
+    std::atomic<int64> counts[maxBuckets];
+    std::atomic<int64> total { 0 }, sumMicroseconds { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE (TimingHistogram)
+};
+
+//==============================================================================
+/**
+    How much of the audio thread's time something has been taking.
+
+    The audio thread adds each block it times, and anyone can read the totals. The
+    ratio is of the time spent to the length of audio processed, smoothed over the
+    last few hundred milliseconds so one slow block doesn't dominate it.
+*/
+class ProcessLoad
+{
+public:
+    ProcessLoad() noexcept {}
+
+    /** Called on the audio thread. */
+    void addBlock (double processSeconds, double blockSeconds) noexcept;
+
+    double getTotalSeconds() const noexcept                 { return busyMicroseconds.load (std::memory_order_relaxed) * 1.0e-6; }
+    float getLoad() const noexcept                          { return load.load (std::memory_order_relaxed); }
+
+    /** For when whatever was being timed has gone, so the load doesn't stay stuck. */
+    void clearLoad() noexcept                               { load.store (0.0f, std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64> busyMicroseconds { 0 };
+    std::atomic<float> load { 0.0f };
+
+    JUCE_DECLARE_NON_COPYABLE (ProcessLoad)
+};
+
+//==============================================================================
+/**
+    Sits in front of another device callback and times every call it makes.
+
+    A call that takes longer than the audio it produced lasts has missed its
+    deadline, whatever the device itself makes of it.
+*/
+class CallbackMonitor  : public AudioIODeviceCallback
+{
+public:
+    CallbackMonitor (AudioIODeviceCallback& callbackToTime);
+    ~CallbackMonitor();
+
+    int64 getNumCallbacks() const noexcept                  { return numCallbacks.load (std::memory_order_relaxed); }
+    int64 getNumDeadlineMisses() const noexcept             { return numDeadlineMisses.load (std::memory_order_relaxed); }
+    const TimingHistogram& getDurations() const noexcept    { return durations; }
+
+    /** The load of the last second or so, as a fraction of the time available. */
+    float getLoad() const noexcept                          { return load.getLoad(); }
+
+    //==============================================================================
+    void audioDeviceAboutToStart (AudioIODevice*) override;
+    void audioDeviceIOCallback (const float** inputChannelData, int numInputChannels,
+                                float** outputChannelData, int numOutputChannels, int numSamples) override;
+    void audioDeviceStopped() override;
+    void audioDeviceError (const String&) override;
+
+private:
+    //==============================================================================
+    AudioIODeviceCallback& callback;
+    double sampleRate = 0;
+
+    std::atomic<int64> numCallbacks { 0 }, numDeadlineMisses { 0 };
+    TimingHistogram durations { 0.0005, 0.001, 0.002, 0.003, 0.005, 0.0075, 0.01, 0.015, 0.02, 0.05, 0.1 };
+    ProcessLoad load;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CallbackMonitor)
+};
+
+//==============================================================================
+/**
+    Times a plugin's processBlock calls into a ProcessLoad.
+
+    The graph calls its nodes directly and gives no way of timing them from
+    outside, so slotted plugins are loaded inside one of these. Like the
+    OversamplingWrapper, it passes everything else straight through, so saved
+    sessions only ever see the plugin itself.
+*/
+class TimedPluginWrapper  : public PluginWrapper
+{
+public:
+    TimedPluginWrapper (AudioPluginInstance* pluginToWrap, ProcessLoad& loadToUpdate);
+    ~TimedPluginWrapper();
+
+    /** Looks through a wrapper, if there is one, to whatever it wraps. */
+    static AudioProcessor* unwrap (AudioProcessor*) noexcept;
+
+    //==============================================================================
+    void prepareToPlay (double, int) override;
+    void processBlock (AudioBuffer<float>&, MidiBuffer&) override;
+    void processBlock (AudioBuffer<double>&, MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override { return plugin->supportsDoublePrecisionProcessing(); }
+
+private:
+    //==============================================================================
+    ProcessLoad& load;
+
+    template <typename FloatType>
+    void processTimed (AudioBuffer<FloatType>&, MidiBuffer&);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TimedPluginWrapper)
+};
@@ -0,0 +1,444 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "InputCapture.h"
+
+
+//==============================================================================
+AudioClock::AudioClock() {}
+
+double AudioClock::getTime() const noexcept
+{
+    auto sinceBlock = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - blockTicks.load());
+    return blockTime.load() + jlimit (0.0, blockLength.load(), sinceBlock);
+}
+
+void AudioClock::audioDeviceAboutToStart (AudioIODevice* device)
+{
+    sampleRate = jmax (1.0, device->getCurrentSampleRate());
+}
+
+void AudioClock::audioDeviceIOCallback (const float**, int, float** outputChannelData, int numOutputChannels, int numSamples)
+{
+    for (int ch = 0; ch < numOutputChannels; ++ch)
+        if (outputChannelData[ch] != nullptr)
+            FloatVectorOperations::clear (outputChannelData[ch], numSamples);
+
+    blockTicks = Time::getHighResolutionTicks();
+    blockLength = numSamples / sampleRate;
+    blockTime = elapsed;
+    elapsed += numSamples / sampleRate;
+}
+
+//==============================================================================
+static const int captureMagic = (int) ByteOrder::littleEndianInt ("MCAP");
+static const int captureVersion = 1;
+
+void CaptureFile::writeHeader (OutputStream& out, const String& sessionPath, const String& initialGraphXml)
+{
+    out.writeInt (captureMagic);
+    out.writeInt (captureVersion);
+    out.writeString (sessionPath);
+    out.writeString (initialGraphXml);
+}
+
+void CaptureFile::writeEvent (OutputStream& out, const CapturedEvent& e)
+{
+    out.writeDouble (e.time);
+    out.writeByte ((char) e.type);
+
+    switch (e.type)
+    {
+        case CapturedEvent::midi:
+            out.writeCompressedInt (e.message.getRawDataSize());
+            out.write (e.message.getRawData(), (size_t) e.message.getRawDataSize());
+            break;
+
+        case CapturedEvent::slotPressed:
+            out.writeInt (e.index);
+            break;
+
+        case CapturedEvent::controllerMoved:
+            out.writeInt (e.index);
+            out.writeFloat (e.value);
+            break;
+
+        case CapturedEvent::graphEdited:
+            out.writeString (e.graphXml);
+            break;
+
+        default:
+            jassertfalse;
+            break;
+    }
+}
+
+Result CaptureFile::load (const File& f)
+{
+    FileInputStream in (f);
+
+    if (in.failedToOpen())
+        return Result::fail ("Couldn't open " + f.getFullPathName());
+
+    if (in.readInt() != captureMagic || in.readInt() > captureVersion)
+        return Result::fail (f.getFileName() + " isn't an input capture");
+
+    sessionPath = in.readString();
+    initialGraphXml = in.readString();
+    events.clearQuick();
+
+    while (! in.isExhausted())
+    {
+        CapturedEvent e;
+        e.time = in.readDouble();
+        e.type = (CapturedEvent::Type) in.readByte();
+
+        switch (e.type)
+        {
+            case CapturedEvent::midi:
+            {
+                auto size = in.readCompressedInt();
+                MemoryBlock data;
+
+                if (size <= 0 || in.readIntoMemoryBlock (data, size) != (size_t) size)
+                    return Result::fail (f.getFileName() + " is truncated");
+
+                e.message = MidiMessage (data.getData(), size, 0.0);
+                e.message.setTimeStamp (e.time);
+                break;
+            }
+
+            case CapturedEvent::slotPressed:
+                e.index = in.readInt();
+                break;
+
+            case CapturedEvent::controllerMoved:
+                e.index = in.readInt();
+                e.value = in.readFloat();
+                break;
+
+            case CapturedEvent::graphEdited:
+                e.graphXml = in.readString();
+                break;
+
+            default:
+                return Result::fail (f.getFileName() + " has an unknown event in it");
+        }
+
+        events.add (e);
+    }
+
+    return Result::ok();
+}
+
+MidiMessageSequence CaptureFile::getMidiSequence() const
+{
+    MidiMessageSequence sequence;
+
+    for (auto& e : events)
+        if (e.type == CapturedEvent::midi)
+            sequence.addEvent (e.message);
+
+    sequence.updateMatchedPairs();
+    return sequence;
+}
+
+//==============================================================================
+InputCapture::InputCapture (FilterGraph& g, AudioDeviceManager& dm)
+    : graph (g), deviceManager (dm)
+{
+}
+
+InputCapture::~InputCapture()
+{
+    stop();
+}
+
+Result InputCapture::start (const File& f)
+{
+    stop();
+
+    if (! f.getParentDirectory().createDirectory())
+        return Result::fail ("Couldn't create " + f.getParentDirectory().getFullPathName());
+
+    f.deleteFile();
+    ScopedPointer<FileOutputStream> out (f.createOutputStream());
+
+    if (out == nullptr || out->failedToOpen())
+        return Result::fail ("Couldn't write to " + f.getFullPathName());
+
+    ScopedPointer<XmlElement> xml (graph.createXml());
+    CaptureFile::writeHeader (*out, graph.getFile().getFullPathName(), xml->createDocument ({}, true, false));
+
+    file = f;
+    output = out.release();
+    startTime = clock.getTime();
+
+    deviceManager.addAudioCallback (&clock);
+    deviceManager.addMidiInputCallback ({}, this);
+    graph.addListener (this);
+    startTimer (250);
+
+    return Result::ok();
+}
+
+void InputCapture::stop()
+{
+    if (output == nullptr)
+        return;
+
+    stopTimer();
+    graph.removeListener (this);
+    deviceManager.removeMidiInputCallback ({}, this);
+    deviceManager.removeAudioCallback (&clock);
+
+    flush();
+    output = nullptr;
+}
+
+//==============================================================================
+void InputCapture::record (CapturedEvent& e)
+{
+    e.time = clock.getTime() - startTime;
+
+    const ScopedLock sl (pendingLock);
+    CaptureFile::writeEvent (pending, e);
+}
+
+void InputCapture::handleIncomingMidiMessage (MidiInput*, const MidiMessage& message)
+{
+    CapturedEvent e;
+    e.type = CapturedEvent::midi;
+    e.message = message;
+    record (e);
+}
+
+void InputCapture::slotPressed (int slot)
+{
+    if (! isCapturing())
+        return;
+
+    CapturedEvent e;
+    e.type = CapturedEvent::slotPressed;
+    e.index = slot;
+    record (e);
+}
+
+void InputCapture::controllerMoved (int controller, float value)
+{
+    if (! isCapturing())
+        return;
+
+    CapturedEvent e;
+    e.type = CapturedEvent::controllerMoved;
+    e.index = controller;
+    e.value = value;
+    record (e);
+}
+
+void InputCapture::filterGraphChanged (const FilterGraph::Delta& delta)
+{
+    // moving a node around doesn't change anything a replay would notice
+    if (delta.nodesAdded.isEmpty() && delta.nodesRemoved.isEmpty()
+         && delta.connectionsAdded.isEmpty() && delta.connectionsRemoved.isEmpty())
+        return;
+
+    ScopedPointer<XmlElement> xml (graph.createXml());
+
+    // nodes that were already there keep their state when the edit is replayed, so
+    // only the new ones need theirs, which keeps a long session's capture small
+    forEachXmlChildElementWithTagName (*xml, e, "FILTER")
+        if (! delta.nodesAdded.contains ((FilterGraph::NodeID) e->getIntAttribute ("uid")))
+            e->deleteAllChildElementsWithTagName ("STATE");
+
+    CapturedEvent e;
+    e.type = CapturedEvent::graphEdited;
+    e.graphXml = xml->createDocument ({}, true, false);
+    record (e);
+}
+
+void InputCapture::timerCallback()
+{
+    flush();
+}
+
+void InputCapture::flush()
+{
+    MemoryBlock block;
+
+    {
+        const ScopedLock sl (pendingLock);
+        block = pending.getMemoryBlock();
+        pending.reset();
+    }
+
+    if (output != nullptr && block.getSize() > 0)
+    {
+        output->write (block.getData(), block.getSize());
+        output->flush();
+    }
+}
+
+//==============================================================================
+CaptureReplayer::CaptureReplayer (FilterGraph& g, AudioDeviceManager& dm, MidiMessageCollector& c)
+    : Thread ("Capture replay"), graph (g), deviceManager (dm), collector (c)
+{
+}
+
+CaptureReplayer::~CaptureReplayer()
+{
+    stop();
+}
+
+Result CaptureReplayer::start (const File& f)
+{
+    stop();
+
+    auto result = capture.load (f);
+
+    if (result.failed())
+        return result;
+
+    if (capture.initialGraphXml.isNotEmpty())
+    {
+        ScopedPointer<XmlElement> xml (XmlDocument::parse (capture.initialGraphXml));
+
+        if (xml == nullptr)
+            return Result::fail (f.getFileName() + " has a damaged graph in it");
+
+        graph.restoreFromXml (*xml);
+    }
+
+    numDueEvents = 0;
+    nextMessageThreadEvent = 0;
+    finished = false;
+
+    deviceManager.addAudioCallback (&clock);
+    clockRegistered = true;
+
+    startThread (8);
+    return Result::ok();
+}
+
+void CaptureReplayer::stop()
+{
+    stopThread (2000);
+    cancelPendingUpdate();
+
+    if (clockRegistered)
+    {
+        deviceManager.removeAudioCallback (&clock);
+        clockRegistered = false;
+    }
+}
+
+void CaptureReplayer::run()
+{
+    auto startTime = clock.getTime();
+
+    for (int i = 0; i < capture.events.size(); ++i)
+    {
+        auto& e = capture.events.getReference (i);
+
+        for (;;)
+        {
+            auto msLeft = (startTime + e.time - clock.getTime()) * 1000.0;
+
+            if (threadShouldExit())
+                return;
+
+            if (msLeft <= 0)
+                break;
+
+            if (msLeft > 2.0)
+                wait ((int) msLeft - 1);
+            else
+                Thread::yield();
+        }
+
+        if (e.type == CapturedEvent::midi)
+        {
+            // the collector expects the same timestamps the device manager gives live input
+            MidiMessage m (e.message);
+            m.setTimeStamp (Time::getMillisecondCounterHiRes() * 0.001);
+            collector.addMessageToQueue (m);
+        }
+
+        numDueEvents = i + 1;
+
+        if (e.type != CapturedEvent::midi)
+            triggerAsyncUpdate();
+    }
+
+    finished = true;
+    triggerAsyncUpdate();
+}
+
+void CaptureReplayer::handleAsyncUpdate()
+{
+    auto due = numDueEvents.load();
+
+    for (; nextMessageThreadEvent < due; ++nextMessageThreadEvent)
+    {
+        auto& e = capture.events.getReference (nextMessageThreadEvent);
+
+        switch (e.type)
+        {
+            case CapturedEvent::graphEdited:
+                if (ScopedPointer<XmlElement> xml = XmlDocument::parse (e.graphXml))
+                    graph.updateFromXml (*xml);
+                break;
+
+            case CapturedEvent::slotPressed:
+                if (onSlotPressed != nullptr)
+                    onSlotPressed (e.index);
+                break;
+
+            case CapturedEvent::controllerMoved:
+                if (onControllerMoved != nullptr)
+                    onControllerMoved (e.index, e.value);
+                break;
+
+            case CapturedEvent::midi:
+            default:
+                break;
+        }
+    }
+
+    if (finished && nextMessageThreadEvent >= capture.events.size())
+    {
+        if (clockRegistered)
+        {
+            deviceManager.removeAudioCallback (&clock);
+            clockRegistered = false;
+        }
+
+        if (onFinished != nullptr)
+            onFinished();
+    }
+}
@@ -0,0 +1,191 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+
+#pragma once
+
+#include "FilterGraph.h"
+
+
+//==============================================================================
+/**
+    Counts the audio a device has played, so that events can be timed against it.
+
+    It's registered with the device manager as an extra callback, only while it's
+    needed, and writes silence. Between callbacks the time is interpolated from the
+    high-resolution clock, up to the length of a block.
+*/
+class AudioClock  : public AudioIODeviceCallback
+{
+public:
+    AudioClock();
+
+    /** Seconds of audio since the clock was registered. Safe to call from any thread. */
+    double getTime() const noexcept;
+
+    void audioDeviceAboutToStart (AudioIODevice*) override;
+    void audioDeviceIOCallback (const float**, int, float** outputChannelData, int numOutputChannels, int numSamples) override;
+    void audioDeviceStopped() override {}
+
+private:
+    double sampleRate = 44100.0;
+    double elapsed = 0;
+    std::atomic<double> blockTime { 0 }, blockLength { 0 };
+    std::atomic<int64> blockTicks { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioClock)
+};
+
+//==============================================================================
+/** One captured input event. */
+struct CapturedEvent
+{
+    enum Type
+    {
+        midi = 0,
+        slotPressed,
+        controllerMoved,
+        graphEdited
+    };
+
+    double time = 0;    /**< Seconds on the audio clock since the capture began. */
+    Type type = midi;
+    MidiMessage message;
+    int index = 0;      /**< The slot or controller number. */
+    float value = 0;
+    String graphXml;    /**< The graph after an edit, with state only for the nodes it added. */
+};
+
+/**
+    A capture file: the graph as it was when capturing started, then every event.
+*/
+struct CaptureFile
+{
+    static const char* getFilenameSuffix()      { return ".meldcap"; }
+    static const char* getFilenameWildcard()    { return "*.meldcap"; }
+
+    String sessionPath;
+    String initialGraphXml;
+    Array<CapturedEvent> events;
+
+    Result load (const File&);
+
+    /** The MIDI events on their own, for rendering offline. */
+    MidiMessageSequence getMidiSequence() const;
+
+    static void writeHeader (OutputStream&, const String& sessionPath, const String& initialGraphXml);
+    static void writeEvent (OutputStream&, const CapturedEvent&);
+};
+
+//==============================================================================
+/**
+    Captures the host's inputs to a file: MIDI, slot presses, controller moves and
+    graph edits, each stamped with the audio clock.
+
+    MIDI is written straight into a memory buffer under a short lock, and a timer
+    on the message thread moves that buffer to disk. Graph edits come from the
+    graph's coalesced change notifications, so they're stamped when the listeners
+    hear about them, at most a UI frame after the edit itself.
+*/
+class InputCapture  : public MidiInputCallback,
+                      private FilterGraph::Listener,
+                      private Timer
+{
+public:
+    InputCapture (FilterGraph&, AudioDeviceManager&);
+    ~InputCapture();
+
+    Result start (const File&);
+    void stop();
+    bool isCapturing() const noexcept                   { return output != nullptr; }
+    File getFile() const                                { return file; }
+
+    void slotPressed (int slot);
+    void controllerMoved (int controller, float value);
+
+    void handleIncomingMidiMessage (MidiInput*, const MidiMessage&) override;
+
+private:
+    FilterGraph& graph;
+    AudioDeviceManager& deviceManager;
+    AudioClock clock;
+
+    File file;
+    ScopedPointer<FileOutputStream> output;
+    double startTime = 0;
+    CriticalSection pendingLock;
+    MemoryOutputStream pending;
+
+    void record (CapturedEvent&);
+    void flush();
+    void filterGraphChanged (const FilterGraph::Delta&) override;
+    void timerCallback() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (InputCapture)
+};
+
+//==============================================================================
+/**
+    Plays a capture file back into the host in real time.
+
+    The graph is first restored to how it was when capturing began. A thread then
+    waits for each event's time on its own audio clock: MIDI goes straight into the
+    player's collector, and everything else is handed to the message thread, where
+    graph edits are applied with FilterGraph::updateFromXml() and slot presses and
+    controller moves go to the callbacks.
+*/
+class CaptureReplayer  : private Thread,
+                         private AsyncUpdater
+{
+public:
+    CaptureReplayer (FilterGraph&, AudioDeviceManager&, MidiMessageCollector&);
+    ~CaptureReplayer();
+
+    Result start (const File&);
+    void stop();
+    bool isReplaying() const                            { return isThreadRunning(); }
+
+    std::function<void (int slot)> onSlotPressed;
+    std::function<void (int controller, float value)> onControllerMoved;
+    std::function<void()> onFinished;
+
+private:
+    FilterGraph& graph;
+    AudioDeviceManager& deviceManager;
+    MidiMessageCollector& collector;
+    AudioClock clock;
+
+    CaptureFile capture;
+    std::atomic<int> numDueEvents { 0 };
+    std::atomic<bool> finished { false };
+    int nextMessageThreadEvent = 0;
+    bool clockRegistered = false;
+
+    void run() override;
+    void handleAsyncUpdate() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CaptureReplayer)
+};
@@ -27,9 +27,612 @@
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "InternalFilters.h"
 #include "FilterGraph.h"
+#include "ConvolutionReverb.h"
+#include "Sampler.h"
+#include "Looper.h"
+#include "LoadGenerator.h"
 
 
 //==============================================================================
+InternalPlugin::InternalPlugin (const String& pluginName, const String& pluginCategory, const BusesProperties& buses)
+    : AudioPluginInstance (buses), name (pluginName), category (pluginCategory)
+{
+}
+
+void InternalPlugin::fillInPluginDescription (PluginDescription& d) const
+{
+    d.name              = name;
+    d.descriptiveName   = name;
+    d.pluginFormatName  = "Internal";
+    d.category          = category;
+    d.manufacturerName  = "MELD";
+    d.version           = ProjectInfo::versionString;
+    d.fileOrIdentifier  = name;
+    d.uid               = name.hashCode();
+    d.isInstrument      = false;
+    d.numInputChannels  = getTotalNumInputChannels();
+    d.numOutputChannels = getTotalNumOutputChannels();
+}
+
+void InternalPlugin::getStateInformation (MemoryBlock& destData)
+{
+    XmlElement xml ("STATE");
+
+    for (auto* p : getParameters())
+        if (auto* withID = dynamic_cast<AudioProcessorParameterWithID*> (p))
+            xml.setAttribute (withID->paramID, p->getValue());
+
+    writeState (xml);
+    copyXmlToBinary (xml, destData);
+}
+
+void InternalPlugin::setStateInformation (const void* data, int sizeInBytes)
+{
+    ScopedPointer<XmlElement> xml (getXmlFromBinary (data, sizeInBytes));
+
+    if (xml == nullptr)
+        return;
+
+    for (auto* p : getParameters())
+        if (auto* withID = dynamic_cast<AudioProcessorParameterWithID*> (p))
+            if (xml->hasAttribute (withID->paramID))
+                p->setValueNotifyingHost ((float) xml->getDoubleAttribute (withID->paramID));
+
+    readState (*xml);
+}
+
+//==============================================================================
+/**
+    Sums the slots into one stereo pair, with a gain, pan and mute for each.
+
+    Every gain change is ramped a sample at a time, and the sums are done with
+    FloatVectorOperations. The only buffers it uses are allocated in prepareToPlay.
+*/
+class LayerMixerProcessor  : public InternalPlugin
+{
+public:
+    enum { numInputs = FilterGraph::numSlots };
+
+    LayerMixerProcessor()
+        : InternalPlugin (InternalPluginFormat::layerMixerName, "Mixers",
+                          BusesProperties().withInput  ("Layers", AudioChannelSet::discreteChannels (numInputs * 2))
+                                           .withOutput ("Output", AudioChannelSet::stereo()))
+    {
+        for (int i = 0; i < numInputs; ++i)
+        {
+            auto n = String (i + 1);
+            auto& in = inputs[i];
+
+            addParameter (in.gain = new AudioParameterFloat ("gain" + n, "Layer " + n + " Gain",
+                                                             NormalisableRange<float> (-60.0f, 12.0f), 0.0f, "dB"));
+            addParameter (in.pan  = new AudioParameterFloat ("pan" + n, "Layer " + n + " Pan", -1.0f, 1.0f, 0.0f));
+            addParameter (in.mute = new AudioParameterBool ("mute" + n, "Layer " + n + " Mute", false));
+        }
+    }
+
+    //==============================================================================
+    void prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock) override
+    {
+        mix.setSize (2, jmax (1, maximumExpectedSamplesPerBlock));
+        ramp.setSize (1, mix.getNumSamples());
+
+        for (auto& in : inputs)
+        {
+            float l, r;
+            in.getTargetGains (l, r);
+
+            in.left.reset (sampleRate, 0.02);
+            in.right.reset (sampleRate, 0.02);
+            in.left.setValue (l, true);
+            in.right.setValue (r, true);
+        }
+    }
+
+    void releaseResources() override
+    {
+        mix.setSize (2, 0);
+        ramp.setSize (1, 0);
+    }
+
+    void processBlock (AudioBuffer<float>& buffer, MidiBuffer&) override
+    {
+        auto blockSize = mix.getNumSamples();
+
+        if (blockSize == 0)
+        {
+            buffer.clear();
+            return;
+        }
+
+        // a host that goes over its promised block size gets chunks, not an allocation
+        for (int start = 0; start < buffer.getNumSamples(); start += blockSize)
+            processChunk (buffer, start, jmin (blockSize, buffer.getNumSamples() - start));
+
+        for (int ch = 2; ch < buffer.getNumChannels(); ++ch)
+            buffer.clear (ch, 0, buffer.getNumSamples());
+    }
+
+private:
+    //==============================================================================
+    struct Input
+    {
+        AudioParameterFloat* gain = nullptr;
+        AudioParameterFloat* pan = nullptr;
+        AudioParameterBool* mute = nullptr;
+        LinearSmoothedValue<float> left, right;
+
+        void getTargetGains (float& l, float& r) const
+        {
+            auto g = mute->get() ? 0.0f : Decibels::decibelsToGain (gain->get(), -60.0f);
+            auto angle = (pan->get() + 1.0f) * float_Pi * 0.25f;
+
+            // equal power, so a centred layer sits 3dB down in each side
+            l = g * std::cos (angle);
+            r = g * std::sin (angle);
+        }
+    };
+
+    Input inputs[numInputs];
+    AudioBuffer<float> mix, ramp;
+
+    static void addInput (float* dest, const float* src, LinearSmoothedValue<float>& gain, float* rampData, int num) noexcept
+    {
+        if (! gain.isSmoothing())
+        {
+            auto g = gain.getNextValue();
+
+            if (g != 0.0f)
+                FloatVectorOperations::addWithMultiply (dest, src, g, num);
+
+            return;
+        }
+
+        for (int i = 0; i < num; ++i)
+            rampData[i] = gain.getNextValue();
+
+        FloatVectorOperations::addWithMultiply (dest, src, rampData, num);
+    }
+
+    void processChunk (AudioBuffer<float>& buffer, int start, int num) noexcept
+    {
+        mix.clear (0, num);
+
+        auto* mixL = mix.getWritePointer (0);
+        auto* mixR = mix.getWritePointer (1);
+        auto* rampData = ramp.getWritePointer (0);
+
+        for (int i = 0; i < numInputs; ++i)
+        {
+            auto chL = i * 2, chR = i * 2 + 1;
+
+            if (chR >= buffer.getNumChannels())
+                break;
+
+            auto& in = inputs[i];
+            float l, r;
+            in.getTargetGains (l, r);
+            in.left.setValue (l);
+            in.right.setValue (r);
+
+            addInput (mixL, buffer.getReadPointer (chL, start), in.left,  rampData, num);
+            addInput (mixR, buffer.getReadPointer (chR, start), in.right, rampData, num);
+        }
+
+        buffer.copyFrom (0, start, mix, 0, 0, num);
+
+        if (buffer.getNumChannels() > 1)
+            buffer.copyFrom (1, start, mix, 1, 0, num);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LayerMixerProcessor)
+};
+
+//==============================================================================
+/**
+    Sits between the MIDI input and one slot, and only lets through what that
+    slot should play: a key zone, an input channel, an optional new output channel,
+    and a velocity curve.
+
+    Notes it has let through always get their note-offs, even if the zone moves
+    while they're held. Nothing allocates after prepareToPlay; if a block ever holds
+    more than the scratch buffer's capacity, the excess is dropped, except for the
+    note-offs and all-notes-offs, which have room kept aside for them.
+*/
+class MidiRouterProcessor  : public InternalPlugin
+{
+public:
+    MidiRouterProcessor()
+        : InternalPlugin (InternalPluginFormat::midiRouterName, "MIDI", BusesProperties())
+    {
+        addParameter (lowKey     = new AudioParameterInt ("lowKey", "Lowest Key", 0, 127, 0));
+        addParameter (highKey    = new AudioParameterInt ("highKey", "Highest Key", 0, 127, 127));
+        addParameter (inChannel  = new AudioParameterInt ("inChannel", "Input Channel (0 = all)", 0, 16, 0));
+        addParameter (outChannel = new AudioParameterInt ("outChannel", "Output Channel (0 = same)", 0, 16, 0));
+        addParameter (curve      = new AudioParameterFloat ("velocityCurve", "Velocity Curve", -1.0f, 1.0f, 0.0f));
+
+        zeromem (held, sizeof (held));
+    }
+
+    bool acceptsMidi() const override       { return true; }
+    bool producesMidi() const override      { return true; }
+
+    // without an editor the plugin window would open the audio settings instead
+    bool hasEditor() const override                         { return true; }
+    AudioProcessorEditor* createEditor() override           { return new GenericAudioProcessorEditor (this); }
+
+    //==============================================================================
+    void prepareToPlay (double, int) override
+    {
+        routed.ensureSize (capacityBytes + releaseReserveBytes);
+        zeromem (held, sizeof (held));
+    }
+
+    void releaseResources() override {}
+
+    void processBlock (AudioBuffer<float>& buffer, MidiBuffer& midi) override
+    {
+        buffer.clear();
+        updateVelocityTable();
+
+        routed.clear();
+        int bytesUsed = 0;
+        uint32 channelsReleased = 0;
+
+        MidiBuffer::Iterator it (midi);
+        const uint8* data;
+        int numBytes, samplePosition;
+
+        while (it.getNextEvent (data, numBytes, samplePosition))
+        {
+            uint8 message[3];
+            bool releasesNotes = false;
+
+            if (numBytes <= 3 && data[0] < 0xf0)
+            {
+                memcpy (message, data, (size_t) numBytes);
+                releasesNotes = isRelease (message, numBytes);
+
+                if (! routeChannelMessage (message, numBytes))
+                    continue;
+
+                data = message;
+            }
+
+            auto eventBytes = numBytes + eventHeaderBytes;
+
+            if (bytesUsed + eventBytes > capacityBytes)
+            {
+                // A note-off only gets here for a note that's held, so the reserve always
+                // has room for them. All-notes-offs are let through once per channel.
+                if (! releasesNotes)
+                    continue;
+
+                if (numBytes == 3 && (message[0] & 0xf0) == 0xb0)
+                {
+                    auto channelBit = 1u << (message[0] & 0x0f);
+
+                    if ((channelsReleased & channelBit) != 0)
+                        continue;
+
+                    channelsReleased |= channelBit;
+                }
+            }
+            else
+            {
+                bytesUsed += eventBytes;
+            }
+
+            routed.addEvent (data, numBytes, samplePosition);
+        }
+
+        // every event is kept at its original size or dropped, so this always fits
+        midi.clear();
+        midi.addEvents (routed, 0, -1, 0);
+    }
+
+private:
+    //==============================================================================
+    enum
+    {
+        capacityBytes = 8192,
+        eventHeaderBytes = (int) (sizeof (int32) + sizeof (uint16)),
+        releaseReserveBytes = (16 * 128 + 16) * (3 + eventHeaderBytes)
+    };
+
+    AudioParameterInt* lowKey;
+    AudioParameterInt* highKey;
+    AudioParameterInt* inChannel;
+    AudioParameterInt* outChannel;
+    AudioParameterFloat* curve;
+
+    MidiBuffer routed;
+    bool held[16][128];
+    uint8 velocityTable[128];
+    float tableCurve = -2.0f;
+
+    void updateVelocityTable() noexcept
+    {
+        auto c = curve->get();
+
+        if (c == tableCurve)
+            return;
+
+        // positive curves lift quiet notes, negative ones push them down
+        auto exponent = std::pow (2.0f, -2.0f * c);
+        velocityTable[0] = 0;
+
+        for (int v = 1; v < 128; ++v)
+            velocityTable[v] = (uint8) jlimit (1, 127, roundToInt (127.0f * std::pow (v / 127.0f, exponent)));
+
+        tableCurve = c;
+    }
+
+    static bool isRelease (const uint8* message, int numBytes) noexcept
+    {
+        if (numBytes != 3)
+            return false;
+
+        auto type = message[0] & 0xf0;
+
+        return type == 0x80 || (type == 0x90 && message[2] == 0)
+                || (type == 0xb0 && (message[1] == 120 || message[1] == 123));
+    }
+
+    bool routeChannelMessage (uint8* message, int numBytes) noexcept
+    {
+        auto type = message[0] & 0xf0;
+        auto channel = message[0] & 0x0f;
+        auto wantedChannel = inChannel->get();
+
+        if (wantedChannel != 0 && channel != wantedChannel - 1)
+            return false;
+
+        if (numBytes == 3 && (type == 0x80 || type == 0x90 || type == 0xa0))
+        {
+            auto key = message[1] & 0x7f;
+            auto isNoteOn = (type == 0x90 && message[2] != 0);
+            auto inZone = key >= lowKey->get() && key <= highKey->get();
+
+            if (isNoteOn)
+            {
+                if (! inZone)
+                    return false;
+
+                held[channel][key] = true;
+                message[2] = velocityTable[message[2] & 0x7f];
+            }
+            else if (type == 0xa0)
+            {
+                if (! (inZone || held[channel][key]))
+                    return false;
+            }
+            else
+            {
+                if (! held[channel][key])
+                    return false;
+
+                held[channel][key] = false;
+            }
+        }
+        else if (isRelease (message, numBytes))
+        {
+            zeromem (held[channel], sizeof (held[channel]));
+        }
+
+        if (auto newChannel = outChannel->get())
+            message[0] = (uint8) (type | (newChannel - 1));
+
+        return true;
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiRouterProcessor)
+};
+
+//==============================================================================
+/**
+    The safety stage in front of the output: it zeroes any NaNs or infinities,
+    strips DC, and then runs a lookahead brickwall limiter.
+
+    The limiter looks at the larger of the two channels a block at a time with
+    FloatVectorOperations, then works out the gain with a sliding minimum over the
+    lookahead window followed by a moving average of the same length. That means
+    the gain has always reached its target by the time a peak comes out of the
+    delay line, so nothing gets past the ceiling.
+*/
+class MasterLimiterProcessor  : public InternalPlugin
+{
+public:
+    MasterLimiterProcessor()
+        : InternalPlugin (InternalPluginFormat::masterLimiterName, "Dynamics",
+                          BusesProperties().withInput  ("Input",  AudioChannelSet::stereo())
+                                           .withOutput ("Output", AudioChannelSet::stereo()))
+    {
+        addParameter (ceiling = new AudioParameterFloat ("ceiling", "Ceiling", NormalisableRange<float> (-12.0f, 0.0f), -0.3f, "dB"));
+        addParameter (release = new AudioParameterFloat ("release", "Release", NormalisableRange<float> (5.0f, 500.0f), 60.0f, "ms"));
+    }
+
+    //==============================================================================
+    void prepareToPlay (double newSampleRate, int maximumExpectedSamplesPerBlock) override
+    {
+        sampleRate = newSampleRate;
+        lookahead = jmax (1, roundToInt (sampleRate * 0.0015));
+        setLatencySamples (lookahead);
+
+        blockSize = jmax (1, maximumExpectedSamplesPerBlock);
+        scratch.setSize (2, blockSize);
+        delayLine.setSize (2, lookahead);
+        delayLine.clear();
+        delayPos = 0;
+
+        minValues.calloc ((size_t) lookahead + 1);
+        minTimes.calloc ((size_t) lookahead + 1);
+        minHead = minCount = 0;
+        sampleCount = 0;
+
+        averageLine.calloc ((size_t) lookahead);
+        averagePos = 0;
+        averageSum = lookahead;
+
+        for (int i = 0; i < lookahead; ++i)
+            averageLine[i] = 1.0f;
+
+        envelope = 1.0f;
+        dcIn[0] = dcIn[1] = dcOut[0] = dcOut[1] = 0;
+
+        // a 5Hz one-pole high-pass, well below anything a player would miss
+        dcCoefficient = (float) (1.0 - (2.0 * double_Pi * 5.0 / sampleRate));
+    }
+
+    void releaseResources() override {}
+
+    void processBlock (AudioBuffer<float>& buffer, MidiBuffer&) override
+    {
+        ScopedNoDenormals noDenormals;
+
+        if (scratch.getNumSamples() == 0 || buffer.getNumChannels() < 2)
+        {
+            buffer.clear();
+            return;
+        }
+
+        for (int start = 0; start < buffer.getNumSamples(); start += blockSize)
+            processChunk (buffer, start, jmin (blockSize, buffer.getNumSamples() - start));
+    }
+
+private:
+    //==============================================================================
+    AudioParameterFloat* ceiling;
+    AudioParameterFloat* release;
+
+    double sampleRate = 44100.0;
+    int lookahead = 0, blockSize = 0;
+    AudioBuffer<float> scratch, delayLine;
+    int delayPos = 0;
+
+    // the sliding minimum is a monotonic queue in a fixed ring
+    HeapBlock<float> minValues;
+    HeapBlock<int64> minTimes;
+    int minHead = 0, minCount = 0;
+    int64 sampleCount = 0;
+
+    HeapBlock<float> averageLine;
+    int averagePos = 0;
+    double averageSum = 0;
+
+    float envelope = 1.0f;
+    float dcIn[2], dcOut[2];
+    float dcCoefficient = 1.0f;
+
+    static void scrub (float* data, int num) noexcept
+    {
+        // x - x is only zero for finite values, and this form vectorises
+        for (int i = 0; i < num; ++i)
+            data[i] = (data[i] - data[i] == 0.0f) ? data[i] : 0.0f;
+    }
+
+    void removeDC (float* data, int num, int ch) noexcept
+    {
+        auto x1 = dcIn[ch], y1 = dcOut[ch];
+
+        for (int i = 0; i < num; ++i)
+        {
+            auto x = data[i];
+            y1 = x - x1 + dcCoefficient * y1;
+            x1 = x;
+            data[i] = y1;
+        }
+
+        JUCE_SNAP_TO_ZERO (y1);
+        dcIn[ch] = x1;
+        dcOut[ch] = y1;
+    }
+
+    float pushMinimum (float value) noexcept
+    {
+        auto capacity = lookahead + 1;
+
+        while (minCount > 0 && minValues[(minHead + minCount - 1) % capacity] >= value)
+            --minCount;
+
+        minValues[(minHead + minCount) % capacity] = value;
+        minTimes[(minHead + minCount) % capacity] = sampleCount;
+        ++minCount;
+
+        while (minTimes[minHead] <= sampleCount - capacity)
+        {
+            minHead = (minHead + 1) % capacity;
+            --minCount;
+        }
+
+        ++sampleCount;
+        return minValues[minHead];
+    }
+
+    void processChunk (AudioBuffer<float>& buffer, int start, int num) noexcept
+    {
+        auto* left  = buffer.getWritePointer (0, start);
+        auto* right = buffer.getWritePointer (1, start);
+
+        scrub (left, num);
+        scrub (right, num);
+        removeDC (left, num, 0);
+        removeDC (right, num, 1);
+
+        // the vectorised part: the per-sample peak of both channels
+        auto* peaks = scratch.getWritePointer (0);
+        auto* absRight = scratch.getWritePointer (1);
+        FloatVectorOperations::abs (peaks, left, num);
+        FloatVectorOperations::abs (absRight, right, num);
+        FloatVectorOperations::max (peaks, peaks, absRight, num);
+
+        auto limit = Decibels::decibelsToGain (ceiling->get());
+        auto releaseCoefficient = (float) (1.0 - std::exp (-1.0 / (sampleRate * release->get() * 0.001)));
+        auto* delayL = delayLine.getWritePointer (0);
+        auto* delayR = delayLine.getWritePointer (1);
+
+        for (int i = 0; i < num; ++i)
+        {
+            auto required = peaks[i] > limit ? limit / peaks[i] : 1.0f;
+            auto held = pushMinimum (required);
+
+            envelope = held < envelope ? held : envelope + (held - envelope) * releaseCoefficient;
+
+            averageSum += envelope - averageLine[averagePos];
+            averageLine[averagePos] = envelope;
+            averagePos = (averagePos + 1) % lookahead;
+
+            auto gain = jmin (1.0f, (float) (averageSum / lookahead));
+
+            auto inL = left[i], inR = right[i];
+            left[i]  = delayL[delayPos] * gain;
+            right[i] = delayR[delayPos] * gain;
+            delayL[delayPos] = inL;
+            delayR[delayPos] = inR;
+            delayPos = (delayPos + 1) % lookahead;
+        }
+
+        // the running sum slowly collects rounding error, so it's rebuilt now and then
+        if (sampleCount % (1 << 16) < num)
+        {
+            averageSum = 0;
+
+            for (int i = 0; i < lookahead; ++i)
+                averageSum += averageLine[i];
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MasterLimiterProcessor)
+};
+
+//==============================================================================
+const char* const InternalPluginFormat::convolutionReverbName = "Convolution Reverb";
+const char* const InternalPluginFormat::layerMixerName = "Layer Mixer";
+const char* const InternalPluginFormat::loadGeneratorName = "Load Generator";
+const char* const InternalPluginFormat::looperName = "Looper";
+const char* const InternalPluginFormat::masterLimiterName = "Master Limiter";
+const char* const InternalPluginFormat::midiRouterName = "MIDI Router";
+const char* const InternalPluginFormat::samplerName = "Streaming Sampler";
+
 InternalPluginFormat::InternalPluginFormat()
 {
     {
@@ -46,6 +649,24 @@ InternalPluginFormat::InternalPluginFormat()
         AudioProcessorGraph::AudioGraphIOProcessor p (AudioProcessorGraph::AudioGraphIOProcessor::midiInputNode);
         p.fillInPluginDescription (midiInDesc);
     }
+
+    LayerMixerProcessor().fillInPluginDescription (layerMixerDesc);
+    MidiRouterProcessor().fillInPluginDescription (midiRouterDesc);
+    MasterLimiterProcessor().fillInPluginDescription (masterLimiterDesc);
+    ConvolutionReverbProcessor().fillInPluginDescription (convolutionReverbDesc);
+    SamplerProcessor().fillInPluginDescription (samplerDesc);
+    LooperProcessor().fillInPluginDescription (looperDesc);
+    LoadGeneratorProcessor().fillInPluginDescription (loadGeneratorDesc);
+}
+
+AudioPluginInstance* InternalPluginFormat::createMasterLimiter()
+{
+    return new MasterLimiterProcessor();
+}
+
+AudioPluginInstance* InternalPluginFormat::createMidiRouter()
+{
+    return new MidiRouterProcessor();
 }
 
 AudioPluginInstance* InternalPluginFormat::createInstance (const String& name)
@@ -53,6 +674,13 @@ AudioPluginInstance* InternalPluginFormat::createInstance (const String& name)
     if (name == audioOutDesc.name) return new AudioProcessorGraph::AudioGraphIOProcessor (AudioProcessorGraph::AudioGraphIOProcessor::audioOutputNode);
     /*if (name == audioInDesc.name)  return new AudioProcessorGraph::AudioGraphIOProcessor (AudioProcessorGraph::AudioGraphIOProcessor::audioInputNode);*/
     if (name == midiInDesc.name)   return new AudioProcessorGraph::AudioGraphIOProcessor (AudioProcessorGraph::AudioGraphIOProcessor::midiInputNode);
+    if (name == layerMixerDesc.name) return new LayerMixerProcessor();
+    if (name == midiRouterDesc.name) return new MidiRouterProcessor();
+    if (name == masterLimiterDesc.name) return new MasterLimiterProcessor();
+    if (name == convolutionReverbDesc.name) return new ConvolutionReverbProcessor();
+    if (name == samplerDesc.name) return new SamplerProcessor();
+    if (name == looperDesc.name) return new LooperProcessor();
+    if (name == loadGeneratorDesc.name) return new LoadGeneratorProcessor();
 
     return nullptr;
 }
@@ -78,4 +706,10 @@ void InternalPluginFormat::getAllTypes (OwnedArray<PluginDescription>& results)
     //results.add (new PluginDescription (audioInDesc));
     results.add (new PluginDescription (audioOutDesc));
     results.add (new PluginDescription (midiInDesc));
+    results.add (new PluginDescription (layerMixerDesc));
+    results.add (new PluginDescription (midiRouterDesc));
+    results.add (new PluginDescription (convolutionReverbDesc));
+    results.add (new PluginDescription (samplerDesc));
+    results.add (new PluginDescription (looperDesc));
+    results.add (new PluginDescription (loadGeneratorDesc));
 }
@@ -29,6 +29,50 @@
 #include "FilterGraph.h"
 
 
+//==============================================================================
+/**
+    A base for the processors built into the host.
+
+    It fills in the description and looks after programs and state, so that the
+    subclasses only have to declare their parameters and do their processing.
+*/
+class InternalPlugin   : public AudioPluginInstance
+{
+public:
+    //==============================================================================
+    const String getName() const override                   { return name; }
+    double getTailLengthSeconds() const override            { return 0; }
+    bool acceptsMidi() const override                       { return false; }
+    bool producesMidi() const override                      { return false; }
+    AudioProcessorEditor* createEditor() override           { return nullptr; }
+    bool hasEditor() const override                         { return false; }
+
+    int getNumPrograms() override                           { return 1; }
+    int getCurrentProgram() override                        { return 0; }
+    void setCurrentProgram (int) override                   {}
+    const String getProgramName (int) override              { return {}; }
+    void changeProgramName (int, const String&) override    {}
+
+    /** Saves and restores every parameter that has an ID. */
+    void getStateInformation (MemoryBlock&) override;
+    void setStateInformation (const void*, int) override;
+
+    void fillInPluginDescription (PluginDescription&) const override;
+
+protected:
+    InternalPlugin (const String& pluginName, const String& pluginCategory, const BusesProperties&);
+
+    /** Hooks for anything a subclass keeps in its state besides its parameters. */
+    virtual void writeState (XmlElement&) const     {}
+    virtual void readState (const XmlElement&)      {}
+
+private:
+    const String name, category;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (InternalPlugin)
+};
+
+
 //==============================================================================
 /**
     Manages the internal plugin types.
@@ -41,7 +85,22 @@ public:
     ~InternalPluginFormat() {}
 
     //==============================================================================
-    PluginDescription /*audioInDesc,*/ audioOutDesc, midiInDesc;
+    PluginDescription /*audioInDesc,*/ audioOutDesc, midiInDesc, layerMixerDesc, midiRouterDesc, masterLimiterDesc, convolutionReverbDesc, samplerDesc, looperDesc, loadGeneratorDesc;
+
+    /** The processor names the graph uses to find its internal nodes again. */
+    static const char* const layerMixerName;
+    static const char* const midiRouterName;
+    static const char* const masterLimiterName;
+    static const char* const convolutionReverbName;
+    static const char* const samplerName;
+    static const char* const looperName;
+    static const char* const loadGeneratorName;
+
+    /** The graph puts one of these in front of each slot as it's filled. */
+    static AudioPluginInstance* createMidiRouter();
+
+    /** The graph always keeps one of these between everything else and the output. */
+    static AudioPluginInstance* createMasterLimiter();
 
     void getAllTypes (OwnedArray<PluginDescription>&);
 
@@ -0,0 +1,354 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "LatencyReport.h"
+#include <unordered_map>
+
+
+//==============================================================================
+using IOProcessor = AudioProcessorGraph::AudioGraphIOProcessor;
+
+static bool isIONode (AudioProcessorGraph::Node* node, IOProcessor::IODeviceType type)
+{
+    if (auto* io = dynamic_cast<IOProcessor*> (node->getProcessor()))
+        return io->getType() == type;
+
+    return false;
+}
+
+struct PathFinder
+{
+    using NodeID = AudioProcessorGraph::NodeID;
+
+    PathFinder (AudioProcessorGraph& g, Array<LatencyReport::Path>& p)  : graph (g), paths (p)
+    {
+        for (auto& c : graph.getConnections())
+        {
+            auto& next = destinations[c.source.nodeID];
+
+            if (! next.contains (c.destination.nodeID))
+                next.add (c.destination.nodeID);
+
+            hasInputs[c.destination.nodeID] = true;
+        }
+    }
+
+    bool findAll()
+    {
+        for (auto* node : graph.getNodes())
+        {
+            if (hasInputs[node->nodeID] || destinations.count (node->nodeID) == 0)
+                continue;
+
+            LatencyReport::Path path;
+            path.fromAudioInput = isIONode (node, IOProcessor::audioInputNode);
+
+            if (! follow (node, path))
+                return false;
+        }
+
+        return true;
+    }
+
+    bool follow (AudioProcessorGraph::Node* node, LatencyReport::Path path)
+    {
+        auto* processor = node->getProcessor();
+        path.stages.add ({ processor->getName(), processor->getLatencySamples() });
+
+        if (isIONode (node, IOProcessor::audioOutputNode))
+        {
+            if (paths.size() >= LatencyReport::maxPaths)
+                return false;
+
+            paths.add (path);
+            return true;
+        }
+
+        for (auto id : destinations[node->nodeID])
+            if (auto* next = graph.getNodeForId (id))
+                if (! follow (next, path))
+                    return false;
+
+        return true;
+    }
+
+    AudioProcessorGraph& graph;
+    Array<LatencyReport::Path>& paths;
+    std::unordered_map<NodeID, Array<NodeID>> destinations;
+    std::unordered_map<NodeID, bool> hasInputs;
+};
+
+//==============================================================================
+int LatencyReport::Path::getGraphLatency() const noexcept
+{
+    int total = 0;
+
+    for (auto& stage : stages)
+        total += stage.latencySamples;
+
+    return total;
+}
+
+LatencyReport::LatencyReport (AudioProcessorGraph& graph, AudioIODevice* device, double extraLatencySeconds)
+{
+    if (device != nullptr)
+    {
+        deviceName = device->getName();
+        sampleRate = device->getCurrentSampleRate();
+        blockSize = device->getCurrentBufferSizeSamples();
+        inputLatency = device->getInputLatencyInSamples();
+        outputLatency = device->getOutputLatencyInSamples();
+    }
+    else
+    {
+        sampleRate = graph.getSampleRate();
+        blockSize = graph.getBlockSize();
+    }
+
+    extraLatency = roundToInt (extraLatencySeconds * sampleRate);
+
+    // the graph refuses feedback loops, so every path comes to an end
+    pathsTruncated = ! PathFinder (graph, paths).findAll();
+
+    std::stable_sort (paths.begin(), paths.end(),
+                      [this] (const Path& a, const Path& b) { return getTotalLatency (a) > getTotalLatency (b); });
+}
+
+int LatencyReport::getTotalLatency (const Path& path) const noexcept
+{
+    return (path.fromAudioInput ? inputLatency : 0) + blockSize + extraLatency
+             + path.getGraphLatency() + outputLatency;
+}
+
+String LatencyReport::formatSamples (int samples) const
+{
+    String s;
+    s << samples << " samples";
+
+    if (sampleRate > 0)
+        s << " (" << String (samples * 1000.0 / sampleRate, 2) << " ms)";
+
+    return s;
+}
+
+String LatencyReport::toString() const
+{
+    String s;
+
+    s << "Device: " << (deviceName.isNotEmpty() ? deviceName : String ("none"))
+      << ", " << String (sampleRate, 0) << " Hz" << newLine
+      << "  Input latency:      " << formatSamples (inputLatency) << newLine
+      << "  Block:              " << formatSamples (blockSize) << newLine
+      << "  Output latency:     " << formatSamples (outputLatency) << newLine;
+
+    if (extraLatency > 0)
+        s << "  Rate conversion:    " << formatSamples (extraLatency) << newLine;
+
+    s << "  Device round trip:  " << formatSamples (getDeviceRoundTrip()) << newLine << newLine;
+
+    if (paths.isEmpty())
+    {
+        s << "Nothing in the graph reaches the output." << newLine;
+        return s;
+    }
+
+    s << "Paths to the output, worst first. Notes from MIDI inputs start at the block," << newLine
+      << "and each node's own latency is in brackets:" << newLine << newLine;
+
+    for (auto& path : paths)
+    {
+        s << "  " << formatSamples (getTotalLatency (path)) << newLine << "    ";
+
+        for (int i = 0; i < path.stages.size(); ++i)
+        {
+            auto& stage = path.stages.getReference (i);
+
+            if (i > 0)
+                s << " > ";
+
+            s << stage.name;
+
+            if (stage.latencySamples != 0)
+                s << " [" << stage.latencySamples << "]";
+        }
+
+        s << newLine;
+    }
+
+    if (pathsTruncated)
+        s << newLine << "Only the first " << (int) maxPaths << " paths are listed." << newLine;
+
+    return s;
+}
+
+//==============================================================================
+LatencyMeasurer::LatencyMeasurer (AudioDeviceManager& dm)  : deviceManager (dm) {}
+
+LatencyMeasurer::~LatencyMeasurer()
+{
+    stop();
+}
+
+void LatencyMeasurer::start (int outChannel, int inChannel)
+{
+    stop();
+
+    outputChannel = outChannel;
+    inputChannel = inChannel;
+    outputIndex = inputIndex = -1;
+    numFinished = 0;
+    measuring = true;
+
+    // an open device prepares the callback straight away, so the channels can be checked here
+    deviceManager.addAudioCallback (this);
+
+    if (outputIndex < 0 || inputIndex < 0)
+    {
+        stop();
+
+        if (onFinished != nullptr)
+            onFinished (Result::fail ("The output and input to measure between both need to be enabled in the audio settings."), 0);
+
+        return;
+    }
+
+    startTimer (50);
+}
+
+void LatencyMeasurer::stop()
+{
+    if (! measuring)
+        return;
+
+    stopTimer();
+    deviceManager.removeAudioCallback (this);
+    measuring = false;
+}
+
+//==============================================================================
+static int getActiveIndex (const BigInteger& activeChannels, int channel)
+{
+    if (! activeChannels[channel])
+        return -1;
+
+    int index = 0;
+
+    for (int i = 0; i < channel; ++i)
+        if (activeChannels[i])
+            ++index;
+
+    return index;
+}
+
+void LatencyMeasurer::audioDeviceAboutToStart (AudioIODevice* device)
+{
+    // the callback is only handed the active channels, packed together
+    outputIndex = getActiveIndex (device->getActiveOutputChannels(), outputChannel);
+    inputIndex  = getActiveIndex (device->getActiveInputChannels(), inputChannel);
+
+    auto rate = device->getCurrentSampleRate();
+    clickSpacing = roundToInt (rate * 0.25);
+    timeout = roundToInt (rate) + 4 * device->getCurrentBufferSizeSamples();
+
+    position = 0;
+    nextClick = clickSpacing;
+    clickSentAt = -1;
+}
+
+void LatencyMeasurer::audioDeviceIOCallback (const float** inputChannelData, int numInputChannels,
+                                             float** outputChannelData, int numOutputChannels, int numSamples)
+{
+    for (int ch = 0; ch < numOutputChannels; ++ch)
+        if (outputChannelData[ch] != nullptr)
+            FloatVectorOperations::clear (outputChannelData[ch], numSamples);
+
+    auto finished = numFinished.load (std::memory_order_relaxed);
+
+    if (finished >= numClicks || ! isPositiveAndBelow (outputIndex, numOutputChannels)
+         || ! isPositiveAndBelow (inputIndex, numInputChannels))
+        return;
+
+    // listening comes before sending, since nothing can come back in the block it went out in
+    if (clickSentAt >= 0)
+    {
+        auto* in = inputChannelData[inputIndex];
+        int found = -1;
+
+        for (int i = 0; i < numSamples && found < 0; ++i)
+            if (std::abs (in[i]) > 0.25f)
+                found = i;
+
+        if (found >= 0 || position + numSamples - clickSentAt > timeout)
+        {
+            roundTrips[finished] = found >= 0 ? (int) (position + found - clickSentAt) : -1;
+            numFinished.store (++finished, std::memory_order_release);
+
+            nextClick = position + jmax (0, found) + clickSpacing;
+            clickSentAt = -1;
+        }
+    }
+
+    if (clickSentAt < 0 && finished < numClicks
+         && nextClick >= position && nextClick < position + numSamples)
+    {
+        outputChannelData[outputIndex][nextClick - position] = 0.5f;
+        clickSentAt = nextClick;
+    }
+
+    if (clickSentAt < 0 && nextClick < position)
+        nextClick = position + numSamples;
+
+    position += numSamples;
+}
+
+void LatencyMeasurer::audioDeviceStopped() {}
+
+void LatencyMeasurer::timerCallback()
+{
+    if (numFinished.load (std::memory_order_acquire) < numClicks)
+        return;
+
+    stop();
+
+    Array<int> results;
+
+    for (auto r : roundTrips)
+        if (r >= 0)
+            results.add (r);
+
+    results.sort();
+
+    if (onFinished == nullptr)
+        return;
+
+    if (results.isEmpty())
+        onFinished (Result::fail ("None of the clicks came back. Check that the output is connected to the input, "
+                                  "and that both are enabled in the audio settings."), 0);
+    else
+        onFinished (Result::ok(), results[results.size() / 2]);
+}
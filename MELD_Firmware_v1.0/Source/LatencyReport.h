@@ -0,0 +1,144 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+
+#pragma once
+
+#include <atomic>
+
+
+//==============================================================================
+/**
+    Works out how late each path through a graph gets to the output.
+
+    A path's latency is everything between a sound going in, or a note arriving,
+    and it coming out: the device's input latency for paths that start at the
+    audio input, a block of buffering, the reported latency of every node along
+    the way, any rate conversion, and the device's output latency. The graph
+    doesn't compensate for latency, so paths that meet can disagree, and each
+    one is listed.
+*/
+class LatencyReport
+{
+public:
+    /** Describes the graph as it stands, playing through the given device, which can be null.
+        Anything the host adds between the device and the graph can be given in seconds.
+    */
+    LatencyReport (AudioProcessorGraph&, AudioIODevice*, double extraLatencySeconds = 0);
+
+    struct Stage
+    {
+        String name;
+        int latencySamples = 0;
+    };
+
+    struct Path
+    {
+        Array<Stage> stages;
+        bool fromAudioInput = false;
+
+        /** The total of what the nodes along this path report. */
+        int getGraphLatency() const noexcept;
+    };
+
+    //==============================================================================
+    String deviceName;
+    double sampleRate = 0;
+    int blockSize = 0, inputLatency = 0, outputLatency = 0, extraLatency = 0;
+
+    /** Every path from a node with no inputs to the audio output, worst first. */
+    Array<Path> paths;
+    bool pathsTruncated = false;
+
+    enum { maxPaths = 256 };
+
+    /** What the device and host add on their own, from the input back out to the output. */
+    int getDeviceRoundTrip() const noexcept     { return inputLatency + blockSize + extraLatency + outputLatency; }
+
+    int getTotalLatency (const Path&) const noexcept;
+
+    String toString() const;
+
+private:
+    //==============================================================================
+    String formatSamples (int samples) const;
+
+    JUCE_LEAK_DETECTOR (LatencyReport)
+};
+
+//==============================================================================
+/**
+    Measures a device's real round trip, by sending clicks out of one channel and
+    timing how long they take to come back in on another.
+
+    The two can be joined with a cable, or be the looped-back pair of the virtual
+    Loopback device. It runs alongside whatever else the device manager is playing,
+    so the graph's output should be quiet on the input being listened to. Each click is
+    sent once the last one has come back or given up, and the median of the ones
+    that came back is the result.
+*/
+class LatencyMeasurer  : public AudioIODeviceCallback,
+                         private Timer
+{
+public:
+    LatencyMeasurer (AudioDeviceManager&);
+    ~LatencyMeasurer();
+
+    /** Starts measuring between two of the device's channels, numbered as the device numbers them. */
+    void start (int outputChannel, int inputChannel);
+    void stop();
+    bool isMeasuring() const noexcept                   { return measuring; }
+
+    /** Called on the message thread with the round trip in samples, once every click is accounted for. */
+    std::function<void (const Result&, int roundTripSamples)> onFinished;
+
+    enum { numClicks = 8 };
+
+    //==============================================================================
+    void audioDeviceAboutToStart (AudioIODevice*) override;
+    void audioDeviceIOCallback (const float** inputChannelData, int numInputChannels,
+                                float** outputChannelData, int numOutputChannels, int numSamples) override;
+    void audioDeviceStopped() override;
+
+private:
+    //==============================================================================
+    AudioDeviceManager& deviceManager;
+    bool measuring = false;
+    int outputChannel = 0, inputChannel = 0;
+
+    // set up before the callbacks start, then only touched by the audio thread
+    int outputIndex = -1, inputIndex = -1;
+    int clickSpacing = 0, timeout = 0;
+    int64 position = 0, nextClick = 0, clickSentAt = -1;
+
+    // filled in by the audio thread, with -1 for a click that never came back
+    int roundTrips[numClicks] = {};
+    std::atomic<int> numFinished { 0 };
+
+    void timerCallback() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LatencyMeasurer)
+};
@@ -0,0 +1,153 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "LevelMeter.h"
+#include "SpectrumAnalyser.h"
+
+
+//==============================================================================
+static float getSumOfSquares (const float* data, int numSamples) noexcept
+{
+    // four independent sums, so the compiler is free to keep them in one vector register
+    float s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    int i = 0;
+
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        s0 += data[i]     * data[i];
+        s1 += data[i + 1] * data[i + 1];
+        s2 += data[i + 2] * data[i + 2];
+        s3 += data[i + 3] * data[i + 3];
+    }
+
+    for (; i < numSamples; ++i)
+        s0 += data[i] * data[i];
+
+    return (s0 + s1) + (s2 + s3);
+}
+
+template <typename Type, typename Combine>
+static void combineAtomically (std::atomic<Type>& value, Type other, Combine combine) noexcept
+{
+    auto current = value.load (std::memory_order_relaxed);
+
+    while (! value.compare_exchange_weak (current, combine (current, other), std::memory_order_relaxed))
+    {}
+}
+
+//==============================================================================
+void LevelMeter::process (const float* const* channels, int numChannels, int numSamples) noexcept
+{
+    if (numSamples <= 0)
+        return;
+
+    float blockPeak = 0, blockSum = 0;
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        auto range = FloatVectorOperations::findMinAndMax (channels[ch], numSamples);
+        blockPeak = jmax (blockPeak, -range.getStart(), range.getEnd());
+        blockSum += getSumOfSquares (channels[ch], numSamples);
+    }
+
+    // NaNs fail every comparison, so they'd otherwise slip past the clip light
+    if (blockPeak >= 1.0f || ! std::isfinite (blockSum))
+        clipped.store (true, std::memory_order_relaxed);
+
+    if (! std::isfinite (blockSum))
+        return;
+
+    combineAtomically (peak, blockPeak, [] (float a, float b) { return jmax (a, b); });
+
+    // if nobody's reading, start again rather than letting the sum drift out of range
+    if (numSamplesSummed.load (std::memory_order_relaxed) > (1 << 22))
+    {
+        sumOfSquares.store (0, std::memory_order_relaxed);
+        numSamplesSummed.store (0, std::memory_order_relaxed);
+    }
+
+    combineAtomically (sumOfSquares, blockSum, [] (float a, float b) { return a + b; });
+    numSamplesSummed.fetch_add (numSamples * jmax (1, numChannels), std::memory_order_release);
+}
+
+LevelMeter::Reading LevelMeter::read() noexcept
+{
+    Reading r;
+
+    auto count = numSamplesSummed.exchange (0, std::memory_order_acquire);
+    auto sum = sumOfSquares.exchange (0, std::memory_order_relaxed);
+
+    r.peak = peak.exchange (0, std::memory_order_relaxed);
+    r.rms = count > 0 ? std::sqrt (sum / (float) count) : 0.0f;
+    r.clipped = clipped.exchange (false, std::memory_order_relaxed);
+    return r;
+}
+
+void LevelMeter::reset() noexcept
+{
+    read();
+}
+
+//==============================================================================
+MeterTapProcessor::MeterTapProcessor (LevelMeter* m, int num, SpectrumAnalyser* a)
+    : AudioProcessor (BusesProperties().withInput ("Input", AudioChannelSet::discreteChannels (num * 2))),
+      meters (m), numMeters (num), analyser (a)
+{
+}
+
+void MeterTapProcessor::prepareToPlay (double sampleRate, int)
+{
+    if (analyser != nullptr)
+        analyser->setSampleRate (sampleRate);
+
+    for (int i = 0; i < numMeters; ++i)
+        meters[i].reset();
+}
+
+void MeterTapProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer&)
+{
+    auto mask = activeMeters.load (std::memory_order_relaxed);
+    auto numSamples = buffer.getNumSamples();
+
+    if (analyser != nullptr)
+    {
+        auto source = analyser->getSource();
+
+        if (isPositiveAndBelow (source, numMeters) && (mask & (1u << source)) != 0
+             && source * 2 + 1 < buffer.getNumChannels())
+            analyser->push (buffer.getReadPointer (source * 2), buffer.getReadPointer (source * 2 + 1), numSamples);
+    }
+
+    for (int i = 0; i < numMeters && mask != 0; ++i, mask >>= 1)
+    {
+        if ((mask & 1) != 0 && i * 2 + 1 < buffer.getNumChannels())
+        {
+            const float* channels[] = { buffer.getReadPointer (i * 2), buffer.getReadPointer (i * 2 + 1) };
+            meters[i].process (channels, 2, numSamples);
+        }
+    }
+}
@@ -0,0 +1,113 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <atomic>
+
+class SpectrumAnalyser;
+
+//==============================================================================
+/**
+    Peak, RMS and clip levels for a group of channels.
+
+    The audio thread folds each block in with process(), and the message thread
+    collects whatever has built up since its last look with read(). Both sides
+    only touch atomics, so neither can block the other.
+*/
+class LevelMeter
+{
+public:
+    LevelMeter() noexcept {}
+
+    struct Reading
+    {
+        float peak = 0, rms = 0;
+        bool clipped = false;
+    };
+
+    /** Called on the audio thread. */
+    void process (const float* const* channels, int numChannels, int numSamples) noexcept;
+
+    /** Returns the levels since the last call, and starts collecting afresh. */
+    Reading read() noexcept;
+
+    void reset() noexcept;
+
+private:
+    std::atomic<float> peak { 0.0f }, sumOfSquares { 0.0f };
+    std::atomic<int> numSamplesSummed { 0 };
+    std::atomic<bool> clipped { false };
+
+    JUCE_DECLARE_NON_COPYABLE (LevelMeter)
+};
+
+//==============================================================================
+/**
+    A sink node that feeds a bank of LevelMeters.
+
+    Each meter listens to a pair of input channels, so a node can be metered by
+    connecting its outputs in parallel with wherever they already go. It has no
+    outputs and isn't a plugin, so it never gets saved with the graph.
+
+    It can also hand whichever pair a SpectrumAnalyser is watching over to it.
+*/
+class MeterTapProcessor  : public AudioProcessor
+{
+public:
+    MeterTapProcessor (LevelMeter* meters, int numMeters, SpectrumAnalyser* analyser = nullptr);
+
+    /** Meters whose bit isn't set here are skipped by the audio thread. */
+    void setActiveMeters (uint32 mask) noexcept             { activeMeters = mask; }
+
+    //==============================================================================
+    const String getName() const override                   { return "Level Meters"; }
+    void prepareToPlay (double, int) override;
+    void releaseResources() override                        {}
+    void processBlock (AudioBuffer<float>&, MidiBuffer&) override;
+
+    double getTailLengthSeconds() const override            { return 0; }
+    bool acceptsMidi() const override                       { return false; }
+    bool producesMidi() const override                      { return false; }
+    AudioProcessorEditor* createEditor() override           { return nullptr; }
+    bool hasEditor() const override                         { return false; }
+
+    int getNumPrograms() override                           { return 1; }
+    int getCurrentProgram() override                        { return 0; }
+    void setCurrentProgram (int) override                   {}
+    const String getProgramName (int) override              { return {}; }
+    void changeProgramName (int, const String&) override    {}
+    void getStateInformation (MemoryBlock&) override        {}
+    void setStateInformation (const void*, int) override    {}
+
+private:
+    LevelMeter* meters;
+    const int numMeters;
+    SpectrumAnalyser* analyser;
+    std::atomic<uint32> activeMeters { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MeterTapProcessor)
+};
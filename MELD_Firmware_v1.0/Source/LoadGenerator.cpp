@@ -0,0 +1,228 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "LoadGenerator.h"
+
+
+//==============================================================================
+LoadGeneratorProcessor::LoadGeneratorProcessor()
+    : InternalPlugin (InternalPluginFormat::loadGeneratorName, "Diagnostics",
+                      BusesProperties().withInput  ("Input",  AudioChannelSet::stereo())
+                                       .withOutput ("Output", AudioChannelSet::stereo()))
+{
+    addParameter (cpuMode        = new AudioParameterChoice ("cpuMode", "CPU Mode", { "Fixed", "Random", "Spiky" }, fixedLoad));
+    addParameter (cpuLoad        = new AudioParameterFloat ("cpuLoad", "CPU Load", NormalisableRange<float> (0.0f, 150.0f), 10.0f, "%"));
+    addParameter (spikeLoad      = new AudioParameterFloat ("spikeLoad", "Spike Load", NormalisableRange<float> (0.0f, 500.0f), 120.0f, "%"));
+    addParameter (spikeInterval  = new AudioParameterInt ("spikeInterval", "Spike Every (blocks)", 2, 1000, 100));
+    addParameter (allocation     = new AudioParameterChoice ("allocation", "Allocation", { "None", "Every Block", "On Spikes" }, noAllocation));
+    addParameter (allocationSize = new AudioParameterInt ("allocationSize", "Allocation Size (KB)", 1, 65536, 64));
+    addParameter (latency        = new AudioParameterInt ("latency", "Latency (samples)", 0, maxLatencySamples, 0));
+    addParameter (tail           = new AudioParameterFloat ("tail", "Tail", NormalisableRange<float> (0.0f, 30.0f), 0.0f, "s"));
+    addParameter (stallInterval  = new AudioParameterFloat ("stallInterval", "Stall Every", NormalisableRange<float> (0.0f, 60.0f), 0.0f, "s"));
+    addParameter (stallLength    = new AudioParameterFloat ("stallLength", "Stall Length", NormalisableRange<float> (1.0f, 1000.0f), 50.0f, "ms"));
+    addParameter (seed           = new AudioParameterInt ("seed", "Seed", 0, 9999, 1));
+
+    latency->addListener (this);
+}
+
+LoadGeneratorProcessor::~LoadGeneratorProcessor()
+{
+    latency->removeListener (this);
+    cancelPendingUpdate();
+}
+
+//==============================================================================
+bool LoadGeneratorProcessor::canAddBus (bool isInput) const
+{
+    return getBusCount (isInput) < maxBusesPerSide;
+}
+
+bool LoadGeneratorProcessor::canRemoveBus (bool isInput) const
+{
+    return getBusCount (isInput) > 1;
+}
+
+bool LoadGeneratorProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
+{
+    if (layouts.getMainOutputChannelSet().isDisabled())
+        return false;
+
+    for (auto* buses : { &layouts.inputBuses, &layouts.outputBuses })
+        for (auto& set : *buses)
+            if (set.size() > 2)
+                return false;
+
+    return true;
+}
+
+//==============================================================================
+void LoadGeneratorProcessor::parameterValueChanged (int, float)
+{
+    // automation can arrive on the audio thread, and the host mustn't hear about latency there
+    triggerAsyncUpdate();
+}
+
+void LoadGeneratorProcessor::handleAsyncUpdate()
+{
+    setLatencySamples (latency->get());
+}
+
+double LoadGeneratorProcessor::getTailLengthSeconds() const
+{
+    return tail->get();
+}
+
+AudioProcessorEditor* LoadGeneratorProcessor::createEditor()
+{
+    return new GenericAudioProcessorEditor (this);
+}
+
+//==============================================================================
+void LoadGeneratorProcessor::prepareToPlay (double sampleRate, int)
+{
+    currentSampleRate = sampleRate;
+    setLatencySamples (latency->get());
+
+    delayLine.setSize (jmax (1, getTotalNumOutputChannels()), maxLatencySamples + 1);
+    delayLine.clear();
+    delayPos = 0;
+
+    blockCount = 0;
+    samplesSinceStall = 0;
+    random.setSeed (seed->get());
+}
+
+void LoadGeneratorProcessor::releaseResources()
+{
+    delayLine.setSize (1, 0);
+}
+
+void LoadGeneratorProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer&)
+{
+    auto start = Time::getHighResolutionTicks();
+    auto numSamples = buffer.getNumSamples();
+
+    for (int ch = getTotalNumInputChannels(); ch < buffer.getNumChannels(); ++ch)
+        buffer.clear (ch, 0, numSamples);
+
+    delay (buffer);
+
+    auto mode = (CpuMode) cpuMode->getIndex();
+    auto isSpike = (++blockCount % spikeInterval->get()) == 0;
+
+    auto allocationMode = (AllocationMode) allocation->getIndex();
+
+    if (allocationMode == allocateEveryBlock || (allocationMode == allocateOnSpikes && isSpike))
+        allocateAndTouch (allocationSize->get() * 1024);
+
+    // the stall is a sleep rather than a burn, like a plugin waiting on a lock or the disk
+    auto stallEvery = stallInterval->get();
+
+    if (stallEvery > 0)
+    {
+        samplesSinceStall += numSamples;
+
+        if (samplesSinceStall >= (int64) (stallEvery * currentSampleRate))
+        {
+            samplesSinceStall = 0;
+            Thread::sleep (roundToInt (stallLength->get()));
+        }
+    }
+
+    auto share = cpuLoad->get() * 0.01;
+
+    if (mode == randomLoad)
+        share *= random.nextDouble();
+    else if (mode == spikyLoad && isSpike)
+        share = spikeLoad->get() * 0.01;
+
+    auto budget = numSamples / currentSampleRate;
+    burnUntil (start + Time::secondsToHighResolutionTicks (share * budget));
+}
+
+//==============================================================================
+void LoadGeneratorProcessor::delay (AudioBuffer<float>& buffer) noexcept
+{
+    auto delaySamples = jlimit (0, (int) maxLatencySamples, latency->get());
+    auto lineSize = delayLine.getNumSamples();
+
+    if (delaySamples == 0 || lineSize == 0)
+        return;
+
+    auto numChannels = jmin (buffer.getNumChannels(), delayLine.getNumChannels());
+    auto writePos = delayPos;
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        auto* data = buffer.getWritePointer (ch);
+        auto* line = delayLine.getWritePointer (ch);
+        writePos = delayPos;
+
+        for (int i = 0; i < buffer.getNumSamples(); ++i)
+        {
+            auto readPos = writePos - delaySamples;
+
+            if (readPos < 0)
+                readPos += lineSize;
+
+            line[writePos] = data[i];
+            data[i] = line[readPos];
+
+            if (++writePos == lineSize)
+                writePos = 0;
+        }
+    }
+
+    delayPos = writePos;
+}
+
+void LoadGeneratorProcessor::burnUntil (int64 ticks) noexcept
+{
+    // real arithmetic rather than a bare spin, so the core is genuinely busy
+    volatile double sink = 0;
+    double phase = 0;
+
+    while (Time::getHighResolutionTicks() < ticks)
+    {
+        for (int i = 0; i < 64; ++i)
+        {
+            phase += 0.001;
+            sink = sink + std::sin (phase);
+        }
+    }
+}
+
+void LoadGeneratorProcessor::allocateAndTouch (int numBytes)
+{
+    // touching one byte a page makes the system actually hand the memory over
+    HeapBlock<char> block ((size_t) numBytes);
+    volatile char* bytes = block.get();
+
+    for (int i = 0; i < numBytes; i += 4096)
+        bytes[i] = (char) i;
+}
@@ -0,0 +1,113 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+
+#pragma once
+
+#include "InternalFilters.h"
+
+
+//==============================================================================
+/**
+    A stand-in for a badly behaved plugin, for stress-testing the host.
+
+    Its audio is passed through, delayed by whatever latency it reports. Everything
+    else it does is wasted effort, set by its parameters:
+     - it burns a share of each block's time budget, either a fixed share, a random
+       share up to that, or a low share with a spike every so many blocks;
+     - it can allocate and touch memory on the audio thread, on every block or only
+       every "Spike Every" blocks, whichever CPU mode it's in;
+     - it can sleep for a while every so often, like a plugin stuck on a lock or on
+       the disk;
+     - it reports whatever latency and tail it's told to. A latency change may come
+       from any thread, so it's reported to the host from the message thread.
+
+    Its buses can be added from the I/O configuration window like any other plugin's.
+    The random choices come from a seeded generator that restarts in prepareToPlay,
+    so a run can be repeated exactly.
+*/
+class LoadGeneratorProcessor  : public InternalPlugin,
+                                private AudioProcessorParameter::Listener,
+                                private AsyncUpdater
+{
+public:
+    LoadGeneratorProcessor();
+    ~LoadGeneratorProcessor();
+
+    //==============================================================================
+    void prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock) override;
+    void releaseResources() override;
+    void processBlock (AudioBuffer<float>&, MidiBuffer&) override;
+
+    double getTailLengthSeconds() const override;
+
+    bool hasEditor() const override                         { return true; }
+    AudioProcessorEditor* createEditor() override;
+
+    enum
+    {
+        maxLatencySamples   = 8192,
+        maxBusesPerSide     = 8
+    };
+
+protected:
+    bool canAddBus (bool isInput) const override;
+    bool canRemoveBus (bool isInput) const override;
+    bool isBusesLayoutSupported (const BusesLayout&) const override;
+
+private:
+    //==============================================================================
+    enum CpuMode        { fixedLoad = 0, randomLoad, spikyLoad };
+    enum AllocationMode { noAllocation = 0, allocateEveryBlock, allocateOnSpikes };
+
+    AudioParameterChoice* cpuMode;
+    AudioParameterFloat* cpuLoad;
+    AudioParameterFloat* spikeLoad;
+    AudioParameterInt* spikeInterval;
+    AudioParameterChoice* allocation;
+    AudioParameterInt* allocationSize;
+    AudioParameterInt* latency;
+    AudioParameterFloat* tail;
+    AudioParameterFloat* stallInterval;
+    AudioParameterFloat* stallLength;
+    AudioParameterInt* seed;
+
+    double currentSampleRate = 44100.0;
+    AudioBuffer<float> delayLine;
+    int delayPos = 0;
+    int64 blockCount = 0, samplesSinceStall = 0;
+    Random random;
+
+    void parameterValueChanged (int, float) override;
+    void parameterGestureChanged (int, bool) override {}
+    void handleAsyncUpdate() override;
+
+    void delay (AudioBuffer<float>&) noexcept;
+    static void burnUntil (int64 ticks) noexcept;
+    static void allocateAndTouch (int numBytes);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LoadGeneratorProcessor)
+};
@@ -0,0 +1,511 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "Looper.h"
+
+
+//==============================================================================
+struct LooperProcessor::Exporter  : public Thread
+{
+    Exporter (LooperProcessor& p)  : Thread ("Loop exporter"), owner (p)
+    {
+        startThread (3);
+    }
+
+    ~Exporter()
+    {
+        signalThreadShouldExit();
+        notify();
+        stopThread (10000);
+    }
+
+    void setDestination (const File& f)
+    {
+        const ScopedLock sl (lock);
+        destination = f;
+    }
+
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            auto layer = owner.exportingLayer.load (std::memory_order_acquire);
+
+            // the audio thread can't wake us without risking a lock, so this polls
+            if (layer < 0)
+            {
+                wait (pollMilliseconds);
+                continue;
+            }
+
+            File f;
+
+            {
+                const ScopedLock sl (lock);
+                f = destination;
+            }
+
+            write (owner.layers[layer], owner.exportLength.load(), f);
+
+            // hands the layer back, so the audio thread can record over it again
+            owner.exportingLayer.store (-1, std::memory_order_release);
+        }
+    }
+
+    void write (const AudioBuffer<float>& source, int length, const File& f)
+    {
+        if (f == File() || ! f.deleteFile())
+            return;
+
+        ScopedPointer<FileOutputStream> out (f.createOutputStream());
+
+        if (out == nullptr)
+            return;
+
+        WavAudioFormat wav;
+
+        ScopedPointer<AudioFormatWriter> writer (wav.createWriterFor (out, owner.currentSampleRate.load(),
+                                                                      (unsigned int) source.getNumChannels(),
+                                                                      24, {}, 0));
+
+        if (writer != nullptr)
+        {
+            out.release();
+            writer->writeFromAudioSampleBuffer (source, 0, length);
+        }
+    }
+
+    enum { pollMilliseconds = 50 };
+
+    LooperProcessor& owner;
+    CriticalSection lock;
+    File destination;
+};
+
+//==============================================================================
+struct LooperProcessor::Editor  : public AudioProcessorEditor,
+                                  private Timer
+{
+    Editor (LooperProcessor& p)  : AudioProcessorEditor (p), owner (p)
+    {
+        addButton ("Rec",   [this] { owner.sendCommand (record); });
+        addButton ("Play",  [this] { owner.sendCommand (play); });
+        addButton ("Stop",  [this] { owner.sendCommand (stop); });
+        addButton ("Undo",  [this] { owner.sendCommand (undo); });
+        addButton ("Clear", [this] { owner.sendCommand (clear); });
+        addButton ("Export...", [this] { chooseExportFile(); });
+
+        addAndMakeVisible (statusLabel);
+
+        setSize (420, 80);
+        timerCallback();
+        startTimerHz (15);
+    }
+
+    void paint (Graphics& g) override
+    {
+        g.fillAll (getLookAndFeel().findColour (ResizableWindow::backgroundColourId));
+
+        if (auto length = owner.getLoopLength())
+        {
+            auto bar = getLocalBounds().reduced (8).removeFromBottom (6).toFloat();
+            g.setColour (Colours::grey);
+            g.fillRect (bar);
+            g.setColour (owner.getState() == overdubbing ? Colours::red : Colours::lightgreen);
+            g.fillRect (bar.withWidth (bar.getWidth() * owner.getPlayPosition() / (float) length));
+        }
+    }
+
+    void resized() override
+    {
+        auto area = getLocalBounds().reduced (8);
+        auto row = area.removeFromTop (28);
+        auto buttonWidth = row.getWidth() / buttons.size();
+
+        for (auto* b : buttons)
+            b->setBounds (row.removeFromLeft (buttonWidth).reduced (2, 0));
+
+        statusLabel.setBounds (area.removeFromTop (24));
+    }
+
+    void timerCallback() override
+    {
+        static const char* const stateNames[] = { "Stopped", "Recording", "Playing", "Overdubbing" };
+
+        auto seconds = owner.getLoopLength() / owner.currentSampleRate.load();
+        statusLabel.setText (String (stateNames[owner.getState()]) + ", loop " + String (seconds, 2) + "s"
+                               + (owner.isExporting() ? ", exporting..." : ""),
+                             dontSendNotification);
+        repaint();
+    }
+
+    void addButton (const String& name, std::function<void()> onClick)
+    {
+        auto* b = buttons.add (new TextButton (name));
+        b->onClick = onClick;
+        addAndMakeVisible (b);
+    }
+
+    void chooseExportFile()
+    {
+        chooser = new FileChooser ("Export the loop", File::getSpecialLocation (File::userHomeDirectory), "*.wav");
+
+        chooser->launchAsync (FileBrowserComponent::saveMode | FileBrowserComponent::canSelectFiles
+                                | FileBrowserComponent::warnAboutOverwriting,
+                              [this] (const FileChooser& fc)
+                              {
+                                  if (fc.getResult() != File())
+                                      owner.exportLoopTo (fc.getResult().withFileExtension ("wav"));
+                              });
+    }
+
+    LooperProcessor& owner;
+    OwnedArray<TextButton> buttons;
+    Label statusLabel;
+    ScopedPointer<FileChooser> chooser;
+};
+
+//==============================================================================
+LooperProcessor::LooperProcessor()
+    : InternalPlugin (InternalPluginFormat::looperName, "Utility",
+                      BusesProperties().withInput  ("Input",  AudioChannelSet::stereo())
+                                       .withOutput ("Output", AudioChannelSet::stereo()))
+{
+}
+
+LooperProcessor::~LooperProcessor()
+{
+    exporter = nullptr;
+}
+
+//==============================================================================
+bool LooperProcessor::sendCommand (Command c)
+{
+    int start1, size1, start2, size2;
+    commandFifo.prepareToWrite (1, start1, size1, start2, size2);
+
+    if (size1 + size2 == 0)
+        return false;
+
+    commandQueue[size1 > 0 ? start1 : start2] = c;
+    commandFifo.finishedWrite (1);
+    return true;
+}
+
+void LooperProcessor::exportLoopTo (const File& f)
+{
+    if (exporter != nullptr)
+    {
+        exporter->setDestination (f);
+        sendCommand (exportLoop);
+    }
+}
+
+//==============================================================================
+void LooperProcessor::prepareToPlay (double sampleRate, int)
+{
+    // the exporter may still be reading a layer, and the layers are about to be reallocated
+    exporter = nullptr;
+    exportingLayer = -1;
+
+    currentSampleRate = sampleRate;
+    auto maxLength = (int) (sampleRate * maxLoopSeconds);
+
+    for (auto& layer : layers)
+        layer.setSize (2, maxLength, false, false, true);
+
+    clearLoop();
+    commandFifo.reset();
+
+    exporter = new Exporter (*this);
+}
+
+void LooperProcessor::releaseResources()
+{
+    exporter = nullptr;
+    exportingLayer = -1;
+    clearLoop();
+
+    for (auto& layer : layers)
+        layer.setSize (2, 0);
+}
+
+//==============================================================================
+int LooperProcessor::findFreeLayer() const noexcept
+{
+    auto exporting = exportingLayer.load (std::memory_order_acquire);
+    auto swappingLayer = swapRemaining > 0 ? swapping.layer : -1;
+
+    for (int i = 0; i < numLayers; ++i)
+        if (i != loopLayer && i != take.layer && i != swappingLayer && i != snapshotLayer && i != exporting)
+            return i;
+
+    jassertfalse; // there are always enough layers for this not to happen
+    return -1;
+}
+
+void LooperProcessor::clearLoop()
+{
+    state = stopped;
+    loopLayer = -1;
+    loopLength = position = 0;
+    take = swapping = Take();
+    takeOpen = false;
+    swapRemaining = 0;
+    snapshotLayer = -1;
+    snapshotRemaining = 0;
+}
+
+void LooperProcessor::closeLoop()
+{
+    loopLength = jmax (1, position);
+    position = 0;
+    state = playing;
+}
+
+void LooperProcessor::swapBack (int start, int num)
+{
+    Range<int> chunk (start, start + num);
+
+    // the stretch may wrap round the end of the loop, and the wrapped part comes first in the chunk
+    for (auto offset : { loopLength, 0 })
+    {
+        auto part = chunk.getIntersectionWith ({ swapping.start - offset, swapping.start + swapping.length - offset });
+        auto length = jmin (part.getLength(), swapRemaining);
+
+        if (length > 0)
+        {
+            for (int ch = 0; ch < 2; ++ch)
+            {
+                auto* loop = layers[loopLayer].getWritePointer (ch, part.getStart());
+                std::swap_ranges (loop, loop + length, layers[swapping.layer].getWritePointer (ch, part.getStart()));
+            }
+
+            swapRemaining -= length;
+        }
+    }
+}
+
+void LooperProcessor::copySnapshot (int num)
+{
+    // the copy goes round the loop a block at a time from wherever the play position was
+    while (num > 0 && snapshotRemaining > 0)
+    {
+        auto length = jmin (num, snapshotRemaining, loopLength - snapshotPosition);
+
+        for (int ch = 0; ch < 2; ++ch)
+            layers[snapshotLayer].copyFrom (ch, snapshotPosition, layers[loopLayer], ch, snapshotPosition, length);
+
+        snapshotPosition = (snapshotPosition + length) % loopLength;
+        snapshotRemaining -= length;
+        num -= length;
+    }
+
+    if (snapshotRemaining == 0)
+    {
+        // hands the copy over; the exporter polls for it, so there's nothing to signal from here
+        exportLength.store (loopLength);
+        exportingLayer.store (snapshotLayer, std::memory_order_release);
+        snapshotLayer = -1;
+    }
+}
+
+void LooperProcessor::handleCommand (Command c)
+{
+    switch (c)
+    {
+        case record:
+            if (state == recording)
+            {
+                closeLoop();
+                state = overdubbing;
+            }
+            else if (state == playing)
+            {
+                state = overdubbing;
+            }
+            else if (state == overdubbing)
+            {
+                state = playing;
+                takeOpen = false;
+            }
+            else
+            {
+                clearLoop();
+                loopLayer = findFreeLayer();
+                state = recording;
+            }
+            break;
+
+        case play:
+            if (state == recording)     closeLoop();
+            else if (state == overdubbing) { state = playing; takeOpen = false; }
+            else if (state == stopped && loopLength > 0) state = playing;
+            break;
+
+        case stop:
+            if (state == recording)
+                closeLoop();
+
+            if (loopLength > 0)
+            {
+                // the play position is about to jump, so an undo can't wait for it to come round
+                swapBack (position, loopLength - position);
+                swapBack (0, position);
+
+                state = stopped;
+                takeOpen = false;
+                position = 0;
+            }
+            break;
+
+        case undo:
+            if (state == recording || take.length == 0 || swapRemaining > 0)
+                break;
+
+            if (state == overdubbing)
+                state = playing;
+
+            // each sample is swapped just before it's next played, so the change is heard straight away
+            takeOpen = false;
+            swapping = take;
+            swapRemaining = take.length;
+            break;
+
+        case clear:
+            clearLoop();
+            break;
+
+        case exportLoop:
+            if (loopLength > 0 && state != recording && snapshotLayer < 0
+                 && exportingLayer.load() < 0 && exporter != nullptr)
+            {
+                snapshotLayer = findFreeLayer();
+                snapshotPosition = position;
+                snapshotRemaining = loopLength;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+//==============================================================================
+void LooperProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer&)
+{
+    ScopedNoDenormals noDenormals;
+
+    int start1, size1, start2, size2;
+    commandFifo.prepareToRead (commandFifo.getNumReady(), start1, size1, start2, size2);
+
+    for (int i = 0; i < size1; ++i)  handleCommand (commandQueue[start1 + i]);
+    for (int i = 0; i < size2; ++i)  handleCommand (commandQueue[start2 + i]);
+
+    commandFifo.finishedRead (size1 + size2);
+
+    auto maxLength = layers[0].getNumSamples();
+
+    if (maxLength == 0 || buffer.getNumChannels() < 2)
+        return;
+
+    for (int done = 0; done < buffer.getNumSamples() && state != stopped;)
+    {
+        auto num = buffer.getNumSamples() - done;
+
+        if (state == recording)
+        {
+            num = jmin (num, maxLength - position);
+
+            for (int ch = 0; ch < 2; ++ch)
+                layers[loopLayer].copyFrom (ch, position, buffer, ch, done, num);
+
+            position += num;
+
+            if (position == maxLength)
+                closeLoop();
+        }
+        else
+        {
+            num = jmin (num, loopLength - position);
+
+            if (state == overdubbing && takeOpen && take.length < loopLength)
+                num = jmin (num, loopLength - take.length);
+
+            swapBack (position, num);
+
+            if (state == overdubbing)
+            {
+                if (! takeOpen || take.length == loopLength)
+                {
+                    // a new take replaces the last one, which can't be undone after this
+                    take = Take();
+                    take.layer = findFreeLayer();
+                    take.start = position;
+                    takeOpen = true;
+                }
+
+                for (int ch = 0; ch < 2; ++ch)
+                {
+                    auto* saved = layers[take.layer].getWritePointer (ch, position);
+                    auto* loop = layers[loopLayer].getWritePointer (ch, position);
+
+                    FloatVectorOperations::copy (saved, loop, num);
+                    FloatVectorOperations::add (loop, buffer.getReadPointer (ch, done), num);
+                }
+
+                take.length += num;
+            }
+
+            // while overdubbing, the input is already in the buffer, so it plays what was there before
+            auto source = state == overdubbing ? take.layer : loopLayer;
+
+            for (int ch = 0; ch < 2; ++ch)
+                buffer.addFrom (ch, done, layers[source], ch, position, num);
+
+            position += num;
+
+            if (position == loopLength)
+                position = 0;
+        }
+
+        done += num;
+    }
+
+    if (snapshotLayer >= 0)
+        copySnapshot (buffer.getNumSamples());
+
+    displayState = state;
+    displayLength = state == recording ? position : loopLength;
+    displayPosition = position;
+    displayExporting = snapshotLayer >= 0;
+}
+
+AudioProcessorEditor* LooperProcessor::createEditor()
+{
+    return new Editor (*this);
+}
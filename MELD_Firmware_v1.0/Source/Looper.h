@@ -0,0 +1,136 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "InternalFilters.h"
+
+
+//==============================================================================
+/**
+    A looper that records a phrase and plays it back under the live input.
+
+    All its loop memory is allocated in prepareToPlay, as a few equal-sized layers.
+    Overdubs are mixed into the playing layer in place, a block at a time at the play
+    position, and the samples each block replaces are kept in a spare layer. Undo and
+    redo swap that stretch back as the play position comes round to it, so nothing
+    ever touches more of a layer in one block than the block itself.
+
+    Commands arrive from the message thread through a lock-free queue. An export
+    copies the loop into a spare layer the same way, and a background thread picks
+    that copy up and writes it to disk.
+*/
+class LooperProcessor  : public InternalPlugin
+{
+public:
+    LooperProcessor();
+    ~LooperProcessor();
+
+    //==============================================================================
+    enum Command
+    {
+        record,         /**< Starts a new loop, closes a loop being recorded, or toggles overdubbing. */
+        play,           /**< Closes a loop being recorded, stops overdubbing, or starts playback. */
+        stop,           /**< Stops playback and rewinds, finishing an undo that was still going round. */
+        undo,           /**< Takes the last overdub out, or puts it back. Ignored while an undo is still going round. */
+        clear,
+        exportLoop
+    };
+
+    enum State
+    {
+        stopped,
+        recording,
+        playing,
+        overdubbing
+    };
+
+    /** Queues a command for the audio thread. Only call this from the message thread. */
+    bool sendCommand (Command);
+
+    /** Writes the current loop to a WAV file in the background. */
+    void exportLoopTo (const File&);
+
+    State getState() const noexcept                         { return (State) displayState.load(); }
+    int getLoopLength() const noexcept                      { return displayLength.load(); }
+    int getPlayPosition() const noexcept                    { return displayPosition.load(); }
+    bool isExporting() const noexcept                       { return displayExporting.load() || exportingLayer.load() >= 0; }
+
+    //==============================================================================
+    void prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock) override;
+    void releaseResources() override;
+    void processBlock (AudioBuffer<float>&, MidiBuffer&) override;
+
+    bool hasEditor() const override                         { return true; }
+    AudioProcessorEditor* createEditor() override;
+
+    enum
+    {
+        maxLoopSeconds  = 30,
+        numLayers       = 4,
+        queueSize       = 32
+    };
+
+private:
+    //==============================================================================
+    struct Exporter;
+    struct Editor;
+
+    AbstractFifo commandFifo { queueSize };
+    Command commandQueue[queueSize];
+
+    // a stretch of the loop, and the layer holding what the loop had there before the overdub
+    struct Take
+    {
+        int layer = -1, start = 0, length = 0;
+    };
+
+    // only touched by the audio thread, or while it isn't running
+    AudioBuffer<float> layers[numLayers];
+    State state = stopped;
+    int loopLayer = -1, loopLength = 0, position = 0;
+    Take take, swapping;
+    bool takeOpen = false;
+    int swapRemaining = 0;
+    int snapshotLayer = -1, snapshotPosition = 0, snapshotRemaining = 0;
+
+    std::atomic<double> currentSampleRate { 44100.0 };
+    std::atomic<int> exportingLayer { -1 };
+    std::atomic<int> exportLength { 0 };
+    std::atomic<int> displayState { stopped }, displayLength { 0 }, displayPosition { 0 };
+    std::atomic<bool> displayExporting { false };
+
+    ScopedPointer<Exporter> exporter;
+
+    void handleCommand (Command);
+    void closeLoop();
+    void clearLoop();
+    void swapBack (int start, int num);
+    void copySnapshot (int num);
+    int findFreeLayer() const noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LooperProcessor)
+};
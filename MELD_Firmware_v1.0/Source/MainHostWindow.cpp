@@ -28,6 +28,7 @@
 #include "MainHostWindow.h"
 #include "InternalFilters.h"
 #include "GraphEditorPanel.h"
+#include "VirtualAudioDevice.h"
 
 
 //==============================================================================
@@ -43,10 +44,7 @@ public:
         auto deadMansPedalFile = getAppProperties().getUserSettings()
                                    ->getFile().getSiblingFile ("RecentlyCrashedPluginsList");
 
-        setContentOwned (new PluginListComponent (pluginFormatManager,
-                                                  owner.knownPluginList,
-                                                  deadMansPedalFile,
-                                                  getAppProperties().getUserSettings(), true), true);
+        setContentOwned (new Content (owner, pluginFormatManager, deadMansPedalFile), true);
 
         
         
@@ -80,6 +78,46 @@ public:
 private:
     MainHostWindow& owner;
     
+    /** The plugin list, with a button underneath to benchmark the selected rows. */
+    struct Content  : public Component,
+                      private Button::Listener
+    {
+        Content (MainHostWindow& mw, AudioPluginFormatManager& fm, const File& deadMansPedalFile)
+            : owner (mw),
+              list (fm, mw.knownPluginList, deadMansPedalFile, getAppProperties().getUserSettings(), true)
+        {
+            addAndMakeVisible (list);
+            addAndMakeVisible (benchmarkButton);
+            benchmarkButton.setTooltip ("Times the selected plugins, or all of them if none are selected, "
+                                        "and recommends the smallest buffer size each can run at");
+            benchmarkButton.addListener (this);
+        }
+
+        void resized() override
+        {
+            auto r = getLocalBounds();
+            benchmarkButton.setBounds (r.removeFromBottom (30).reduced (4).removeFromRight (160));
+            list.setBounds (r);
+        }
+
+        void buttonClicked (Button*) override
+        {
+            // the table's rows are the list's own order, with any blacklisted entries after them
+            auto& knownPlugins = owner.knownPluginList;
+            auto selected = list.getTableListBox().getSelectedRows();
+            Array<PluginDescription> types;
+
+            for (int i = 0; i < knownPlugins.getNumTypes(); ++i)
+                if (selected.isEmpty() || selected.contains (i))
+                    types.add (*knownPlugins.getType (i));
+
+            owner.benchmarkPlugins (types);
+        }
+
+        MainHostWindow& owner;
+        PluginListComponent list;
+        TextButton benchmarkButton { "Benchmark..." };
+    };
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PluginListWindow)
 };
@@ -96,8 +134,17 @@ MainHostWindow::MainHostWindow()
     ScopedPointer<XmlElement> savedAudioState (getAppProperties().getUserSettings()
                                                    ->getXmlValue ("audioDeviceState"));
 
+    // the platform's own types have to be created before adding ours, or they never will be
+    deviceManager.getAvailableDeviceTypes();
+    deviceManager.addAudioDeviceType (new VirtualAudioIODeviceType (getAppProperties().getUserSettings()
+                                                                        ->getDoubleValue ("virtualDeviceJitterMs", 2.0)));
+
     deviceManager.initialise (256, 256, savedAudioState, true);
 
+    // with no sound card, keep the host running on a virtual device instead
+    if (deviceManager.getCurrentAudioDevice() == nullptr)
+        deviceManager.setCurrentAudioDeviceType (VirtualAudioIODeviceType::typeName, true);
+
     setResizable (true, false);
     
     graphHolder = new GraphDocumentComponent (formatManager, deviceManager);
@@ -212,6 +259,7 @@ void MainHostWindow::changeListenerCallback (ChangeBroadcaster* changed)
 {
     if (changed == &knownPluginList)
     {
+        pluginCatalogue.invalidate();
         menuItemsChanged();
 
         // save the plugin list every time it gets chnaged, so that if we're scanning
@@ -236,6 +284,10 @@ void MainHostWindow::changeListenerCallback (ChangeBroadcaster* changed)
     }
 }
 
+// the rates the graph can be pinned to, whatever the interface runs at
+static const double internalRates[] = { 44100.0, 48000.0, 88200.0, 96000.0 };
+static const int oversamplingFactors[] = { 1, 2, 4, 8 };
+
 StringArray MainHostWindow::getMenuBarNames()
 {
     StringArray names;
@@ -274,6 +326,31 @@ PopupMenu MainHostWindow::getMenuForIndex (int topLevelMenuIndex, const String&
         PopupMenu pluginsMenu;
         addPluginsToMenu (pluginsMenu);
         menu.addSubMenu ("Create plugin", pluginsMenu); //PLUGINS MENU
+
+        PopupMenu oversamplingMenu;
+
+        if (graphHolder != nullptr)
+        {
+            if (auto* graph = graphHolder->graph.get())
+            {
+                for (int slot = 0; slot < FilterGraph::numSlots; ++slot)
+                {
+                    if (auto* node = graph->getNodeForSlot (slot))
+                    {
+                        auto current = graph->getOversamplingFactor (node->nodeID);
+                        PopupMenu factorMenu;
+
+                        for (int i = 0; i < numElementsInArray (oversamplingFactors); ++i)
+                            factorMenu.addItem (300 + slot * numElementsInArray (oversamplingFactors) + i,
+                                                String (oversamplingFactors[i]) + "x", true, current == oversamplingFactors[i]);
+
+                        oversamplingMenu.addSubMenu (String (slot + 1) + ": " + node->getProcessor()->getName(), factorMenu);
+                    }
+                }
+            }
+        }
+
+        menu.addSubMenu ("Oversampling", oversamplingMenu, oversamplingMenu.getNumItems() > 0);
         menu.addSeparator();
         menu.addItem (250, "Delete all plugins");
     }
@@ -285,7 +362,31 @@ PopupMenu MainHostWindow::getMenuForIndex (int topLevelMenuIndex, const String&
         
         menu.addSeparator();
         menu.addCommandItem (&getCommandManager(), CommandIDs::showAudioSettings);
+
+        auto internalRate = getAppProperties().getUserSettings()->getDoubleValue ("internalSampleRate", 0.0);
+        PopupMenu rateMenu;
+        rateMenu.addItem (270, "Follow the audio device", true, internalRate <= 0);
+
+        for (int i = 0; i < numElementsInArray (internalRates); ++i)
+            rateMenu.addItem (271 + i, String (internalRates[i] / 1000.0, 1) + " kHz", true, internalRate == internalRates[i]);
+
+        menu.addSubMenu ("Internal sample rate", rateMenu);
+        menu.addCommandItem (&getCommandManager(), CommandIDs::showLatencyReport);
+        menu.addCommandItem (&getCommandManager(), CommandIDs::measureLatency);
         
+        menu.addSeparator();
+        menu.addCommandItem (&getCommandManager(), CommandIDs::toggleRecording);
+
+        auto useFlac = getAppProperties().getUserSettings()->getBoolValue ("recordAsFlac", false);
+        PopupMenu formatMenu;
+        formatMenu.addItem (260, "WAV", true, ! useFlac);
+        formatMenu.addItem (261, "FLAC", true, useFlac);
+        menu.addSubMenu ("Recording format", formatMenu);
+
+        menu.addSeparator();
+        menu.addCommandItem (&getCommandManager(), CommandIDs::toggleCapture);
+        menu.addCommandItem (&getCommandManager(), CommandIDs::replayCapture);
+
         menu.addSeparator();
         menu.addCommandItem (&getCommandManager(), CommandIDs::aboutBox);
     }
@@ -301,6 +402,28 @@ void MainHostWindow::menuItemSelected (int menuItemID, int /*topLevelMenuIndex*/
             if (auto* graph = graphHolder->graph.get())
                 graph->clear();
     }
+    else if (menuItemID >= 270 && menuItemID <= 270 + numElementsInArray (internalRates))
+    {
+        auto rate = menuItemID == 270 ? 0.0 : internalRates[menuItemID - 271];
+        getAppProperties().getUserSettings()->setValue ("internalSampleRate", rate);
+
+        if (graphHolder != nullptr)
+            graphHolder->setInternalSampleRate (rate);
+    }
+    else if (menuItemID >= 300 && menuItemID < 300 + FilterGraph::numSlots * numElementsInArray (oversamplingFactors))
+    {
+        auto slot = (menuItemID - 300) / numElementsInArray (oversamplingFactors);
+        auto factor = oversamplingFactors[(menuItemID - 300) % numElementsInArray (oversamplingFactors)];
+
+        if (graphHolder != nullptr)
+            if (auto* graph = graphHolder->graph.get())
+                if (auto* node = graph->getNodeForSlot (slot))
+                    graph->setOversamplingFactor (node->nodeID, factor);
+    }
+    else if (menuItemID == 260 || menuItemID == 261)
+    {
+        getAppProperties().getUserSettings()->setValue ("recordAsFlac", menuItemID == 261);
+    }
     else if (menuItemID >= 100 && menuItemID < 200)
     {
         RecentlyOpenedFilesList recentFiles;
@@ -347,19 +470,13 @@ void MainHostWindow::createPlugin (const PluginDescription& desc, Point<int> pos
 
 void MainHostWindow::addPluginsToMenu (PopupMenu& m) const
 {
-    if (graphHolder != nullptr)
-    {
-//        int i = 0;
-//
-//        for (auto* t : internalTypes)
-//            m.addItem (++i, t->name + " (" + t->pluginFormatName + ")",
-//                       graphHolder->graph->getNodeForName (t->name) == nullptr);
-    }
-
     m.addSeparator();
 
-    knownPluginList.addToMenu (m, pluginSortMethod);
+    // the catalogue keeps a ready-built menu for each sort order, so this only copies its items
+    for (PopupMenu::MenuItemIterator i (pluginCatalogue.getMenu (pluginSortMethod)); i.next();)
+        m.addItem (i.getItem());
 
+    pluginMenuVersion = pluginCatalogue.getVersion();
 }
 
 
@@ -368,6 +485,10 @@ const PluginDescription* MainHostWindow::getChosenType (const int menuID) const
     if (menuID >= 1 && menuID < 1 + internalTypes.size())
         return internalTypes [menuID - 1];
 
+    // the list has changed since the menu was built, so its item IDs may point at other plugins
+    if (pluginMenuVersion != pluginCatalogue.getVersion())
+        return nullptr;
+
     return knownPluginList.getType (knownPluginList.getIndexChosenByMenu (menuID));
 }
 
@@ -387,6 +508,11 @@ void MainHostWindow::getAllCommands (Array<CommandID>& commands)
                               CommandIDs::showPluginListEditor,
                               CommandIDs::showAudioSettings,
                               CommandIDs::toggleDoublePrecision,
+                              CommandIDs::toggleRecording,
+                              CommandIDs::toggleCapture,
+                              CommandIDs::replayCapture,
+                              CommandIDs::showLatencyReport,
+                              CommandIDs::measureLatency,
                               CommandIDs::aboutBox,
                               CommandIDs::allWindowsForward
                             };
@@ -436,6 +562,32 @@ void MainHostWindow::getCommandInfo (const CommandID commandID, ApplicationComma
         updatePrecisionMenuItem (result);
         break;
 
+    case CommandIDs::toggleRecording:
+        result.setInfo ("Record the master output", "Starts or stops recording the output to disk", category, 0);
+        result.setTicked (graphHolder != nullptr && graphHolder->graph != nullptr
+                           && graphHolder->graph->getRecorder().isRecording());
+        result.addDefaultKeypress ('r', ModifierKeys::commandModifier);
+        break;
+
+    case CommandIDs::toggleCapture:
+        result.setInfo ("Capture input", "Starts or stops capturing every input event to a file", category, 0);
+        result.setTicked (graphHolder != nullptr && graphHolder->isCapturing());
+        break;
+
+    case CommandIDs::replayCapture:
+        result.setInfo (graphHolder != nullptr && graphHolder->isReplaying() ? "Stop replaying" : "Replay a capture...",
+                        "Restores the graph from a capture and plays its input back in real time", category, 0);
+        break;
+
+    case CommandIDs::showLatencyReport:
+        result.setInfo ("Latency report...", "Shows how much latency each path through the graph adds", category, 0);
+        break;
+
+    case CommandIDs::measureLatency:
+        result.setInfo ("Measure latency...", "Times a click from an output back to an input", category, 0);
+        result.setActive (latencyMeasurer == nullptr || ! latencyMeasurer->isMeasuring());
+        break;
+
     case CommandIDs::aboutBox:
         result.setInfo ("About...", String(), category, 0);
         break;
@@ -502,6 +654,26 @@ bool MainHostWindow::perform (const InvocationInfo& info)
         }
         break;
 
+    case CommandIDs::toggleRecording:
+        toggleRecording();
+        break;
+
+    case CommandIDs::toggleCapture:
+        toggleCapture();
+        break;
+
+    case CommandIDs::replayCapture:
+        replayCapture();
+        break;
+
+    case CommandIDs::showLatencyReport:
+        showLatencyReport();
+        break;
+
+    case CommandIDs::measureLatency:
+        measureLatency();
+        break;
+
     case CommandIDs::aboutBox:
         // TODO
         break;
@@ -523,6 +695,244 @@ bool MainHostWindow::perform (const InvocationInfo& info)
     return true;
 }
 
+void MainHostWindow::toggleRecording()
+{
+    if (graphHolder == nullptr || graphHolder->graph == nullptr)
+        return;
+
+    auto& recorder = graphHolder->graph->getRecorder();
+
+    if (recorder.isRecording())
+    {
+        recorder.stop();
+    }
+    else
+    {
+        auto* settings = getAppProperties().getUserSettings();
+        File folder (settings->getValue ("recordingFolder",
+                                         File::getSpecialLocation (File::userMusicDirectory)
+                                            .getChildFile ("MELD Recordings").getFullPathName()));
+
+        auto result = recorder.start (folder, settings->getBoolValue ("recordAsFlac", false) ? MasterRecorder::flac
+                                                                                              : MasterRecorder::wav);
+
+        if (result.failed())
+            AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "Couldn't start recording", result.getErrorMessage());
+    }
+
+    getCommandManager().commandStatusChanged();
+}
+
+void MainHostWindow::toggleCapture()
+{
+    if (graphHolder == nullptr)
+        return;
+
+    if (graphHolder->isCapturing())
+    {
+        graphHolder->stopCapture();
+    }
+    else
+    {
+        File folder (getAppProperties().getUserSettings()
+                        ->getValue ("captureFolder", File::getSpecialLocation (File::userDocumentsDirectory)
+                                                        .getChildFile ("MELD Captures").getFullPathName()));
+
+        auto file = folder.getNonexistentChildFile ("Capture " + Time::getCurrentTime().formatted ("%Y-%m-%d %H-%M-%S"),
+                                                    CaptureFile::getFilenameSuffix(), false);
+
+        auto result = graphHolder->startCapture (file);
+
+        if (result.failed())
+            AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "Couldn't start capturing", result.getErrorMessage());
+    }
+
+    getCommandManager().commandStatusChanged();
+}
+
+void MainHostWindow::replayCapture()
+{
+    if (graphHolder == nullptr)
+        return;
+
+    if (graphHolder->isReplaying())
+    {
+        graphHolder->stopReplay();
+    }
+    else
+    {
+        captureChooser = new FileChooser ("Replay a capture", File::getSpecialLocation (File::userDocumentsDirectory)
+                                                                .getChildFile ("MELD Captures"),
+                                          CaptureFile::getFilenameWildcard());
+
+        captureChooser->launchAsync (FileBrowserComponent::openMode | FileBrowserComponent::canSelectFiles,
+                                     [this] (const FileChooser& fc)
+                                     {
+                                         if (fc.getResult() == File() || graphHolder == nullptr)
+                                             return;
+
+                                         auto result = graphHolder->startReplay (fc.getResult());
+
+                                         if (result.failed())
+                                             AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "Couldn't replay the capture",
+                                                                               result.getErrorMessage());
+
+                                         getCommandManager().commandStatusChanged();
+                                     });
+    }
+
+    getCommandManager().commandStatusChanged();
+}
+
+static void showTextReport (Component& centreAround, const String& title, const String& report)
+{
+    auto* text = new TextEditor();
+    text->setMultiLine (true);
+    text->setReadOnly (true);
+    text->setScrollbarsShown (true);
+    text->setFont (Font (Font::getDefaultMonospacedFontName(), 13.0f, Font::plain));
+    text->setText (report);
+    text->setSize (640, 400);
+
+    DialogWindow::LaunchOptions o;
+    o.content.setOwned (text);
+    o.dialogTitle                   = title;
+    o.componentToCentreAround       = &centreAround;
+    o.dialogBackgroundColour        = centreAround.getLookAndFeel().findColour (ResizableWindow::backgroundColourId);
+    o.escapeKeyTriggersCloseButton  = true;
+    o.useNativeTitleBar             = true;
+    o.resizable                     = true;
+
+    o.launchAsync();
+}
+
+void MainHostWindow::showLatencyReport()
+{
+    if (graphHolder != nullptr && graphHolder->graph != nullptr)
+        showTextReport (*this, "Latency Report", graphHolder->createLatencyReport().toString());
+}
+
+void MainHostWindow::measureLatency()
+{
+    auto* device = deviceManager.getCurrentAudioDevice();
+
+    if (device == nullptr || graphHolder == nullptr)
+    {
+        AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "Couldn't measure latency", "No audio device is open.");
+        return;
+    }
+
+    // the callback is only given the active channels, so those are all that can be offered
+    Array<int> outputs, inputs;
+    StringArray outputNames, inputNames;
+
+    auto allOutputs = device->getOutputChannelNames();
+    auto allInputs = device->getInputChannelNames();
+
+    for (int i = 0; i < allOutputs.size(); ++i)
+    {
+        if (device->getActiveOutputChannels()[i])
+        {
+            outputs.add (i);
+            outputNames.add (allOutputs[i]);
+        }
+    }
+
+    for (int i = 0; i < allInputs.size(); ++i)
+    {
+        if (device->getActiveInputChannels()[i])
+        {
+            inputs.add (i);
+            inputNames.add (allInputs[i]);
+        }
+    }
+
+    if (outputs.isEmpty() || inputs.isEmpty())
+    {
+        AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "Couldn't measure latency",
+                                          "Enable at least one input and one output in the audio settings first.");
+        return;
+    }
+
+    auto* w = new AlertWindow ("Measure Latency",
+                               "Clicks are sent out of the output and timed coming back in on the input. Join them with a cable, "
+                               "or on the Virtual Loopback device use its last output and input, which are joined.",
+                               AlertWindow::NoIcon);
+
+    w->addComboBox ("output", outputNames, "Output");
+    w->addComboBox ("input", inputNames, "Input");
+    w->getComboBoxComponent ("output")->setSelectedItemIndex (outputNames.size() - 1);
+    w->getComboBoxComponent ("input")->setSelectedItemIndex (inputNames.size() - 1);
+    w->addButton ("Measure", 1, KeyPress (KeyPress::returnKey));
+    w->addButton ("Cancel", 0, KeyPress (KeyPress::escapeKey));
+
+    w->enterModalState (true, ModalCallbackFunction::create ([this, w, outputs, inputs] (int choice)
+    {
+        if (choice == 0 || graphHolder == nullptr)
+            return;
+
+        if (latencyMeasurer == nullptr)
+            latencyMeasurer = new LatencyMeasurer (deviceManager);
+
+        latencyMeasurer->onFinished = [this] (const Result& result, int roundTrip)
+        {
+            getCommandManager().commandStatusChanged();
+
+            if (result.failed() || graphHolder == nullptr)
+            {
+                AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "Couldn't measure latency", result.getErrorMessage());
+                return;
+            }
+
+            auto report = graphHolder->createLatencyReport();
+            auto toMs = [&report] (int samples) { return String (samples * 1000.0 / jmax (1.0, report.sampleRate), 2) + " ms"; };
+
+            String message;
+            message << "Measured round trip: " << roundTrip << " samples (" << toMs (roundTrip) << ")" << newLine
+                    << "Reported round trip: " << report.getDeviceRoundTrip() << " samples (" << toMs (report.getDeviceRoundTrip()) << ")";
+
+            if (! report.paths.isEmpty())
+            {
+                int graphLatency = 0;
+
+                for (auto& path : report.paths)
+                    graphLatency = jmax (graphLatency, path.getGraphLatency());
+
+                auto worst = roundTrip + graphLatency;
+                message << newLine << newLine << "With the graph's slowest path on top, that's " << worst
+                        << " samples (" << toMs (worst) << ") from the input to the output.";
+            }
+
+            AlertWindow::showMessageBoxAsync (AlertWindow::InfoIcon, "Latency", message);
+        };
+
+        latencyMeasurer->start (outputs[w->getComboBoxComponent ("output")->getSelectedItemIndex()],
+                                inputs[w->getComboBoxComponent ("input")->getSelectedItemIndex()]);
+
+        getCommandManager().commandStatusChanged();
+    }), true);
+}
+
+void MainHostWindow::benchmarkPlugins (const Array<PluginDescription>& types)
+{
+    if (types.isEmpty() || (pluginBenchmark != nullptr && pluginBenchmark->isThreadRunning()))
+        return;
+
+    pluginBenchmark = new PluginBenchmark (formatManager, types, PluginBenchmark::Settings(), this);
+
+    pluginBenchmark->onFinished = [this] (bool wasCancelled)
+    {
+        // a cancelled run may have stopped partway through a plugin, so nothing from it is kept
+        if (! wasCancelled)
+            PluginBenchmark::storeRecommendations (*getAppProperties().getUserSettings(), pluginBenchmark->getResults());
+
+        showTextReport (*this, "Plugin Benchmark", pluginBenchmark->createReport());
+    };
+
+    // as close to the audio thread's priority as a normal thread gets, to keep the timings steady
+    pluginBenchmark->launchThread (9);
+}
+
 void MainHostWindow::showAudioSettings()
 {
     AudioDeviceSelectorComponent audioSettingsComp (deviceManager,
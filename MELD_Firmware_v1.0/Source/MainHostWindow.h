@@ -28,6 +28,8 @@
 
 #include "FilterGraph.h"
 #include "GraphEditorPanel.h"
+#include "PluginBenchmark.h"
+#include "PluginCatalogue.h"
 
 
 //==============================================================================
@@ -42,6 +44,11 @@ namespace CommandIDs
     static const int aboutBox               = 0x30300;
     static const int allWindowsForward      = 0x30400;
     static const int toggleDoublePrecision  = 0x30500;
+    static const int toggleRecording        = 0x30600;
+    static const int toggleCapture          = 0x30700;
+    static const int replayCapture          = 0x30800;
+    static const int showLatencyReport      = 0x30900;
+    static const int measureLatency         = 0x30a00;
 }
 
 ApplicationCommandManager& getCommandManager();
@@ -103,11 +110,22 @@ public:
     OwnedArray<PluginDescription> internalTypes; //private
     KnownPluginList knownPluginList; //private
     KnownPluginList::SortMethod pluginSortMethod; // private
+    PluginCatalogue pluginCatalogue { knownPluginList };
+    mutable int pluginMenuVersion = -1; // the catalogue version the last plugin menu was built from
     
     class PluginListWindow; //private
     ScopedPointer<PluginListWindow> pluginListWindow; //private
     
     void showAudioSettings(); //private
+    void toggleRecording();
+    void toggleCapture();
+    void replayCapture();
+    void showLatencyReport();
+    void measureLatency();
+    void benchmarkPlugins (const Array<PluginDescription>&);
+    ScopedPointer<FileChooser> captureChooser;
+    ScopedPointer<LatencyMeasurer> latencyMeasurer;
+    ScopedPointer<PluginBenchmark> pluginBenchmark;
     TextButton popup;
 
 
@@ -0,0 +1,328 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "MasterRecorder.h"
+
+#if JUCE_LINUX
+ #include <fcntl.h>
+ #include <unistd.h>
+#endif
+
+//==============================================================================
+struct MasterRecorder::FileStream  : public OutputStream
+{
+    FileStream (MasterRecorder& r)  : owner (r) {}
+
+    void flush() override                       { owner.fileStream->flush(); }
+    bool setPosition (int64 pos) override       { return owner.fileStream->setPosition (pos); }
+    int64 getPosition() override                { return owner.fileStream->getPosition(); }
+
+    bool write (const void* data, size_t numBytes) override
+    {
+        auto ok = owner.fileStream->write (data, numBytes);
+        owner.fileEnd = jmax (owner.fileEnd, getPosition());
+        return ok;
+    }
+
+    MasterRecorder& owner;
+};
+
+//==============================================================================
+MasterRecorder::MasterRecorder()  : Thread ("Master recorder")
+{
+}
+
+MasterRecorder::~MasterRecorder()
+{
+    stop();
+}
+
+//==============================================================================
+void MasterRecorder::prepare (double newSampleRate)
+{
+    if (newSampleRate == sampleRate)
+        return;
+
+    stop();
+
+    sampleRate = newSampleRate;
+    auto size = jmax (1, (int) (sampleRate * fifoSeconds));
+    fifoBuffer.setSize (2, size);
+    fifo.setTotalSize (size);
+}
+
+Result MasterRecorder::start (const File& newFolder, Format newFormat)
+{
+    stop();
+
+    if (sampleRate <= 0)
+        return Result::fail ("The audio device isn't running");
+
+    auto folderResult = newFolder.createDirectory();
+
+    if (folderResult.failed())
+        return folderResult;
+
+    folder = newFolder;
+    format = newFormat;
+    baseName = "Master " + Time::getCurrentTime().formatted ("%Y-%m-%d %H-%M-%S");
+    partNumber = 0;
+
+    if (! openNextFile())
+        return Result::fail ("Couldn't write to " + getCurrentFile().getFullPathName());
+
+    fifo.reset();
+    peakFill = 0;
+    droppedSamples = 0;
+    samplesWritten = 0;
+
+    recording = true;
+    startThread (6);
+    return Result::ok();
+}
+
+void MasterRecorder::stop()
+{
+    recording = false;
+
+    // the writer drains whatever is left in the FIFO before it exits
+    signalThreadShouldExit();
+    notify();
+    stopThread (10000);
+
+    closeFile();
+}
+
+File MasterRecorder::getCurrentFile() const
+{
+    const ScopedLock sl (fileLock);
+    return currentFile;
+}
+
+double MasterRecorder::getSecondsRecorded() const noexcept
+{
+    return sampleRate > 0 ? samplesWritten.load() / sampleRate : 0.0;
+}
+
+float MasterRecorder::getFifoFillLevel() const noexcept
+{
+    return fifo.getNumReady() / (float) fifo.getTotalSize();
+}
+
+float MasterRecorder::getPeakFifoFillLevel() const noexcept
+{
+    return peakFill.load() / (float) fifo.getTotalSize();
+}
+
+//==============================================================================
+void MasterRecorder::push (const AudioBuffer<float>& buffer) noexcept
+{
+    if (! recording.load (std::memory_order_relaxed) || buffer.getNumChannels() == 0)
+        return;
+
+    auto num = buffer.getNumSamples();
+    auto lastChannel = buffer.getNumChannels() - 1;
+
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite (num, start1, size1, start2, size2);
+
+    for (int ch = 0; ch < 2; ++ch)
+    {
+        if (size1 > 0)  fifoBuffer.copyFrom (ch, start1, buffer, jmin (ch, lastChannel), 0, size1);
+        if (size2 > 0)  fifoBuffer.copyFrom (ch, start2, buffer, jmin (ch, lastChannel), size1, size2);
+    }
+
+    fifo.finishedWrite (size1 + size2);
+
+    if (size1 + size2 < num)
+        droppedSamples += num - (size1 + size2);
+
+    auto fill = fifo.getNumReady();
+
+    if (fill > peakFill.load (std::memory_order_relaxed))
+        peakFill.store (fill, std::memory_order_relaxed);
+}
+
+//==============================================================================
+bool MasterRecorder::openNextFile()
+{
+    closeFile();
+    samplesInFile = 0;
+    ++partNumber;
+
+    ScopedPointer<AudioFormat> audioFormat;
+
+    if (format == flac)
+        audioFormat = new FlacAudioFormat();
+    else
+        audioFormat = new WavAudioFormat();
+
+    auto file = folder.getChildFile (baseName + " part " + String (partNumber))
+                      .withFileExtension (audioFormat->getFileExtensions()[0]);
+
+    {
+        const ScopedLock sl (fileLock);
+        currentFile = file;
+    }
+
+    if (! file.deleteFile())
+        return false;
+
+    fileStream = new FileOutputStream (file, writeBufferBytes);
+
+    if (fileStream->failedToOpen())
+    {
+        fileStream = nullptr;
+        return false;
+    }
+
+    ScopedPointer<OutputStream> out (new FileStream (*this));
+    writer = audioFormat->createWriterFor (out.get(), sampleRate, 2, bitsPerSample, {}, 0);
+
+    if (writer == nullptr)
+    {
+        fileStream = nullptr;
+        return false;
+    }
+
+    out.release();
+
+   #if JUCE_LINUX
+    reserveHandle = ::open (file.getFullPathName().toRawUTF8(), O_WRONLY);
+   #endif
+
+    reserveAhead();
+    return true;
+}
+
+void MasterRecorder::closeFile()
+{
+    // deleting the writer finishes off the file's header
+    writer = nullptr;
+
+    if (fileStream != nullptr)
+    {
+        // cuts off the part of the reservation that never got written
+        fileStream->setPosition (fileEnd);
+        fileStream->truncate();
+        fileStream = nullptr;
+    }
+
+   #if JUCE_LINUX
+    if (reserveHandle >= 0)
+        ::close (reserveHandle);
+   #endif
+
+    reserveHandle = -1;
+    fileEnd = reservedBytes = 0;
+}
+
+void MasterRecorder::reserveAhead()
+{
+   #if JUCE_LINUX
+    // keeps at least half a chunk allocated ahead of the writer, so the filesystem isn't
+    // looking for blocks on every flush and the file stays in one piece on the disk
+    if (reserveHandle >= 0 && fileEnd + reserveChunkBytes / 2 > reservedBytes)
+    {
+        if (posix_fallocate (reserveHandle, reservedBytes, reserveChunkBytes) == 0)
+        {
+            reservedBytes += reserveChunkBytes;
+        }
+        else
+        {
+            // the filesystem can't do it, so this file is written without a reservation
+            ::close (reserveHandle);
+            reserveHandle = -1;
+        }
+    }
+   #endif
+}
+
+void MasterRecorder::writeAvailable()
+{
+    auto samplesPerFile = (int64) (sampleRate * 60.0 * fileMinutes);
+
+    for (auto ready = fifo.getNumReady(); ready > 0;)
+    {
+        if (samplesInFile >= samplesPerFile)
+            openNextFile();
+
+        auto num = (int) jmin ((int64) ready, samplesPerFile - samplesInFile);
+
+        int start1, size1, start2, size2;
+        fifo.prepareToRead (num, start1, size1, start2, size2);
+
+        if (writer != nullptr)
+        {
+            writer->writeFromAudioSampleBuffer (fifoBuffer, start1, size1);
+
+            if (size2 > 0)
+                writer->writeFromAudioSampleBuffer (fifoBuffer, start2, size2);
+        }
+        else
+        {
+            // the file couldn't be opened, so this part is lost; the next one will try again
+            droppedSamples += num;
+        }
+
+        fifo.finishedRead (num);
+        samplesInFile += num;
+        samplesWritten += num;
+        ready -= num;
+
+        reserveAhead();
+    }
+}
+
+void MasterRecorder::run()
+{
+    while (! threadShouldExit())
+    {
+        writeAvailable();
+        wait (50);
+    }
+
+    writeAvailable();
+    closeFile();
+}
+
+//==============================================================================
+RecorderTapProcessor::RecorderTapProcessor (MasterRecorder& r)
+    : AudioProcessor (BusesProperties().withInput ("Input", AudioChannelSet::stereo())),
+      recorder (r)
+{
+}
+
+void RecorderTapProcessor::prepareToPlay (double sampleRate, int)
+{
+    recorder.prepare (sampleRate);
+}
+
+void RecorderTapProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer&)
+{
+    recorder.push (buffer);
+}
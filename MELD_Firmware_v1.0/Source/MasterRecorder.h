@@ -0,0 +1,160 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <atomic>
+
+
+//==============================================================================
+/**
+    Records the master output to disk during a performance.
+
+    The audio thread only copies each block into a FIFO that's allocated before
+    recording starts. A writer thread drains the FIFO and encodes it as WAV or
+    FLAC, starting a new file every fileMinutes so no single file grows without
+    limit. On Linux each file's disk space is reserved in large chunks ahead of
+    what's been written, and trimmed back when the file is closed. If the disk
+    can't keep up, the FIFO fills up and the audio that doesn't
+    fit is dropped and counted. The audio thread never waits and never allocates.
+*/
+class MasterRecorder  : private Thread
+{
+public:
+    MasterRecorder();
+    ~MasterRecorder();
+
+    enum Format { wav, flac };
+
+    enum
+    {
+        fifoSeconds     = 4,
+        fileMinutes     = 15,
+        bitsPerSample   = 24
+    };
+
+    //==============================================================================
+    /** Sizes the FIFO. A recording in progress carries on unless the rate changes. */
+    void prepare (double sampleRate);
+
+    /** Opens the first file in this folder and starts recording into it. */
+    Result start (const File& folder, Format);
+    void stop();
+
+    bool isRecording() const noexcept                       { return recording.load(); }
+    File getCurrentFile() const;
+    double getSecondsRecorded() const noexcept;
+
+    /** Called on the audio thread. */
+    void push (const AudioBuffer<float>&) noexcept;
+
+    //==============================================================================
+    /** How full the FIFO is now, and the fullest it has been since recording started, from 0 to 1. */
+    float getFifoFillLevel() const noexcept;
+    float getPeakFifoFillLevel() const noexcept;
+
+    /** Samples thrown away because the FIFO was full. */
+    int64 getNumDroppedSamples() const noexcept             { return droppedSamples.load(); }
+
+private:
+    //==============================================================================
+    AbstractFifo fifo { 1 };
+    AudioBuffer<float> fifoBuffer;
+    double sampleRate = 0;
+
+    std::atomic<bool> recording { false };
+    std::atomic<int> peakFill { 0 };
+    std::atomic<int64> droppedSamples { 0 }, samplesWritten { 0 };
+
+    // only used by whichever thread is writing: the message thread to open the first file, then the writer
+    File folder;
+    Format format = wav;
+    String baseName;
+    int partNumber = 0;
+    int64 samplesInFile = 0;
+    ScopedPointer<AudioFormatWriter> writer;
+
+    // the writer deletes the stream it's given, so it gets a FileStream that writes through to
+    // this one, which stays open afterwards to be trimmed to the end of what was written
+    struct FileStream;
+    ScopedPointer<FileOutputStream> fileStream;
+    int64 fileEnd = 0, reservedBytes = 0;
+    int reserveHandle = -1;
+
+    mutable CriticalSection fileLock;
+    File currentFile;
+
+    // each file's stream gets a large buffer up front, so the disk sees big sequential writes
+    enum
+    {
+        writeBufferBytes    = 1 << 20,
+        reserveChunkBytes   = 64 << 20
+    };
+
+    bool openNextFile();
+    void closeFile();
+    void reserveAhead();
+    void writeAvailable();
+    void run() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MasterRecorder)
+};
+
+//==============================================================================
+/**
+    A sink node that passes its two inputs to a MasterRecorder. Like the meter tap
+    it isn't a plugin, so it never gets saved with the graph.
+*/
+class RecorderTapProcessor  : public AudioProcessor
+{
+public:
+    RecorderTapProcessor (MasterRecorder&);
+
+    //==============================================================================
+    const String getName() const override                   { return "Master Recorder"; }
+    void prepareToPlay (double, int) override;
+    void releaseResources() override                        {}
+    void processBlock (AudioBuffer<float>&, MidiBuffer&) override;
+
+    double getTailLengthSeconds() const override            { return 0; }
+    bool acceptsMidi() const override                       { return false; }
+    bool producesMidi() const override                      { return false; }
+    AudioProcessorEditor* createEditor() override           { return nullptr; }
+    bool hasEditor() const override                         { return false; }
+
+    int getNumPrograms() override                           { return 1; }
+    int getCurrentProgram() override                        { return 0; }
+    void setCurrentProgram (int) override                   {}
+    const String getProgramName (int) override              { return {}; }
+    void changeProgramName (int, const String&) override    {}
+    void getStateInformation (MemoryBlock&) override        {}
+    void setStateInformation (const void*, int) override    {}
+
+private:
+    MasterRecorder& recorder;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RecorderTapProcessor)
+};
@@ -0,0 +1,316 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "MetricsServer.h"
+
+#if JUCE_LINUX
+ #include <unistd.h>
+#endif
+
+
+//==============================================================================
+static String formatValue (double value)
+{
+    auto s = String (value, 6);
+
+    if (s.containsChar ('.'))
+        s = s.trimCharactersAtEnd ("0").trimCharactersAtEnd (".");
+
+    return s;
+}
+
+static void addHeader (String& out, const char* name, const char* type, const char* help)
+{
+    out << "# HELP " << name << ' ' << help << '\n'
+        << "# TYPE " << name << ' ' << type << '\n';
+}
+
+static void addSample (String& out, const String& name, double value)
+{
+    out << name << ' ' << formatValue (value) << '\n';
+}
+
+static void addHistogram (String& out, const char* name, const char* help, const TimingHistogram& histogram)
+{
+    addHeader (out, name, "histogram", help);
+
+    int64 cumulative = 0;
+
+    for (int i = 0; i < histogram.getNumBuckets(); ++i)
+    {
+        cumulative += histogram.getBucketCount (i);
+        addSample (out, String (name) + "_bucket{le=\"" + formatValue (histogram.getBucketBound (i)) + "\"}", (double) cumulative);
+    }
+
+    // the buckets are read first, so the total can only have moved on since
+    auto total = jmax (cumulative, histogram.getTotalCount());
+
+    addSample (out, String (name) + "_bucket{le=\"+Inf\"}", (double) total);
+    addSample (out, String (name) + "_sum", histogram.getSumSeconds());
+    addSample (out, String (name) + "_count", (double) total);
+}
+
+static bool getProcessMemory (int64& residentBytes, int64& virtualBytes)
+{
+   #if JUCE_LINUX
+    auto fields = StringArray::fromTokens (File ("/proc/self/statm").loadFileAsString(), false);
+
+    if (fields.size() >= 2)
+    {
+        auto pageSize = (int64) sysconf (_SC_PAGESIZE);
+
+        virtualBytes  = fields[0].getLargeIntValue() * pageSize;
+        residentBytes = fields[1].getLargeIntValue() * pageSize;
+        return true;
+    }
+   #endif
+
+    ignoreUnused (residentBytes, virtualBytes);
+    return false;
+}
+
+//==============================================================================
+MetricsServer::MetricsServer (FilterGraph& g, const CallbackMonitor& m, AudioDeviceManager& dm)
+    : Thread ("Metrics server"), graph (g), callbackMonitor (m), deviceManager (dm)
+{
+}
+
+MetricsServer::~MetricsServer()
+{
+    stop();
+}
+
+Result MetricsServer::start (int port)
+{
+    stop();
+
+    listener = new StreamingSocket();
+
+    if (! listener->createListener (port, "127.0.0.1"))
+    {
+        listener = nullptr;
+        return Result::fail ("Couldn't listen on 127.0.0.1:" + String (port));
+    }
+
+    lastHeartbeat = Time::getMillisecondCounter();
+    lastRateUpdate = Time::getMillisecondCounter();
+    lastMidiEvents = midiEvents.load();
+
+    deviceManager.addMidiInputCallback (String(), this);
+    startTimer (heartbeatIntervalMs);
+    startThread();
+
+    return Result::ok();
+}
+
+void MetricsServer::stop()
+{
+    stopTimer();
+    deviceManager.removeMidiInputCallback (String(), this);
+
+    // the thread never waits more than a moment at a time, so it'll notice soon enough
+    stopThread (2000);
+    listener = nullptr;
+}
+
+//==============================================================================
+void MetricsServer::run()
+{
+    while (! threadShouldExit())
+    {
+        updateStallCount();
+        updateMidiRate();
+
+        // a short wait, so the heartbeat gets checked well inside the stall threshold
+        if (listener->waitUntilReady (true, 100) != 1)
+            continue;
+
+        ScopedPointer<StreamingSocket> connection (listener->waitForNextConnection());
+
+        if (connection != nullptr)
+            respond (*connection);
+    }
+}
+
+void MetricsServer::respond (StreamingSocket& connection) const
+{
+    MemoryOutputStream request;
+    char buffer[1024];
+
+    // only the request line matters, but the headers are read so the client isn't cut off.
+    // A slow or silent client only gets a moment, so it can't hold up the stall checks
+    auto deadline = Time::getMillisecondCounter() + (uint32) requestTimeoutMs;
+
+    while (request.getDataSize() < 8192 && ! request.toString().contains ("\r\n\r\n"))
+    {
+        auto now = Time::getMillisecondCounter();
+
+        if (now >= deadline || connection.waitUntilReady (true, (int) (deadline - now)) != 1)
+            break;
+
+        auto numRead = connection.read (buffer, (int) sizeof (buffer), false);
+
+        if (numRead <= 0)
+            break;
+
+        request.write (buffer, (size_t) numRead);
+    }
+
+    auto requestLine = StringArray::fromTokens (request.toString().upToFirstOccurrenceOf ("\r\n", false, false), " ", "");
+    auto path = requestLine[1].upToFirstOccurrenceOf ("?", false, false);
+
+    String status, body;
+
+    if (requestLine[0] != "GET")
+    {
+        status = "405 Method Not Allowed";
+    }
+    else if (path == "/metrics" || path == "/")
+    {
+        status = "200 OK";
+        body = createExposition();
+    }
+    else
+    {
+        status = "404 Not Found";
+    }
+
+    auto bodyUTF8 = body.toUTF8();
+    auto bodySize = (int) CharPointer_UTF8::getBytesRequiredFor (body.getCharPointer());
+
+    String header;
+    header << "HTTP/1.1 " << status << "\r\n"
+           << "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+           << "Content-Length: " << bodySize << "\r\n"
+           << "Connection: close\r\n\r\n";
+
+    connection.write (header.toRawUTF8(), (int) header.getNumBytesAsUTF8());
+    connection.write (bodyUTF8.getAddress(), bodySize);
+}
+
+//==============================================================================
+String MetricsServer::createExposition() const
+{
+    String out;
+    out.preallocateBytes (8192);
+
+    addHeader (out, "meld_audio_callbacks_total", "counter", "Audio device callbacks run.");
+    addSample (out, "meld_audio_callbacks_total", (double) callbackMonitor.getNumCallbacks());
+
+    addHeader (out, "meld_audio_deadline_misses_total", "counter", "Audio callbacks that took longer than the audio they produced lasts.");
+    addSample (out, "meld_audio_deadline_misses_total", (double) callbackMonitor.getNumDeadlineMisses());
+
+    addHistogram (out, "meld_audio_callback_duration_seconds", "Time spent in each audio callback.", callbackMonitor.getDurations());
+
+    addHeader (out, "meld_audio_callback_load_ratio", "gauge", "Recent audio callback time as a fraction of the time available.");
+    addSample (out, "meld_audio_callback_load_ratio", callbackMonitor.getLoad());
+
+    addHeader (out, "meld_slot_cpu_seconds_total", "counter", "Time the audio thread has spent in each slot's plugin.");
+
+    for (int i = 0; i < FilterGraph::numSlots; ++i)
+        addSample (out, "meld_slot_cpu_seconds_total{slot=\"" + String (i + 1) + "\"}", graph.getSlotLoad (i).getTotalSeconds());
+
+    addHeader (out, "meld_slot_cpu_load_ratio", "gauge", "Recent time spent in each slot's plugin as a fraction of the audio it processed.");
+
+    for (int i = 0; i < FilterGraph::numSlots; ++i)
+        addSample (out, "meld_slot_cpu_load_ratio{slot=\"" + String (i + 1) + "\"}", graph.getSlotLoad (i).getLoad());
+
+    addHistogram (out, "meld_plugin_load_duration_seconds", "Time taken to load each plugin.", graph.getPluginLoadTimes());
+
+    addHeader (out, "meld_midi_events_total", "counter", "MIDI events received from enabled inputs.");
+    addSample (out, "meld_midi_events_total", (double) midiEvents.load (std::memory_order_relaxed));
+
+    addHeader (out, "meld_midi_events_per_second", "gauge", "MIDI events received over the last second.");
+    addSample (out, "meld_midi_events_per_second", midiEventsPerSecond.load (std::memory_order_relaxed));
+
+    addHeader (out, "meld_message_thread_stalls_total", "counter", "Times the message thread stopped responding for longer than the stall threshold.");
+    addSample (out, "meld_message_thread_stalls_total", (double) numStalls.load (std::memory_order_relaxed));
+
+    addHeader (out, "meld_message_thread_stall_seconds_total", "counter", "Time the message thread has spent stalled, not counting a stall still going on.");
+    addSample (out, "meld_message_thread_stall_seconds_total", stallMilliseconds.load (std::memory_order_relaxed) * 0.001);
+
+    addHeader (out, "meld_message_thread_heartbeat_age_seconds", "gauge", "Time since the message thread last responded.");
+    addSample (out, "meld_message_thread_heartbeat_age_seconds", (Time::getMillisecondCounter() - lastHeartbeat.load()) * 0.001);
+
+    int64 residentBytes = 0, virtualBytes = 0;
+
+    if (getProcessMemory (residentBytes, virtualBytes))
+    {
+        addHeader (out, "process_resident_memory_bytes", "gauge", "Resident memory size in bytes.");
+        addSample (out, "process_resident_memory_bytes", (double) residentBytes);
+
+        addHeader (out, "process_virtual_memory_bytes", "gauge", "Virtual memory size in bytes.");
+        addSample (out, "process_virtual_memory_bytes", (double) virtualBytes);
+    }
+
+    return out;
+}
+
+//==============================================================================
+void MetricsServer::updateStallCount()
+{
+    auto now = Time::getMillisecondCounter();
+    auto age = now - lastHeartbeat.load();
+
+    if (! stalled && age > (uint32) stallThresholdMs)
+    {
+        stalled = true;
+        stallStart = now - age;
+        ++numStalls;
+    }
+    else if (stalled && age <= (uint32) stallThresholdMs)
+    {
+        stalled = false;
+        stallMilliseconds += (int64) (lastHeartbeat.load() - stallStart);
+    }
+}
+
+void MetricsServer::updateMidiRate()
+{
+    auto now = Time::getMillisecondCounter();
+    auto elapsed = now - lastRateUpdate;
+
+    if (elapsed < 1000)
+        return;
+
+    auto events = midiEvents.load();
+    midiEventsPerSecond = (float) ((events - lastMidiEvents) * 1000.0 / elapsed);
+
+    lastMidiEvents = events;
+    lastRateUpdate = now;
+}
+
+void MetricsServer::handleIncomingMidiMessage (MidiInput*, const MidiMessage&)
+{
+    midiEvents.fetch_add (1, std::memory_order_relaxed);
+}
+
+void MetricsServer::timerCallback()
+{
+    lastHeartbeat = Time::getMillisecondCounter();
+}
@@ -0,0 +1,94 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+
+#pragma once
+
+#include "FilterGraph.h"
+#include "HostMetrics.h"
+
+
+//==============================================================================
+/**
+    Serves the host's health counters to a Prometheus scraper, over plain HTTP on
+    the loopback interface only.
+
+    Everything it reports is read from atomics that the audio, MIDI and message
+    threads keep up to date as they go, so a scrape never waits on any of them.
+    The message thread's heartbeat is watched from the server's own thread, which
+    is how stalls get counted while they're still going on.
+*/
+class MetricsServer  : private Thread,
+                       private MidiInputCallback,
+                       private Timer
+{
+public:
+    MetricsServer (FilterGraph&, const CallbackMonitor&, AudioDeviceManager&);
+    ~MetricsServer();
+
+    /** Starts listening on 127.0.0.1 at the given port, stopping first if already running. */
+    Result start (int port);
+    void stop();
+
+    bool isRunning() const                          { return isThreadRunning(); }
+
+    /** Everything there is to report, in the Prometheus text format. */
+    String createExposition() const;
+
+    /** The message thread counts as stalled once its heartbeat is this late. */
+    enum { heartbeatIntervalMs = 50, stallThresholdMs = 250 };
+
+    /** How long a client gets to send its whole request before it's answered anyway. */
+    enum { requestTimeoutMs = 50 };
+
+private:
+    //==============================================================================
+    FilterGraph& graph;
+    const CallbackMonitor& callbackMonitor;
+    AudioDeviceManager& deviceManager;
+
+    ScopedPointer<StreamingSocket> listener;
+
+    std::atomic<int64> midiEvents { 0 };
+    std::atomic<float> midiEventsPerSecond { 0.0f };
+    int64 lastMidiEvents = 0;
+    uint32 lastRateUpdate = 0;
+
+    std::atomic<uint32> lastHeartbeat { 0 };
+    std::atomic<int64> numStalls { 0 }, stallMilliseconds { 0 };
+    uint32 stallStart = 0;
+    bool stalled = false;
+
+    void run() override;
+    void respond (StreamingSocket&) const;
+    void updateStallCount();
+    void updateMidiRate();
+
+    void handleIncomingMidiMessage (MidiInput*, const MidiMessage&) override;
+    void timerCallback() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MetricsServer)
+};
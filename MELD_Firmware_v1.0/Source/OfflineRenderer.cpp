@@ -0,0 +1,259 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "OfflineRenderer.h"
+#include "Statistics.h"
+
+
+//==============================================================================
+static void writeBlock (AudioFormatWriter& writer, const AudioBuffer<float>& buffer)
+{
+    writer.writeFromAudioSampleBuffer (buffer, 0, buffer.getNumSamples());
+}
+
+static void writeBlock (AudioFormatWriter& writer, const AudioBuffer<double>& buffer)
+{
+    AudioBuffer<float> converted;
+    converted.makeCopyOf (buffer);
+    writeBlock (writer, converted);
+}
+
+//==============================================================================
+double OfflineRenderer::Report::getBlockPercentile (double fraction) const
+{
+    return percentile (blockSeconds, fraction);
+}
+
+//==============================================================================
+OfflineRenderer::OfflineRenderer (AudioProcessorGraph& g)  : graph (g) {}
+OfflineRenderer::~OfflineRenderer() {}
+
+bool OfflineRenderer::loadMidiFile (const File& file, MidiMessageSequence& result, String& error)
+{
+    FileInputStream in (file);
+
+    if (in.failedToOpen())
+    {
+        error = "Couldn't open " + file.getFullPathName();
+        return false;
+    }
+
+    MidiFile midiFile;
+
+    if (! midiFile.readFrom (in))
+    {
+        error = file.getFileName() + " isn't a Standard MIDI File";
+        return false;
+    }
+
+    midiFile.convertTimestampTicksToSeconds();
+    result.clear();
+
+    for (int i = 0; i < midiFile.getNumTracks(); ++i)
+        result.addSequence (*midiFile.getTrack (i), 0.0, 0.0, std::numeric_limits<double>::max());
+
+    result.updateMatchedPairs();
+    return true;
+}
+
+MidiMessageSequence OfflineRenderer::createTestPattern (double lengthSeconds)
+{
+    MidiMessageSequence sequence;
+    const int chord[] = { 0, 4, 7, 11 };
+    int bar = 0;
+
+    for (double t = 0; t < lengthSeconds; t += 2.0, ++bar)
+    {
+        auto root = 36 + (bar * 5) % 36;
+
+        for (auto interval : chord)
+        {
+            sequence.addEvent (MidiMessage::noteOn (1, root + interval, (uint8) 90), t);
+            sequence.addEvent (MidiMessage::noteOff (1, root + interval), t + 1.75);
+        }
+
+        for (int i = 0; i < 16; ++i)
+        {
+            auto note = root + 24 + chord[i % 4];
+            sequence.addEvent (MidiMessage::noteOn (1, note, (uint8) (60 + i * 3)), t + i * 0.125);
+            sequence.addEvent (MidiMessage::noteOff (1, note), t + i * 0.125 + 0.1);
+        }
+    }
+
+    sequence.updateMatchedPairs();
+    return sequence;
+}
+
+int64 OfflineRenderer::getLengthInSamples (const MidiMessageSequence& sequence, const Settings& settings) const
+{
+    return (int64) ((sequence.getEndTime() + settings.tailSeconds) * settings.sampleRate);
+}
+
+void OfflineRenderer::fillMidiBuffer (MidiBuffer& midi, const MidiMessageSequence& sequence, int& nextEvent,
+                                      int64 blockStart, int numSamples, double sampleRate)
+{
+    midi.clear();
+
+    for (; nextEvent < sequence.getNumEvents(); ++nextEvent)
+    {
+        auto& message = sequence.getEventPointer (nextEvent)->message;
+        auto position = (int64) (message.getTimeStamp() * sampleRate);
+
+        if (position >= blockStart + numSamples)
+            break;
+
+        // tempo and track names mean nothing to the graph
+        if (! message.isMetaEvent())
+            midi.addEvent (message, (int) jmax ((int64) 0, position - blockStart));
+    }
+}
+
+//==============================================================================
+template <typename FloatType>
+void OfflineRenderer::renderBlocks (const MidiMessageSequence& sequence, const Settings& settings,
+                                    AudioFormatWriter* writer, Report& report)
+{
+    auto length = getLengthInSamples (sequence, settings);
+    auto numChannels = jmax (graph.getTotalNumInputChannels(), graph.getTotalNumOutputChannels());
+
+    AudioBuffer<FloatType> buffer (numChannels, settings.blockSize);
+    MidiBuffer midi;
+    int nextEvent = 0;
+
+    report.blockSeconds.ensureStorageAllocated ((int) (length / settings.blockSize) + 1);
+
+    for (int64 position = 0; position < length; position += settings.blockSize)
+    {
+        auto numSamples = (int) jmin ((int64) settings.blockSize, length - position);
+
+        if (settings.beforeBlock != nullptr)
+            settings.beforeBlock (position);
+
+        buffer.setSize (numChannels, numSamples, false, false, true);
+        buffer.clear();
+        fillMidiBuffer (midi, sequence, nextEvent, position, numSamples, settings.sampleRate);
+
+        auto start = Time::getHighResolutionTicks();
+        graph.processBlock (buffer, midi);
+        auto seconds = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start);
+
+        report.blockSeconds.add (seconds);
+        report.renderSeconds += seconds;
+
+        if (writer != nullptr)
+            writeBlock (*writer, buffer);
+    }
+
+    report.numSamples = length;
+}
+
+OfflineRenderer::Report OfflineRenderer::render (const MidiMessageSequence& sequence, const Settings& settings,
+                                                 AudioFormatWriter* writer)
+{
+    Report report;
+    report.sampleRate = settings.sampleRate;
+
+    auto useDouble = settings.doublePrecision && graph.supportsDoublePrecisionProcessing();
+
+    graph.setProcessingPrecision (useDouble ? AudioProcessor::doublePrecision : AudioProcessor::singlePrecision);
+    graph.setPlayConfigDetails (0, 2, settings.sampleRate, settings.blockSize);
+    graph.setNonRealtime (true);
+    graph.prepareToPlay (settings.sampleRate, settings.blockSize);
+
+    if (useDouble)
+        renderBlocks<double> (sequence, settings, writer, report);
+    else
+        renderBlocks<float> (sequence, settings, writer, report);
+
+    graph.releaseResources();
+    graph.setNonRealtime (false);
+
+    return report;
+}
+
+Array<OfflineRenderer::NodeTiming> OfflineRenderer::timeNodes (const MidiMessageSequence& sequence, const Settings& settings)
+{
+    Array<NodeTiming> results;
+
+    graph.setProcessingPrecision (AudioProcessor::singlePrecision);
+    graph.setPlayConfigDetails (0, 2, settings.sampleRate, settings.blockSize);
+    graph.setNonRealtime (true);
+    graph.prepareToPlay (settings.sampleRate, settings.blockSize);
+
+    auto length = getLengthInSamples (sequence, settings);
+
+    for (auto* node : graph.getNodes())
+    {
+        auto* processor = node->getProcessor();
+
+        if (dynamic_cast<AudioProcessorGraph::AudioGraphIOProcessor*> (processor) != nullptr)
+            continue;
+
+        NodeTiming timing;
+        timing.nodeID = node->nodeID;
+        timing.name = processor->getName();
+
+        auto numChannels = jmax (1, processor->getTotalNumInputChannels(), processor->getTotalNumOutputChannels());
+        AudioBuffer<float> buffer (numChannels, settings.blockSize);
+        MidiBuffer midi;
+        int nextEvent = 0;
+
+        // the same noise for every node and every run, about 40dB down
+        Random random (1);
+        processor->reset();
+
+        for (int64 position = 0; position < length; position += settings.blockSize)
+        {
+            auto numSamples = (int) jmin ((int64) settings.blockSize, length - position);
+            buffer.setSize (numChannels, numSamples, false, false, true);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+                for (int i = 0; i < numSamples; ++i)
+                    buffer.setSample (ch, i, (random.nextFloat() * 2.0f - 1.0f) * 0.01f);
+
+            fillMidiBuffer (midi, sequence, nextEvent, position, numSamples, settings.sampleRate);
+
+            const ScopedLock sl (processor->getCallbackLock());
+
+            auto start = Time::getHighResolutionTicks();
+            processor->processBlock (buffer, midi);
+            auto seconds = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start);
+
+            timing.totalSeconds += seconds;
+            timing.maxBlockSeconds = jmax (timing.maxBlockSeconds, seconds);
+            ++timing.numBlocks;
+        }
+
+        results.add (timing);
+    }
+
+    graph.releaseResources();
+    graph.setNonRealtime (false);
+
+    return results;
+}
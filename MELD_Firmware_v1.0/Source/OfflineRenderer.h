@@ -0,0 +1,113 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+
+#pragma once
+
+
+//==============================================================================
+/**
+    Renders an AudioProcessorGraph offline as fast as it will go, driven by a MIDI
+    sequence, and times it.
+
+    Only the processBlock calls are timed, so writing the result to disk doesn't
+    count against the graph. The graph is prepared and released by render(); it
+    mustn't be attached to a live device while this runs.
+*/
+class OfflineRenderer
+{
+public:
+    OfflineRenderer (AudioProcessorGraph&);
+    ~OfflineRenderer();
+
+    struct Settings
+    {
+        double sampleRate = 44100.0;
+        int blockSize = 512;
+        double tailSeconds = 2.0;
+        bool doublePrecision = false;
+
+        /** Called before each block with its start in samples, for changing the graph on cue. */
+        std::function<void (int64)> beforeBlock;
+    };
+
+    struct Report
+    {
+        double sampleRate = 0;
+        int64 numSamples = 0;
+        double renderSeconds = 0;
+        Array<double> blockSeconds;
+
+        double getAudioSeconds() const noexcept         { return sampleRate > 0 ? numSamples / sampleRate : 0.0; }
+
+        /** How many times faster than realtime the graph ran. */
+        double getRealtimeFactor() const noexcept       { return renderSeconds > 0 ? getAudioSeconds() / renderSeconds : 0.0; }
+
+        /** The block time below which this fraction of blocks fell, e.g. 0.99 for p99. */
+        double getBlockPercentile (double fraction) const;
+    };
+
+    struct NodeTiming
+    {
+        AudioProcessorGraph::NodeID nodeID;
+        String name;
+        int numBlocks = 0;
+        double totalSeconds = 0, maxBlockSeconds = 0;
+    };
+
+    //==============================================================================
+    /** Renders the sequence plus the tail, passing the output to the writer if there is one. */
+    Report render (const MidiMessageSequence&, const Settings&, AudioFormatWriter* writer = nullptr);
+
+    /** Runs each node's processor on its own, over as many blocks as render() would, with the
+        same MIDI and some low-level noise as input. The graph's render order isn't exposed,
+        so this is how the cost of the whole is broken down.
+    */
+    Array<NodeTiming> timeNodes (const MidiMessageSequence&, const Settings&);
+
+    /** Merges all the tracks of a Standard MIDI File into one sequence, timed in seconds. */
+    static bool loadMidiFile (const File&, MidiMessageSequence& result, String& error);
+
+    /** The same few bars every time: chords walking up the keyboard, with some fast notes on top.
+        The benchmarks all use this, so their numbers can be compared.
+    */
+    static MidiMessageSequence createTestPattern (double lengthSeconds);
+
+    /** Fills a buffer with the sequence's events that fall in a block, skipping meta events. */
+    static void fillMidiBuffer (MidiBuffer&, const MidiMessageSequence&, int& nextEvent,
+                                int64 blockStart, int numSamples, double sampleRate);
+
+private:
+    //==============================================================================
+    AudioProcessorGraph& graph;
+
+    int64 getLengthInSamples (const MidiMessageSequence&, const Settings&) const;
+
+    template <typename FloatType>
+    void renderBlocks (const MidiMessageSequence&, const Settings&, AudioFormatWriter*, Report&);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OfflineRenderer)
+};
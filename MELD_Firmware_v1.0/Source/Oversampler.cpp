@@ -0,0 +1,293 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "Oversampler.h"
+
+
+//==============================================================================
+static double besselI0 (double x) noexcept
+{
+    double sum = 1.0, term = 1.0;
+
+    for (int k = 1; k < 64; ++k)
+    {
+        auto t = x / (2.0 * k);
+        term *= t * t;
+        sum += term;
+
+        if (term < sum * 1.0e-12)
+            break;
+    }
+
+    return sum;
+}
+
+//==============================================================================
+/*
+    One 2x stage. With numTaps non-zero taps the full filter is 2 * numTaps - 1
+    long, its centre tap is 0.5, and it delays by numTaps - 1 samples at the
+    higher rate, both ways.
+
+    Each channel keeps the last numTaps - 1 inputs in front of the new ones, so
+    every tap can be applied to a whole block with one vector operation.
+*/
+struct HalfBandOversampler::Stage
+{
+    Stage (int taps, int channels, int maxInput)
+        : numTaps (taps), numChannels (channels), maxInputSize (maxInput),
+          historySize (taps - 1 + maxInput)
+    {
+        coefficients.calloc ((size_t) numTaps);
+        upCoefficients.calloc ((size_t) numTaps);
+
+        const double beta = 8.0;
+        auto windowScale = 1.0 / besselI0 (beta);
+        double sum = 0;
+
+        for (int j = 0; j < numTaps; ++j)
+        {
+            // the even taps of the full filter, which all sit an odd distance from its centre
+            auto t = 2.0 * j - (numTaps - 1);
+            auto x = t / numTaps;
+            auto arg = double_Pi * t * 0.5;
+            auto value = 0.5 * std::sin (arg) / arg * besselI0 (beta * std::sqrt (1.0 - x * x)) * windowScale;
+
+            coefficients[j] = (float) value;
+            sum += value;
+        }
+
+        // with the centre tap, the filter passes DC at exactly unity gain
+        for (int j = 0; j < numTaps; ++j)
+        {
+            coefficients[j] = (float) (coefficients[j] * 0.5 / sum);
+
+            // zero-stuffing halves the level, so the interpolating phase makes it up
+            upCoefficients[j] = coefficients[j] * 2.0f;
+        }
+
+        upHistory.setSize (numChannels, historySize);
+        evenHistory.setSize (numChannels, historySize);
+        oddHistory.setSize (numChannels, numTaps / 2 + maxInputSize);
+        scratch.setSize (1, maxInputSize);
+        output.setSize (numChannels, 2 * maxInputSize);
+
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        upHistory.clear();
+        evenHistory.clear();
+        oddHistory.clear();
+    }
+
+    void up (const float* const* input, int num) noexcept
+    {
+        jassert (num <= maxInputSize);
+        auto* filtered = scratch.getWritePointer (0);
+        auto delay = numTaps / 2;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            auto* h = upHistory.getWritePointer (ch);
+            auto* x = h + numTaps - 1;
+            FloatVectorOperations::copy (x, input[ch], num);
+
+            FloatVectorOperations::multiply (filtered, x, upCoefficients[0], num);
+
+            for (int j = 1; j < numTaps; ++j)
+                FloatVectorOperations::addWithMultiply (filtered, x - j, upCoefficients[j], num);
+
+            auto* out = output.getWritePointer (ch);
+
+            for (int i = 0; i < num; ++i)
+            {
+                out[2 * i]     = filtered[i];
+                out[2 * i + 1] = h[i + delay];
+            }
+
+            std::memmove (h, h + num, sizeof (float) * (size_t) (numTaps - 1));
+        }
+    }
+
+    void down (float* const* destination, int num) noexcept
+    {
+        jassert (num <= maxInputSize);
+        auto delay = numTaps / 2;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            auto* in = output.getReadPointer (ch);
+            auto* even = evenHistory.getWritePointer (ch);
+            auto* odd = oddHistory.getWritePointer (ch);
+            auto* x = even + numTaps - 1;
+
+            for (int i = 0; i < num; ++i)
+            {
+                x[i] = in[2 * i];
+                odd[delay + i] = in[2 * i + 1];
+            }
+
+            auto* out = destination[ch];
+            FloatVectorOperations::multiply (out, odd, 0.5f, num);
+
+            for (int j = 0; j < numTaps; ++j)
+                FloatVectorOperations::addWithMultiply (out, x - j, coefficients[j], num);
+
+            std::memmove (even, even + num, sizeof (float) * (size_t) (numTaps - 1));
+            std::memmove (odd, odd + num, sizeof (float) * (size_t) delay);
+        }
+    }
+
+    const int numTaps, numChannels, maxInputSize, historySize;
+    HeapBlock<float> coefficients, upCoefficients;
+    AudioBuffer<float> upHistory, evenHistory, oddHistory, scratch;
+
+    // the stage's higher-rate signal: written on the way up, processed in place, read on the way down
+    AudioBuffer<float> output;
+
+    JUCE_DECLARE_NON_COPYABLE (Stage)
+};
+
+//==============================================================================
+HalfBandOversampler::HalfBandOversampler() {}
+HalfBandOversampler::~HalfBandOversampler() {}
+
+void HalfBandOversampler::prepare (int newNumChannels, int maxBlockSize, int numStages)
+{
+    jassert (numStages >= 0 && numStages <= maxStages);
+
+    numChannels = newNumChannels;
+    stages.clear();
+
+    for (int i = 0; i < jlimit (0, (int) maxStages, numStages); ++i)
+        stages.add (new Stage (getNumTapsForStage (i), numChannels, maxBlockSize << i));
+}
+
+void HalfBandOversampler::reset() noexcept
+{
+    for (auto* stage : stages)
+        stage->reset();
+}
+
+float** HalfBandOversampler::processUp (const float* const* input, int num) noexcept
+{
+    for (auto* stage : stages)
+    {
+        stage->up (input, num);
+        input = stage->output.getArrayOfReadPointers();
+        num *= 2;
+    }
+
+    return stages.isEmpty() ? nullptr : stages.getLast()->output.getArrayOfWritePointers();
+}
+
+void HalfBandOversampler::processDown (float* const* output, int num) noexcept
+{
+    for (int i = stages.size(); --i >= 0;)
+    {
+        auto* destination = i > 0 ? stages.getUnchecked (i - 1)->output.getArrayOfWritePointers() : output;
+        stages.getUnchecked (i)->down (destination, num << i);
+    }
+}
+
+double HalfBandOversampler::getLatencyInSamples (int numStages) noexcept
+{
+    double latency = 0;
+
+    // each stage delays by numTaps - 1 at its higher rate on the way up, and again on the way down
+    for (int i = 0; i < numStages; ++i)
+        latency += 2.0 * (getNumTapsForStage (i) - 1) / (2 << i);
+
+    return latency;
+}
+
+//==============================================================================
+OversamplingWrapper::OversamplingWrapper (AudioPluginInstance* pluginToWrap, int f)
+    : PluginWrapper (pluginToWrap),
+      factor (f),
+      numStages (f >= 8 ? 3 : (f >= 4 ? 2 : 1))
+{
+    jassert (isValidFactor (factor));
+    updateLatency();
+}
+
+OversamplingWrapper::~OversamplingWrapper() {}
+
+//==============================================================================
+void OversamplingWrapper::prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock)
+{
+    auto numChannels = jmax (getTotalNumInputChannels(), getTotalNumOutputChannels());
+
+    oversampler.prepare (numChannels, maximumExpectedSamplesPerBlock, numStages);
+    oversampledMidi.ensureSize (midiBufferBytes);
+
+    prepareWrappedPlugin (sampleRate * factor, maximumExpectedSamplesPerBlock * factor);
+    updateLatency();
+}
+
+void OversamplingWrapper::reset()
+{
+    PluginWrapper::reset();
+    oversampler.reset();
+}
+
+void OversamplingWrapper::processBlock (AudioBuffer<float>& buffer, MidiBuffer& midi)
+{
+    ScopedNoDenormals noDenormals;
+
+    auto numSamples = buffer.getNumSamples();
+    auto numChannels = jmin (buffer.getNumChannels(), oversampler.getNumChannels());
+
+    auto* up = oversampler.processUp (buffer.getArrayOfReadPointers(), numSamples);
+    oversampledBuffer.setDataToReferTo (up, numChannels, numSamples * factor);
+
+    const uint8* data;
+    int size, position;
+
+    oversampledMidi.clear();
+
+    for (MidiBuffer::Iterator i (midi); i.getNextEvent (data, size, position);)
+        oversampledMidi.addEvent (data, size, position * factor);
+
+    plugin->processBlock (oversampledBuffer, oversampledMidi);
+
+    oversampler.processDown (buffer.getArrayOfWritePointers(), numSamples);
+
+    midi.clear();
+
+    for (MidiBuffer::Iterator i (oversampledMidi); i.getNextEvent (data, size, position);)
+        midi.addEvent (data, size, position / factor);
+}
+
+void OversamplingWrapper::updateLatency()
+{
+    // the plugin's own latency is counted in its faster samples
+    setLatencySamples (roundToInt (HalfBandOversampler::getLatencyInSamples (numStages)
+                                     + plugin->getLatencySamples() / (double) factor));
+}
@@ -0,0 +1,121 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+
+#pragma once
+
+#include "PluginWrapper.h"
+
+
+//==============================================================================
+/**
+    Takes a block up to 2, 4 or 8 times its rate and back down again, through a
+    cascade of half-band FIR stages.
+
+    Every other tap of a half-band filter is zero apart from the centre one, so
+    each stage splits into two phases: one runs the non-zero taps at the lower
+    rate, the other is just a delay. The taps are applied with
+    FloatVectorOperations, a whole block at a time, so the work is vectorised
+    across samples. Later stages have more room before their images fold back, so
+    they use shorter filters than the first.
+*/
+class HalfBandOversampler
+{
+public:
+    HalfBandOversampler();
+    ~HalfBandOversampler();
+
+    enum
+    {
+        maxStages       = 3,
+        firstStageTaps  = 32,
+        laterStageTaps  = 16
+    };
+
+    /** Allocates everything. Call it before the audio starts. */
+    void prepare (int numChannels, int maxBlockSize, int numStages);
+    void reset() noexcept;
+
+    int getFactor() const noexcept                  { return 1 << stages.size(); }
+    int getNumChannels() const noexcept             { return numChannels; }
+
+    /** Upsamples a block, and returns the buffers holding num * getFactor() samples per channel. */
+    float** processUp (const float* const* input, int num) noexcept;
+
+    /** Brings whatever processUp returned, processed in place, back down to the original rate. */
+    void processDown (float* const* output, int num) noexcept;
+
+    /** The delay of a round trip through this many stages, in samples at the original rate. */
+    static double getLatencyInSamples (int numStages) noexcept;
+
+private:
+    //==============================================================================
+    struct Stage;
+    OwnedArray<Stage> stages;
+
+    static int getNumTapsForStage (int stage) noexcept     { return stage == 0 ? firstStageTaps : laterStageTaps; }
+    int numChannels = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (HalfBandOversampler)
+};
+
+//==============================================================================
+/**
+    Runs a plugin at a multiple of the graph's rate.
+
+    Like any PluginWrapper, a saved session still refers to the plugin itself, and
+    only records the factor alongside it.
+*/
+class OversamplingWrapper  : public PluginWrapper
+{
+public:
+    OversamplingWrapper (AudioPluginInstance* pluginToWrap, int factor);
+    ~OversamplingWrapper();
+
+    static bool isValidFactor (int factor) noexcept     { return factor == 2 || factor == 4 || factor == 8; }
+
+    int getFactor() const noexcept                      { return factor; }
+
+    //==============================================================================
+    void prepareToPlay (double, int) override;
+    void processBlock (AudioBuffer<float>&, MidiBuffer&) override;
+    void reset() override;
+
+private:
+    //==============================================================================
+    const int factor, numStages;
+
+    HalfBandOversampler oversampler;
+    AudioBuffer<float> oversampledBuffer;
+    MidiBuffer oversampledMidi;
+
+    // room for a busy block of events, so copying the MIDI across doesn't allocate
+    enum { midiBufferBytes = 4096 };
+
+    void updateLatency() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OversamplingWrapper)
+};
@@ -0,0 +1,312 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "PluginBenchmark.h"
+#include "OfflineRenderer.h"
+#include "Statistics.h"
+
+//==============================================================================
+PluginBenchmark::PluginBenchmark (AudioPluginFormatManager& fm, const Array<PluginDescription>& types,
+                                  const Settings& s, Component* componentToCentreAround)
+    : ThreadWithProgressWindow ("Benchmarking Plugins", true, true, 10000, {}, componentToCentreAround),
+      formatManager (fm), descriptions (types), settings (s)
+{
+}
+
+PluginBenchmark::~PluginBenchmark()
+{
+    // the thread checks often and never waits on the message thread, so this doesn't hold it up
+    stopThread (10000);
+}
+
+//==============================================================================
+void PluginBenchmark::run()
+{
+    for (int i = 0; i < descriptions.size() && ! threadShouldExit(); ++i)
+    {
+        auto& description = descriptions.getReference (i);
+        auto* result = results.add (new PluginResult());
+        result->description = description;
+
+        setStatusMessage ("Measuring " + description.name + " (" + String (i + 1)
+                            + " of " + String (descriptions.size()) + ")");
+
+        auto* instance = createInstance (description, result->error);
+
+        if (instance == nullptr)
+        {
+            if (result->error.isEmpty())
+                result->error = "couldn't be loaded";
+
+            continue;
+        }
+
+        measure (*instance, settings, *result, [this, i] (double progress)
+        {
+            setProgress ((i + progress) / descriptions.size());
+            return ! threadShouldExit();
+        });
+
+        deleteInstance (instance);
+    }
+}
+
+void PluginBenchmark::threadComplete (bool userPressedCancel)
+{
+    if (onFinished != nullptr)
+        onFinished (userPressedCancel);
+}
+
+//==============================================================================
+/*  Plugin formats expect to be created and deleted on the message thread. Cancelling stops this
+    thread from the message thread, so rather than block on it, the request is posted and
+    waited for a little at a time, and a request that's given up on cleans up after itself.
+*/
+struct PluginBenchmark::InstanceRequest  : public ReferenceCountedObject
+{
+    InstanceRequest (AudioPluginFormatManager& fm, const PluginDescription& d)
+        : formatManager (fm), description (d)
+    {}
+
+    AudioPluginFormatManager& formatManager;
+    PluginDescription description;
+    AudioPluginInstance* instance = nullptr;
+    String error;
+    WaitableEvent finished;
+
+    using Ptr = ReferenceCountedObjectPtr<InstanceRequest>;
+};
+
+AudioPluginInstance* PluginBenchmark::createInstance (const PluginDescription& description, String& error)
+{
+    InstanceRequest::Ptr request (new InstanceRequest (formatManager, description));
+
+    MessageManager::callAsync ([request]
+    {
+        request->instance = request->formatManager.createPluginInstance (request->description, 44100.0, 512, request->error);
+        request->finished.signal();
+    });
+
+    while (! request->finished.wait (50))
+    {
+        if (threadShouldExit())
+        {
+            // messages are delivered in order, so this runs once the instance exists
+            MessageManager::callAsync ([request]    { delete request->instance; });
+            return nullptr;
+        }
+    }
+
+    error = request->error;
+    return request->instance;
+}
+
+void PluginBenchmark::deleteInstance (AudioPluginInstance* instance)
+{
+    MessageManager::callAsync ([instance]    { delete instance; });
+}
+
+//==============================================================================
+void PluginBenchmark::measure (AudioPluginInstance& instance, const Settings& settings, PluginResult& result,
+                               std::function<bool (double)> progressCallback)
+{
+    auto pattern = OfflineRenderer::createTestPattern (settings.secondsPerRun);
+    auto numChannels = jmax (1, instance.getTotalNumInputChannels(), instance.getTotalNumOutputChannels());
+    auto numRuns = settings.sampleRates.size() * settings.blockSizes.size();
+    int run = 0;
+
+    Array<int> safeAtEveryRate (settings.blockSizes);
+
+    for (auto sampleRate : settings.sampleRates)
+    {
+        for (auto blockSize : settings.blockSizes)
+        {
+            if (progressCallback != nullptr && ! progressCallback (run / (double) numRuns))
+                return;
+
+            instance.setRateAndBufferSizeDetails (sampleRate, blockSize);
+            instance.prepareToPlay (sampleRate, blockSize);
+
+            auto length = (int64) (settings.secondsPerRun * sampleRate);
+            AudioBuffer<float> buffer (numChannels, blockSize);
+            MidiBuffer midi;
+            Array<double> loads;
+            loads.ensureStorageAllocated ((int) (length / blockSize) + 1);
+
+            // the same noise for every plugin, about 40dB down, so effects have something to chew on
+            Random random (1);
+            int nextEvent = 0;
+
+            for (int64 position = 0; position < length; position += blockSize)
+            {
+                // a slow plugin can take a while over one run, so a cancel is checked between blocks too
+                if (progressCallback != nullptr && ! progressCallback ((run + position / (double) length) / numRuns))
+                {
+                    instance.releaseResources();
+                    return;
+                }
+
+                auto numSamples = (int) jmin ((int64) blockSize, length - position);
+                buffer.setSize (numChannels, numSamples, false, false, true);
+
+                for (int ch = 0; ch < numChannels; ++ch)
+                    for (int n = 0; n < numSamples; ++n)
+                        buffer.setSample (ch, n, (random.nextFloat() * 2.0f - 1.0f) * 0.01f);
+
+                OfflineRenderer::fillMidiBuffer (midi, pattern, nextEvent, position, numSamples, sampleRate);
+
+                const ScopedLock sl (instance.getCallbackLock());
+
+                auto start = Time::getHighResolutionTicks();
+                instance.processBlock (buffer, midi);
+                auto seconds = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start);
+
+                loads.add (seconds * sampleRate / numSamples);
+            }
+
+            instance.releaseResources();
+            ++run;
+
+            Measurement m;
+            m.sampleRate = sampleRate;
+            m.blockSize = blockSize;
+            m.numBlocks = loads.size();
+
+            for (auto load : loads)
+                m.meanLoad += load;
+
+            m.meanLoad /= jmax (1, loads.size());
+
+            m.medianLoad = percentile (loads, 0.5);
+            m.p99Load    = percentile (loads, 0.99);
+            m.maxLoad    = percentile (loads, 1.0);
+
+            result.measurements.add (m);
+
+            // a plugin that ever takes a whole block would drop out on a device, whatever the p99
+            if (m.p99Load > settings.loadBudget || m.maxLoad >= 1.0)
+                safeAtEveryRate.removeFirstMatchingValue (blockSize);
+        }
+    }
+
+    // a size only counts if every larger one is safe too, so a lucky small size doesn't win
+    result.recommendedBlockSize = 0;
+
+    for (int i = settings.blockSizes.size(); --i >= 0;)
+    {
+        if (! safeAtEveryRate.contains (settings.blockSizes[i]))
+            break;
+
+        result.recommendedBlockSize = settings.blockSizes[i];
+    }
+
+    result.complete = true;
+
+    if (progressCallback != nullptr)
+        progressCallback (1.0);
+}
+
+//==============================================================================
+String PluginBenchmark::createReport() const
+{
+    String report;
+    report << "Budget: " << roundToInt (settings.loadBudget * 100.0) << "% of each block at p99, "
+           << "never a whole block" << newLine
+           << "Appliance block size: " << settings.applianceBlockSize << newLine;
+
+    for (auto* result : results)
+    {
+        report << newLine << result->description.name << " (" << result->description.pluginFormatName << ")" << newLine;
+
+        if (result->error.isNotEmpty())
+        {
+            report << "    failed: " << result->error << newLine;
+            continue;
+        }
+
+        if (! result->complete)
+            report << "    stopped before every size was measured" << newLine;
+        else if (result->recommendedBlockSize > 0)
+            report << "    recommended minimum block size: " << result->recommendedBlockSize << newLine;
+        else
+            report << "    not safe at any block size measured" << newLine;
+
+        report << "    safe at " << settings.applianceBlockSize << ": "
+               << (result->isSafeAt (settings.applianceBlockSize) ? "yes" : "NO") << newLine
+               << "        rate  block    mean  median     p99     max" << newLine;
+
+        for (auto& m : result->measurements)
+        {
+            auto percent = [] (double load)    { return String (load * 100.0, 1).paddedLeft (' ', 7) + "%"; };
+
+            report << String (roundToInt (m.sampleRate)).paddedLeft (' ', 12)
+                   << String (m.blockSize).paddedLeft (' ', 7)
+                   << percent (m.meanLoad) << percent (m.medianLoad)
+                   << percent (m.p99Load) << percent (m.maxLoad) << newLine;
+        }
+    }
+
+    return report;
+}
+
+//==============================================================================
+void PluginBenchmark::storeRecommendations (PropertiesFile& properties, const OwnedArray<PluginResult>& newResults)
+{
+    ScopedPointer<XmlElement> xml (properties.getXmlValue ("pluginBenchmarks"));
+
+    if (xml == nullptr)
+        xml = new XmlElement ("PLUGINBENCHMARKS");
+
+    for (auto* result : newResults)
+    {
+        if (result->error.isNotEmpty() || ! result->complete)
+            continue;
+
+        auto identifier = result->description.createIdentifierString();
+        xml->removeChildElement (xml->getChildByAttribute ("id", identifier), true);
+
+        auto* e = xml->createNewChildElement ("PLUGIN");
+        e->setAttribute ("id", identifier);
+        e->setAttribute ("name", result->description.name);
+        e->setAttribute ("recommendedBlockSize", result->recommendedBlockSize);
+        e->setAttribute ("measured", Time::getCurrentTime().toISO8601 (true));
+    }
+
+    properties.setValue ("pluginBenchmarks", xml);
+}
+
+int PluginBenchmark::getRecommendedBlockSize (PropertiesFile& properties, const PluginDescription& description)
+{
+    ScopedPointer<XmlElement> xml (properties.getXmlValue ("pluginBenchmarks"));
+
+    if (xml != nullptr)
+        if (auto* e = xml->getChildByAttribute ("id", description.createIdentifierString()))
+            return e->getIntAttribute ("recommendedBlockSize");
+
+    return -1;
+}
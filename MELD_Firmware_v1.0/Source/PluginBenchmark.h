@@ -0,0 +1,133 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+
+#pragma once
+
+
+//==============================================================================
+/**
+    Times single plugins on their own, away from the live graph, at each of a
+    set of sample rates and block sizes, and works out the smallest block size
+    each one can be trusted with.
+
+    Each plugin is loaded in turn, fed the same MIDI pattern and some low-level
+    noise, and the cost of every processBlock call is recorded as a share of
+    the time that block has on a real device. Plugins are created and deleted
+    on the message thread; only the processing happens on the benchmark's own,
+    which never blocks waiting for the message thread, so cancelling is prompt.
+
+    The recommendations are kept in the user settings, so whatever wants to
+    know if a plugin is safe at a given buffer size can look them up later.
+*/
+class PluginBenchmark  : public ThreadWithProgressWindow
+{
+public:
+    struct Settings
+    {
+        Array<double> sampleRates { 44100.0, 48000.0, 96000.0 };
+        Array<int> blockSizes { 32, 64, 128, 256, 512, 1024, 2048 };
+        double secondsPerRun = 4.0;
+
+        /** The share of a block one plugin may use in 99% of blocks. The rest is left for
+            the other slots and the graph itself.
+        */
+        double loadBudget = 0.25;
+
+        /** The buffer size the appliance runs at, which every report is checked against. */
+        int applianceBlockSize = 64;
+    };
+
+    struct Measurement
+    {
+        double sampleRate = 0;
+        int blockSize = 0;
+        int numBlocks = 0;
+
+        // each block's processing time divided by its duration
+        double meanLoad = 0, medianLoad = 0, p99Load = 0, maxLoad = 0;
+    };
+
+    struct PluginResult
+    {
+        PluginDescription description;
+        String error;
+        Array<Measurement> measurements;
+
+        /** The smallest block size that stayed within budget at every rate, or 0 if none did. */
+        int recommendedBlockSize = 0;
+
+        /** False if the run stopped before every rate and block size had been measured. */
+        bool complete = false;
+
+        bool isSafeAt (int blockSize) const noexcept    { return recommendedBlockSize > 0 && blockSize >= recommendedBlockSize; }
+    };
+
+    PluginBenchmark (AudioPluginFormatManager&, const Array<PluginDescription>&,
+                     const Settings&, Component* componentToCentreAround = nullptr);
+    ~PluginBenchmark();
+
+    /** Called on the message thread once the run finishes or is cancelled. */
+    std::function<void (bool wasCancelled)> onFinished;
+
+    const OwnedArray<PluginResult>& getResults() const noexcept     { return results; }
+    const Settings& getSettings() const noexcept                    { return settings; }
+    String createReport() const;
+
+    //==============================================================================
+    /** Times an instance that's already been created at every rate and block size. Returning
+        false from the progress callback stops it early.
+    */
+    static void measure (AudioPluginInstance&, const Settings&, PluginResult&,
+                         std::function<bool (double progress)> progressCallback = nullptr);
+
+    /** Keeps the recommendations from a run in the settings, replacing any older ones.
+        Results that failed or weren't complete are left out.
+    */
+    static void storeRecommendations (PropertiesFile&, const OwnedArray<PluginResult>&);
+
+    /** The block size a previous run recommended for a plugin, 0 if no size was safe,
+        or -1 if it's never been measured.
+    */
+    static int getRecommendedBlockSize (PropertiesFile&, const PluginDescription&);
+
+private:
+    //==============================================================================
+    AudioPluginFormatManager& formatManager;
+    Array<PluginDescription> descriptions;
+    Settings settings;
+    OwnedArray<PluginResult> results;
+
+    void run() override;
+    void threadComplete (bool userPressedCancel) override;
+
+    struct InstanceRequest;
+
+    AudioPluginInstance* createInstance (const PluginDescription&, String& error);
+    void deleteInstance (AudioPluginInstance*);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PluginBenchmark)
+};
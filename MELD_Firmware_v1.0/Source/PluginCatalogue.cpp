@@ -0,0 +1,273 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "PluginCatalogue.h"
+
+
+//==============================================================================
+static int compareForSortMethod (const PluginDescription& a, const PluginDescription& b,
+                                 KnownPluginList::SortMethod method)
+{
+    int diff = 0;
+
+    switch (method)
+    {
+        case KnownPluginList::sortByCategory:
+            diff = a.category.compareNatural (b.category, false);
+            break;
+
+        case KnownPluginList::sortByManufacturer:
+            diff = a.manufacturerName.compareNatural (b.manufacturerName, false);
+            break;
+
+        case KnownPluginList::sortByFormat:
+            diff = a.pluginFormatName.compare (b.pluginFormatName);
+            break;
+
+        case KnownPluginList::sortByFileSystemLocation:
+            diff = a.fileOrIdentifier.upToLastOccurrenceOf ("/", false, false)
+                    .compare (b.fileOrIdentifier.upToLastOccurrenceOf ("/", false, false));
+            break;
+
+        case KnownPluginList::sortByInfoUpdateTime:
+            diff = a.lastInfoUpdateTime < b.lastInfoUpdateTime ? -1
+                 : (b.lastInfoUpdateTime < a.lastInfoUpdateTime ? 1 : 0);
+            break;
+
+        case KnownPluginList::sortAlphabetically:
+        case KnownPluginList::defaultOrder:
+        default:
+            break;
+    }
+
+    if (diff == 0)
+        diff = a.name.compareNatural (b.name, false);
+
+    return diff;
+}
+
+static void appendTrigrams (const String& text, StringArray& results)
+{
+    for (int i = 0; i + 3 <= text.length(); ++i)
+        results.addIfNotAlreadyThere (text.substring (i, i + 3));
+}
+
+static Array<int> intersectSorted (const Array<int>& a, const Array<int>& b)
+{
+    Array<int> result;
+    int i = 0, j = 0;
+
+    while (i < a.size() && j < b.size())
+    {
+        if (a.getUnchecked (i) < b.getUnchecked (j))       ++i;
+        else if (b.getUnchecked (j) < a.getUnchecked (i))  ++j;
+        else { result.add (a.getUnchecked (i)); ++i; ++j; }
+    }
+
+    return result;
+}
+
+//==============================================================================
+PluginCatalogue::PluginCatalogue (KnownPluginList& l)  : list (l)
+{
+    invalidate();
+}
+
+PluginCatalogue::~PluginCatalogue() {}
+
+void PluginCatalogue::invalidate()
+{
+    ++version;
+
+    for (int i = 0; i < numSortMethods; ++i)
+    {
+        sortedIndexesValid[i] = false;
+        menusValid[i] = false;
+    }
+
+    searchIndexValid = false;
+}
+
+//==============================================================================
+const Array<int>& PluginCatalogue::getSortedIndexes (KnownPluginList::SortMethod method) const
+{
+    auto m = jlimit (0, numSortMethods - 1, (int) method);
+    auto& indexes = sortedIndexes[m];
+
+    if (! sortedIndexesValid[m])
+    {
+        indexes.clearQuick();
+
+        for (int i = 0; i < list.getNumTypes(); ++i)
+            indexes.add (i);
+
+        if (method != KnownPluginList::defaultOrder)
+        {
+            std::stable_sort (indexes.begin(), indexes.end(), [this, method] (int a, int b)
+            {
+                return compareForSortMethod (*list.getType (a), *list.getType (b), method) < 0;
+            });
+        }
+
+        sortedIndexesValid[m] = true;
+    }
+
+    return indexes;
+}
+
+const PopupMenu& PluginCatalogue::getMenu (KnownPluginList::SortMethod method) const
+{
+    auto m = jlimit (0, numSortMethods - 1, (int) method);
+
+    if (! menusValid[m])
+    {
+        menus[m] = PopupMenu();
+        list.addToMenu (menus[m], method);
+        menusValid[m] = true;
+    }
+
+    return menus[m];
+}
+
+//==============================================================================
+void PluginCatalogue::buildSearchIndex() const
+{
+    searchText.clearQuick();
+    tokens.clearQuick();
+    trigrams.clear();
+
+    for (int i = 0; i < list.getNumTypes(); ++i)
+    {
+        auto* desc = list.getType (i);
+        auto text = (desc->name + " " + desc->manufacturerName + " " + desc->category).toLowerCase();
+        searchText.add (text);
+
+        auto words = StringArray::fromTokens (text, " \t-_/:|()", {});
+        words.removeEmptyStrings();
+        words.removeDuplicates (false);
+
+        StringArray textTrigrams;
+
+        for (auto& word : words)
+        {
+            tokens.add (Token { word, i });
+            appendTrigrams (word, textTrigrams);
+        }
+
+        // indexes are visited in ascending order, so each posting list stays sorted
+        for (auto& t : textTrigrams)
+            trigrams[t].add (i);
+    }
+
+    std::sort (tokens.begin(), tokens.end(), [] (const Token& a, const Token& b)
+    {
+        return a.text < b.text;
+    });
+
+    searchIndexValid = true;
+}
+
+Array<int> PluginCatalogue::findCandidates (const String& word) const
+{
+    Array<int> result;
+
+    if (word.length() < 3)
+    {
+        // a binary search for the first token with this prefix, then walk forward
+        auto first = std::lower_bound (tokens.begin(), tokens.end(), word, [] (const Token& t, const String& w)
+        {
+            return t.text < w;
+        });
+
+        for (auto* t = first; t != tokens.end() && t->text.startsWith (word); ++t)
+            result.add (t->index);
+
+        result.sort();
+        result.removeRange ((int) (std::unique (result.begin(), result.end()) - result.begin()), result.size());
+        return result;
+    }
+
+    StringArray wordTrigrams;
+    appendTrigrams (word, wordTrigrams);
+
+    bool first = true;
+
+    for (auto& t : wordTrigrams)
+    {
+        auto postings = trigrams.find (t);
+
+        if (postings == trigrams.end())
+            return {};
+
+        result = first ? postings->second : intersectSorted (result, postings->second);
+        first = false;
+
+        if (result.isEmpty())
+            return {};
+    }
+
+    // trigrams can match across word boundaries or out of order, so confirm the hit
+    for (int i = result.size(); --i >= 0;)
+        if (! searchText[result.getUnchecked (i)].contains (word))
+            result.remove (i);
+
+    return result;
+}
+
+Array<int> PluginCatalogue::search (const String& query, KnownPluginList::SortMethod method) const
+{
+    auto& ordered = getSortedIndexes (method);
+
+    auto words = StringArray::fromTokens (query.toLowerCase(), " \t", {});
+    words.removeEmptyStrings();
+
+    if (words.isEmpty())
+        return ordered;
+
+    if (! searchIndexValid)
+        buildSearchIndex();
+
+    Array<int> matches;
+
+    for (int i = 0; i < words.size(); ++i)
+    {
+        auto candidates = findCandidates (words[i]);
+        matches = (i == 0) ? candidates : intersectSorted (matches, candidates);
+
+        if (matches.isEmpty())
+            return {};
+    }
+
+    Array<int> result;
+    result.ensureStorageAllocated (matches.size());
+
+    for (auto index : ordered)
+        if (std::binary_search (matches.begin(), matches.end(), index))
+            result.add (index);
+
+    return result;
+}
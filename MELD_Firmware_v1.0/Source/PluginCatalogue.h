@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <map>
+
+
+//==============================================================================
+/**
+    A read-side view of a KnownPluginList that keeps its sorted orders, menus and
+    a search index around between uses.
+
+    Everything is built lazily the first time it's asked for and thrown away by
+    invalidate(), which the owner calls whenever the list broadcasts a change.
+    It's only meant to be used from the message thread.
+*/
+class PluginCatalogue
+{
+public:
+    PluginCatalogue (KnownPluginList&);
+    ~PluginCatalogue();
+
+    //==============================================================================
+    void invalidate();
+
+    /** Goes up on every invalidate(), so anything holding indexes or menu item IDs from
+        an earlier version can tell they might be stale.
+    */
+    int getVersion() const noexcept                 { return version; }
+
+    /** The list's indexes, in the given order. */
+    const Array<int>& getSortedIndexes (KnownPluginList::SortMethod) const;
+
+    /** The same menu KnownPluginList::addToMenu would build, so its item IDs still
+        work with KnownPluginList::getIndexChosenByMenu().
+    */
+    const PopupMenu& getMenu (KnownPluginList::SortMethod) const;
+
+    /** Returns the indexes of the plugins whose name, manufacturer or category
+        contain every word of the query, in the given order.
+
+        Words shorter than three characters match the start of a word, longer
+        ones match anywhere.
+    */
+    Array<int> search (const String& query, KnownPluginList::SortMethod) const;
+
+    KnownPluginList& getList() const noexcept       { return list; }
+
+private:
+    //==============================================================================
+    enum { numSortMethods = KnownPluginList::sortByInfoUpdateTime + 1 };
+
+    struct Token
+    {
+        String text;
+        int index;
+    };
+
+    KnownPluginList& list;
+    int version = 0;
+
+    mutable Array<int> sortedIndexes[numSortMethods];
+    mutable bool sortedIndexesValid[numSortMethods];
+    mutable PopupMenu menus[numSortMethods];
+    mutable bool menusValid[numSortMethods];
+
+    mutable bool searchIndexValid = false;
+    mutable StringArray searchText;
+    mutable Array<Token> tokens;
+    mutable std::map<String, Array<int>> trigrams;
+
+    void buildSearchIndex() const;
+    Array<int> findCandidates (const String& word) const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PluginCatalogue)
+};
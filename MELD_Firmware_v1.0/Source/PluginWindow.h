@@ -27,6 +27,7 @@
 #pragma once
 
 #include "FilterIOConfiguration.h"
+#include "ProgramNameLoader.h"
 class FilterGraph;
 
 //==============================================================================
@@ -132,36 +133,36 @@ private:
     }
 
     //==============================================================================
-    struct ProgramAudioProcessorEditor  : public AudioProcessorEditor
+    struct ProgramAudioProcessorEditor  : public AudioProcessorEditor,
+                                          private ListBoxModel,
+                                          private AudioProcessorListener,
+                                          private AsyncUpdater
     {
-        ProgramAudioProcessorEditor (AudioProcessor& p)  : AudioProcessorEditor (p)
+        ProgramAudioProcessorEditor (AudioProcessor& p)
+            : AudioProcessorEditor (p),
+              loader (p, [this] { list.updateContent(); list.repaint(); })
         {
             setOpaque (true);
-            
-            addAndMakeVisible (panel);
 
-            Array<PropertyComponent*> programs;
+            list.setModel (this);
+            list.setRowHeight (rowHeight);
+            list.setColour (ListBox::backgroundColourId, Colours::grey);
+            addAndMakeVisible (list);
 
-            auto numPrograms = p.getNumPrograms();
-            int totalHeight = 0;
+            // names are only fetched for the rows that get painted, so this is cheap
+            // no matter how many programs the plugin has
+            list.updateContent();
+            list.selectRow (p.getCurrentProgram());
 
-            for (int i = 0; i < numPrograms; ++i)
-            {
-                auto name = p.getProgramName (i).trim();
+            p.addListener (this);
 
-                if (name.isEmpty())
-                    name = "Unnamed";
-
-                auto pc = new PropertyComp (name, p);
-                programs.add (pc);
-                totalHeight += pc->getPreferredHeight();
-            }
+            setSize (400, jlimit (25, 400, loader.getNumPrograms() * rowHeight));
+        }
 
-            panel.addProperties (programs);
-            
-            
-            //setSize (400, jlimit (25, 400, totalHeight)); //change this for fullscreen
-            
+        ~ProgramAudioProcessorEditor()
+        {
+            processor.removeListener (this);
+            list.setModel (nullptr);
         }
 
         void paint (Graphics& g) override
@@ -169,35 +170,58 @@ private:
             g.fillAll (Colours::grey);
         }
 
-       /* void resized() override
+        void resized() override
         {
-            panel.setBounds (getLocalBounds());
-        }*/
+            list.setBounds (getLocalBounds());
+        }
 
     private:
-        struct PropertyComp  : public PropertyComponent,
-                               private AudioProcessorListener
+        int getNumRows() override
         {
-            PropertyComp (const String& name, AudioProcessor& p)  : PropertyComponent (name), owner (p)
-            {
-                owner.addListener (this);
-            }
+            return loader.getNumPrograms();
+        }
 
-            ~PropertyComp()
-            {
-                owner.removeListener (this);
-            }
+        void paintListBoxItem (int row, Graphics& g, int width, int height, bool isSelected) override
+        {
+            if (isSelected)
+                g.fillAll (findColour (TextEditor::highlightColourId));
+
+            // a stale name stays up until its page has been fetched again
+            if (! loader.isLoaded (row))
+                loader.prefetch ({ row, row + 1 });
 
-            void refresh() override {}
-            void audioProcessorChanged (AudioProcessor*) override {}
-            void audioProcessorParameterChanged (AudioProcessor*, int, float) override {}
+            auto name = loader.getProgramName (row);
 
-            AudioProcessor& owner;
+            if (name.isEmpty())
+                name = loader.isLoaded (row) ? "Unnamed" : "...";
+
+            g.setColour (Colours::black);
+            g.setFont (height * 0.7f);
+            g.drawText (String (row + 1) + "  " + name, 5, 0, width - 10, height, Justification::centredLeft, true);
+        }
+
+        void selectedRowsChanged (int lastRowSelected) override
+        {
+            if (lastRowSelected >= 0 && lastRowSelected != processor.getCurrentProgram())
+                processor.setCurrentProgram (lastRowSelected);
+        }
+
+        // may arrive on any thread, so the selection is synced from the message thread
+        void audioProcessorChanged (AudioProcessor*) override                       { triggerAsyncUpdate(); }
+        void audioProcessorParameterChanged (AudioProcessor*, int, float) override  {}
+
+        void handleAsyncUpdate() override
+        {
+            auto current = processor.getCurrentProgram();
+
+            if (current != list.getSelectedRow())
+                list.selectRow (current);
+        }
 
-            JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PropertyComp)
-        };
+        enum { rowHeight = 22 };
 
-        PropertyPanel panel;
+        ListBox list;
+        ProgramNameLoader loader;
 
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ProgramAudioProcessorEditor)
     };
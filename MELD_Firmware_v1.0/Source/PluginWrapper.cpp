@@ -0,0 +1,118 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "PluginWrapper.h"
+
+
+//==============================================================================
+PluginWrapper::PluginWrapper (AudioPluginInstance* pluginToWrap)
+    : AudioPluginInstance (getBusesPropertiesFor (*pluginToWrap)),
+      plugin (pluginToWrap)
+{
+    plugin->addListener (this);
+    setLatencySamples (plugin->getLatencySamples());
+}
+
+PluginWrapper::~PluginWrapper()
+{
+    plugin->removeListener (this);
+}
+
+AudioProcessor::BusesProperties PluginWrapper::getBusesPropertiesFor (AudioPluginInstance& p)
+{
+    BusesProperties props;
+
+    for (int dir = 0; dir < 2; ++dir)
+    {
+        auto isInput = (dir == 0);
+
+        for (int i = 0; i < p.getBusCount (isInput); ++i)
+            if (auto* bus = p.getBus (isInput, i))
+                props.addBus (isInput, bus->getName(), bus->getLastEnabledLayout(), bus->isEnabled());
+    }
+
+    return props;
+}
+
+//==============================================================================
+void PluginWrapper::prepareWrappedPlugin (double sampleRate, int maximumExpectedSamplesPerBlock)
+{
+    plugin->setProcessingPrecision (getProcessingPrecision());
+    plugin->setRateAndBufferSizeDetails (sampleRate, maximumExpectedSamplesPerBlock);
+    plugin->prepareToPlay (sampleRate, maximumExpectedSamplesPerBlock);
+}
+
+void PluginWrapper::updateLatency()
+{
+    setLatencySamples (plugin->getLatencySamples());
+}
+
+void PluginWrapper::setNonRealtime (bool isNonRealtime) noexcept
+{
+    AudioPluginInstance::setNonRealtime (isNonRealtime);
+    plugin->setNonRealtime (isNonRealtime);
+}
+
+void PluginWrapper::setPlayHead (AudioPlayHead* newPlayHead)
+{
+    AudioPluginInstance::setPlayHead (newPlayHead);
+    plugin->setPlayHead (newPlayHead);
+}
+
+//==============================================================================
+bool PluginWrapper::canApplyBusesLayout (const BusesLayout& layout) const
+{
+    return plugin->checkBusesLayoutSupported (layout);
+}
+
+void PluginWrapper::processorLayoutsChanged()
+{
+    plugin->setBusesLayout (getBusesLayout());
+}
+
+//==============================================================================
+void PluginWrapper::audioProcessorParameterChanged (AudioProcessor*, int index, float newValue)
+{
+    sendParamChangeMessageToListeners (index, newValue);
+}
+
+void PluginWrapper::audioProcessorChanged (AudioProcessor*)
+{
+    updateLatency();
+    updateHostDisplay();
+}
+
+void PluginWrapper::audioProcessorParameterChangeGestureBegin (AudioProcessor*, int index)
+{
+    beginParameterChangeGesture (index);
+}
+
+void PluginWrapper::audioProcessorParameterChangeGestureEnd (AudioProcessor*, int index)
+{
+    endParameterChangeGesture (index);
+}
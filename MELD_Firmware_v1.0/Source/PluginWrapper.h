@@ -0,0 +1,112 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+
+#pragma once
+
+
+//==============================================================================
+/**
+    The base for plugins that wrap another one to change how it's run.
+
+    Everything apart from the audio is passed straight through to the wrapped
+    plugin: its description, parameters, programs, state, editor, bus layouts and
+    the listener callbacks, so a saved session only ever sees the plugin itself.
+    Subclasses supply processBlock(), and override updateLatency() if they add
+    any delay of their own.
+*/
+class PluginWrapper  : public AudioPluginInstance,
+                       private AudioProcessorListener
+{
+public:
+    PluginWrapper (AudioPluginInstance* pluginToWrap);
+    ~PluginWrapper();
+
+    AudioPluginInstance& getWrappedPlugin() const noexcept  { return *plugin; }
+
+    //==============================================================================
+    void fillInPluginDescription (PluginDescription& d) const override  { plugin->fillInPluginDescription (d); }
+    void* getPlatformSpecificData() override            { return plugin->getPlatformSpecificData(); }
+
+    const String getName() const override               { return plugin->getName(); }
+    void releaseResources() override                    { plugin->releaseResources(); }
+    void reset() override                               { plugin->reset(); }
+    void setNonRealtime (bool) noexcept override;
+    void setPlayHead (AudioPlayHead*) override;
+
+    double getTailLengthSeconds() const override        { return plugin->getTailLengthSeconds(); }
+    bool acceptsMidi() const override                   { return plugin->acceptsMidi(); }
+    bool producesMidi() const override                  { return plugin->producesMidi(); }
+    AudioProcessorEditor* createEditor() override       { return plugin->createEditorIfNeeded(); }
+    bool hasEditor() const override                     { return plugin->hasEditor(); }
+
+    //==============================================================================
+    int getNumParameters() override                             { return plugin->getNumParameters(); }
+    const String getParameterName (int i) override              { return plugin->getParameterName (i); }
+    float getParameter (int i) override                         { return plugin->getParameter (i); }
+    void setParameter (int i, float v) override                 { plugin->setParameter (i, v); }
+    const String getParameterText (int i) override              { return plugin->getParameterText (i); }
+    String getParameterLabel (int i) const override             { return plugin->getParameterLabel (i); }
+    int getParameterNumSteps (int i) override                   { return plugin->getParameterNumSteps (i); }
+    float getParameterDefaultValue (int i) override             { return plugin->getParameterDefaultValue (i); }
+    bool isParameterAutomatable (int i) const override          { return plugin->isParameterAutomatable (i); }
+
+    //==============================================================================
+    int getNumPrograms() override                               { return plugin->getNumPrograms(); }
+    int getCurrentProgram() override                            { return plugin->getCurrentProgram(); }
+    void setCurrentProgram (int i) override                     { plugin->setCurrentProgram (i); }
+    const String getProgramName (int i) override                { return plugin->getProgramName (i); }
+    void changeProgramName (int i, const String& name) override { plugin->changeProgramName (i, name); }
+
+    void getStateInformation (MemoryBlock& m) override          { plugin->getStateInformation (m); }
+    void setStateInformation (const void* d, int size) override { plugin->setStateInformation (d, size); }
+    void getCurrentProgramStateInformation (MemoryBlock& m) override           { plugin->getCurrentProgramStateInformation (m); }
+    void setCurrentProgramStateInformation (const void* d, int size) override  { plugin->setCurrentProgramStateInformation (d, size); }
+
+protected:
+    //==============================================================================
+    ScopedPointer<AudioPluginInstance> plugin;
+
+    /** Prepares the wrapped plugin at the wrapper's precision, at whatever rate it's run at. */
+    void prepareWrappedPlugin (double sampleRate, int maximumExpectedSamplesPerBlock);
+
+    /** Called whenever the wrapped plugin changes. By default this just copies its latency. */
+    virtual void updateLatency();
+
+private:
+    //==============================================================================
+    static BusesProperties getBusesPropertiesFor (AudioPluginInstance&);
+
+    bool canApplyBusesLayout (const BusesLayout&) const override;
+    void processorLayoutsChanged() override;
+
+    void audioProcessorParameterChanged (AudioProcessor*, int, float) override;
+    void audioProcessorChanged (AudioProcessor*) override;
+    void audioProcessorParameterChangeGestureBegin (AudioProcessor*, int) override;
+    void audioProcessorParameterChangeGestureEnd (AudioProcessor*, int) override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PluginWrapper)
+};
@@ -0,0 +1,218 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "PolyphaseResampler.h"
+
+
+//==============================================================================
+static double besselI0 (double x) noexcept
+{
+    double sum = 1.0, term = 1.0;
+
+    for (int k = 1; k < 64; ++k)
+    {
+        auto t = x / (2.0 * k);
+        term *= t * t;
+        sum += term;
+
+        if (term < sum * 1.0e-12)
+            break;
+    }
+
+    return sum;
+}
+
+static int roundUpToMultiple (int value, int multiple) noexcept
+{
+    return ((value + multiple - 1) / multiple) * multiple;
+}
+
+//==============================================================================
+PolyphaseResampler::PolyphaseResampler() {}
+PolyphaseResampler::~PolyphaseResampler() {}
+
+void PolyphaseResampler::prepare (double inputRate, double outputRate, int newNumChannels)
+{
+    numChannels = newNumChannels;
+    step = inputRate / outputRate;
+    bypassed = (inputRate == outputRate);
+
+    if (bypassed)
+    {
+        numTaps = 0;
+        return;
+    }
+
+    // the cutoff sits below whichever Nyquist is lower, and the kernel widens to match it
+    auto bandwidth = jmin (1.0, outputRate / inputRate);
+    auto cutoff = 0.9 * bandwidth;
+    numTaps = roundUpToMultiple ((int) std::ceil (baseTaps / bandwidth), jmax (2, (int) lanes));
+
+    const double beta = 9.0;
+    auto halfWidth = numTaps / 2.0;
+    auto windowScale = 1.0 / besselI0 (beta);
+
+    coefficientStorage.calloc ((size_t) ((numPhases + 1) * numTaps + lanes));
+    coefficients = Vec::getNextSIMDAlignedPtr (coefficientStorage.get());
+
+    for (int p = 0; p <= numPhases; ++p)
+    {
+        auto* row = coefficients + p * numTaps;
+        auto fraction = p / (double) numPhases;
+        double sum = 0;
+
+        for (int j = 0; j < numTaps; ++j)
+        {
+            // the distance from this tap to the output point, in input frames
+            auto t = halfWidth - 1.0 - j - fraction;
+            auto x = t / halfWidth;
+            double value = 0;
+
+            if (std::abs (x) < 1.0)
+            {
+                auto arg = double_Pi * cutoff * t;
+                auto sinc = std::abs (arg) < 1.0e-9 ? 1.0 : std::sin (arg) / arg;
+                value = cutoff * sinc * besselI0 (beta * std::sqrt (1.0 - x * x)) * windowScale;
+            }
+
+            row[j] = (float) value;
+            sum += value;
+        }
+
+        // every phase passes DC at exactly unity gain
+        if (sum != 0)
+            for (int j = 0; j < numTaps; ++j)
+                row[j] = (float) (row[j] / sum);
+    }
+
+    historySize = roundUpToMultiple (2 * numTaps + lanes, lanes);
+    historyStorage.calloc ((size_t) (numChannels * lanes * historySize + lanes));
+    history = Vec::getNextSIMDAlignedPtr (historyStorage.get());
+
+    reset();
+}
+
+void PolyphaseResampler::reset() noexcept
+{
+    if (history != nullptr)
+        FloatVectorOperations::clear (history, numChannels * lanes * historySize);
+
+    writePos = 0;
+    pending = -1.0;
+}
+
+//==============================================================================
+void PolyphaseResampler::push (const float* const* input, int index) noexcept
+{
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        auto x = input[ch][index];
+
+        for (int copy = 0; copy < lanes; ++copy)
+        {
+            auto* h = getHistory (ch, copy);
+            h[writePos + copy] = x;
+            h[writePos + numTaps + copy] = x;
+        }
+    }
+
+    if (++writePos == numTaps)
+        writePos = 0;
+}
+
+float PolyphaseResampler::compute (int channel, double fraction) const noexcept
+{
+    // the copy shifted by this much puts the oldest sample in the window on a SIMD boundary
+    auto copy = (lanes - writePos % lanes) % lanes;
+    auto* x = getHistory (channel, copy) + writePos + copy;
+
+    auto position = fraction * numPhases;
+    auto phase = jmin ((int) position, (int) numPhases - 1);
+    auto* c0 = coefficients + phase * numTaps;
+    auto* c1 = c0 + numTaps;
+
+    auto sum0 = Vec::expand (0.0f);
+    auto sum1 = Vec::expand (0.0f);
+
+    for (int i = 0; i < numTaps; i += lanes)
+    {
+        auto v = Vec::fromRawArray (x + i);
+        sum0 = Vec::multiplyAdd (sum0, v, Vec::fromRawArray (c0 + i));
+        sum1 = Vec::multiplyAdd (sum1, v, Vec::fromRawArray (c1 + i));
+    }
+
+    auto a = sum0.sum();
+    auto b = sum1.sum();
+    return a + (float) (position - phase) * (b - a);
+}
+
+int PolyphaseResampler::process (const float* const* input, int numInput, float* const* output, int maxOutput,
+                                 int& numConsumed) noexcept
+{
+    if (bypassed)
+    {
+        auto num = jmin (numInput, maxOutput);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            FloatVectorOperations::copy (output[ch], input[ch], num);
+
+        numConsumed = num;
+        return num;
+    }
+
+    int produced = 0;
+    numConsumed = 0;
+
+    for (;;)
+    {
+        while (pending >= 0 && produced < maxOutput)
+        {
+            for (int ch = 0; ch < numChannels; ++ch)
+                output[ch][produced] = compute (ch, pending);
+
+            ++produced;
+            pending -= step;
+        }
+
+        if (produced == maxOutput || numConsumed == numInput)
+            break;
+
+        push (input, numConsumed++);
+        pending += 1.0;
+    }
+
+    return produced;
+}
+
+int PolyphaseResampler::getNumInputsNeeded (int numOutput) const noexcept
+{
+    if (bypassed)
+        return numOutput;
+
+    // errs on the high side, since anything left over simply waits for the next call
+    return jmax (0, (int) std::ceil ((numOutput - 1) * step - pending + 1.0e-9));
+}
@@ -0,0 +1,91 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+
+//==============================================================================
+/**
+    A windowed-sinc resampler for streams at any pair of fixed rates.
+
+    The kernel is tabulated at numPhases fractional positions, and each output is
+    interpolated between the two nearest phases. Its length grows as the rate goes
+    down, so decimation keeps the same transition band as interpolation does.
+
+    The dot products run on dsp::SIMDRegister with aligned loads. To make every
+    window start on a SIMD boundary, each channel's history is kept in one shifted
+    copy per SIMD lane, and the window is read from whichever copy lines up.
+*/
+class PolyphaseResampler
+{
+public:
+    PolyphaseResampler();
+    ~PolyphaseResampler();
+
+    enum
+    {
+        numPhases       = 256,
+        baseTaps        = 64
+    };
+
+    /** Builds the tables. This allocates, so call it before the audio starts. */
+    void prepare (double inputRate, double outputRate, int numChannels);
+    void reset() noexcept;
+
+    /** Pushes up to numInput frames through, and stops early once maxOutput frames
+        have been written. Returns the number of output frames, and sets numConsumed
+        to the number of input frames used.
+    */
+    int process (const float* const* input, int numInput, float* const* output, int maxOutput,
+                 int& numConsumed) noexcept;
+
+    /** The number of input frames that have to be pushed before numOutput frames are ready. */
+    int getNumInputsNeeded (int numOutput) const noexcept;
+
+    /** The delay the filter adds, in input frames. */
+    int getLatencyInInputFrames() const noexcept            { return numTaps / 2; }
+
+    bool isBypassed() const noexcept                        { return bypassed; }
+
+private:
+    //==============================================================================
+    typedef dsp::SIMDRegister<float> Vec;
+    enum { lanes = (int) Vec::SIMDNumElements };
+
+    int numChannels = 0, numTaps = 0, historySize = 0, writePos = 0;
+    double step = 1.0, pending = -1.0;
+    bool bypassed = true;
+
+    HeapBlock<float> coefficientStorage, historyStorage;
+    float* coefficients = nullptr;
+    float* history = nullptr;
+
+    float* getHistory (int channel, int copy) const noexcept    { return history + (channel * lanes + copy) * historySize; }
+    void push (const float* const* input, int index) noexcept;
+    float compute (int channel, double fraction) const noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PolyphaseResampler)
+};
@@ -0,0 +1,144 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "ProgramNameLoader.h"
+
+
+//==============================================================================
+ProgramNameLoader::ProgramNameLoader (AudioProcessor& p, std::function<void()> callback)
+    : processor (p), onNamesChanged (callback)
+{
+    invalidate();
+    processor.addListener (this);
+}
+
+ProgramNameLoader::~ProgramNameLoader()
+{
+    processor.removeListener (this);
+    cancelPendingUpdate();
+}
+
+//==============================================================================
+bool ProgramNameLoader::isLoaded (int index) const
+{
+    return isPositiveAndBelow (index, numPrograms) && loadedPages[index / pageSize];
+}
+
+String ProgramNameLoader::getProgramName (int index) const
+{
+    return names[index];
+}
+
+void ProgramNameLoader::prefetch (Range<int> indexes)
+{
+    indexes = indexes.getIntersectionWith ({ 0, numPrograms });
+
+    if (indexes.isEmpty())
+        return;
+
+    // the most recently requested pages are the ones on screen, so they jump the queue
+    for (int page = (indexes.getEnd() - 1) / pageSize; page >= indexes.getStart() / pageSize; --page)
+    {
+        if (! loadedPages[page] && pendingPages.indexOf (page) != 0)
+        {
+            pendingPages.removeFirstMatchingValue (page);
+            pendingPages.insert (0, page);
+            nextIndexInPage = 0;
+        }
+    }
+
+    if (! pendingPages.isEmpty() && ! isTimerRunning())
+        startTimer (10);
+}
+
+//==============================================================================
+void ProgramNameLoader::invalidate()
+{
+    auto newNumPrograms = jmax (0, processor.getNumPrograms());
+
+    // a different bank can have a different number of programs, so the old names go
+    if (newNumPrograms != numPrograms)
+    {
+        numPrograms = newNumPrograms;
+        names.clear();
+        names.ensureStorageAllocated (numPrograms);
+
+        for (int i = 0; i < numPrograms; ++i)
+            names.add ({});
+    }
+
+    loadedPages.clearQuick();
+    loadedPages.insertMultiple (0, false, (numPrograms + pageSize - 1) / pageSize);
+    pendingPages.clearQuick();
+    nextIndexInPage = 0;
+    stopTimer();
+}
+
+void ProgramNameLoader::timerCallback()
+{
+    // a slice of names at a time, so a plugin that's slow to answer can't stall the UI
+    auto deadline = Time::getMillisecondCounterHiRes() + 2.0;
+    bool fetchedAny = false;
+
+    while (! pendingPages.isEmpty() && Time::getMillisecondCounterHiRes() < deadline)
+    {
+        auto page = pendingPages.getFirst();
+        auto index = page * pageSize + nextIndexInPage;
+
+        if (loadedPages[page] || index >= numPrograms)
+        {
+            loadedPages.set (page, true);
+            pendingPages.remove (0);
+            nextIndexInPage = 0;
+            continue;
+        }
+
+        names.set (index, processor.getProgramName (index).trim());
+        fetchedAny = true;
+
+        if (++nextIndexInPage >= pageSize)
+        {
+            loadedPages.set (page, true);
+            pendingPages.remove (0);
+            nextIndexInPage = 0;
+        }
+    }
+
+    if (pendingPages.isEmpty())
+        stopTimer();
+
+    if (fetchedAny && onNamesChanged != nullptr)
+        onNamesChanged();
+}
+
+void ProgramNameLoader::handleAsyncUpdate()
+{
+    invalidate();
+
+    if (onNamesChanged != nullptr)
+        onNamesChanged();
+}
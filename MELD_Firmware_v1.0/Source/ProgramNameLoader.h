@@ -0,0 +1,85 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+
+//==============================================================================
+/**
+    Fetches a processor's program names a page at a time, on the message thread.
+
+    Hosted plugins don't promise that getProgramName() is safe to call from any
+    other thread, so the names are fetched from a timer in small slices that each
+    stop after a couple of milliseconds, keeping the UI responsive however many
+    presets there are. Only the pages that have been asked for are fetched.
+
+    The names are cached for this instance only, and the cache is invalidated
+    whenever the processor reports a change, since that's how a plugin says it has
+    loaded a new bank. Names already fetched are kept on screen until their page
+    has been fetched again.
+*/
+class ProgramNameLoader  : private Timer,
+                           private AsyncUpdater,
+                           private AudioProcessorListener
+{
+public:
+    ProgramNameLoader (AudioProcessor&, std::function<void()> onNamesChanged);
+    ~ProgramNameLoader();
+
+    //==============================================================================
+    int getNumPrograms() const noexcept         { return numPrograms; }
+
+    /** Returns true if the name for this index is up to date. */
+    bool isLoaded (int index) const;
+
+    /** Returns the last name fetched for this index, or an empty string if there isn't one yet. */
+    String getProgramName (int index) const;
+
+    /** Queues the pages covering these indexes, unless they're already up to date. */
+    void prefetch (Range<int> indexes);
+
+    enum { pageSize = 64 };
+
+private:
+    //==============================================================================
+    AudioProcessor& processor;
+    std::function<void()> onNamesChanged;
+    int numPrograms = 0;
+
+    StringArray names;
+    Array<bool> loadedPages;
+    Array<int> pendingPages;
+    int nextIndexInPage = 0;
+
+    void invalidate();
+    void timerCallback() override;
+    void handleAsyncUpdate() override;
+
+    void audioProcessorChanged (AudioProcessor*) override                       { triggerAsyncUpdate(); }
+    void audioProcessorParameterChanged (AudioProcessor*, int, float) override  {}
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ProgramNameLoader)
+};
@@ -0,0 +1,253 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "MainHostWindow.h"
+#include "InternalFilters.h"
+#include "OfflineRenderer.h"
+#include "InputCapture.h"
+#include "SerialController.h"
+#include "ToolSupport.h"
+#include <iostream>
+
+/*
+    A command-line build of the host's graph, for rendering and benchmarking
+    sessions without a sound card or a window:
+
+        MeldRender session.filtergraph input.mid output.wav [--rate 48000] [--block 256]
+                   [--tail 2] [--double] [--bits 24] [--no-node-timing] [--controller-channel 16]
+
+    An input capture can stand in for the MIDI file. Its starting graph replaces the
+    session's, and its graph edits are made between blocks at the times they were
+    captured, so a glitch from a live set can be rendered again under a profiler.
+    The controller board's moves become the same MIDI controllers they were live, on
+    the given channel, at the sample they were captured at. Slot presses only move
+    the editor's focus live, so there's nothing of them to render.
+*/
+
+//==============================================================================
+static void printUsage()
+{
+    std::cerr << "usage: MeldRender session.filtergraph (input.mid | capture.meldcap) output.wav" << std::endl
+              << "         [--rate 48000] [--block 256] [--tail 2] [--double] [--bits 24] [--no-node-timing]" << std::endl
+              << "         [--controller-channel 16]" << std::endl;
+}
+
+static int fail (const String& message)
+{
+    std::cerr << "MeldRender: " << message << std::endl;
+    return 1;
+}
+
+static String formatMicroseconds (double seconds)
+{
+    return String (seconds * 1.0e6, 1) + " us";
+}
+
+/** Adds the capture's controller moves to the sequence as the messages the board's would have sent. */
+static void addControllerMessages (const CaptureFile& capture, int midiChannel, MidiMessageSequence& sequence)
+{
+    ControllerMidiConverter converter;
+    converter.setMidiChannel (midiChannel);
+
+    MidiMessage m;
+
+    for (auto& e : capture.events)
+        if (e.type == CapturedEvent::controllerMoved)
+            if (converter.createMessage (ControllerEvent::fromControllerIndex (e.index, roundToInt (e.value)), m))
+                sequence.addEvent (m, e.time);
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    StringArray args;
+
+    for (int i = 1; i < argc; ++i)
+        args.add (argv[i]);
+
+    OfflineRenderer::Settings settings;
+    settings.sampleRate = 48000.0;
+    settings.blockSize = 256;
+    int bitsPerSample = 24, controllerChannel = 16;
+    bool timeNodes = true;
+    StringArray files;
+
+    for (int i = 0; i < args.size(); ++i)
+    {
+        auto& arg = args[i];
+
+        if (arg == "--rate")                    settings.sampleRate = args[++i].getDoubleValue();
+        else if (arg == "--block")              settings.blockSize = args[++i].getIntValue();
+        else if (arg == "--tail")               settings.tailSeconds = args[++i].getDoubleValue();
+        else if (arg == "--bits")               bitsPerSample = args[++i].getIntValue();
+        else if (arg == "--double")             settings.doublePrecision = true;
+        else if (arg == "--no-node-timing")     timeNodes = false;
+        else if (arg == "--controller-channel") controllerChannel = args[++i].getIntValue();
+        else if (arg.startsWith ("--"))         return fail ("unknown option " + arg);
+        else                                    files.add (arg);
+    }
+
+    if (files.size() != 3 || settings.sampleRate <= 0 || settings.blockSize <= 0
+         || controllerChannel < 1 || controllerChannel > 16)
+    {
+        printUsage();
+        return 1;
+    }
+
+    ScopedJuceInitialiser_GUI juceInitialiser;
+    ToolEnvironment environment ("MELD Render");
+
+    auto sessionFile = File::getCurrentWorkingDirectory().getChildFile (files[0]);
+    auto midiFile    = File::getCurrentWorkingDirectory().getChildFile (files[1]);
+    auto outputFile  = File::getCurrentWorkingDirectory().getChildFile (files[2]);
+
+    MidiMessageSequence sequence;
+    CaptureFile capture;
+    String error;
+
+    if (midiFile.hasFileExtension (CaptureFile::getFilenameSuffix()))
+    {
+        auto result = capture.load (midiFile);
+
+        if (result.failed())
+            return fail (result.getErrorMessage());
+
+        sequence = capture.getMidiSequence();
+        addControllerMessages (capture, controllerChannel, sequence);
+    }
+    else if (! OfflineRenderer::loadMidiFile (midiFile, sequence, error))
+    {
+        return fail (error);
+    }
+
+    ScopedPointer<XmlElement> xml (XmlDocument::parse (sessionFile));
+
+    if (xml == nullptr || ! xml->hasTagName ("FILTERGRAPH"))
+        return fail (sessionFile.getFullPathName() + " isn't a filter graph");
+
+    if (capture.initialGraphXml.isNotEmpty())
+    {
+        xml = XmlDocument::parse (capture.initialGraphXml);
+
+        if (xml == nullptr)
+            return fail (midiFile.getFileName() + " has a damaged graph in it");
+    }
+
+    removeOpenWindows (*xml);
+
+    AudioPluginFormatManager formatManager;
+    formatManager.addDefaultFormats();
+    formatManager.addFormat (new InternalPluginFormat());
+
+    {
+        FilterGraph filterGraph (formatManager);
+        filterGraph.restoreFromXml (*xml);
+        filterGraph.flushPendingChanges();
+
+        int nextEvent = 0;
+
+        settings.beforeBlock = [&] (int64 position)
+        {
+            bool edited = false;
+
+            for (; nextEvent < capture.events.size(); ++nextEvent)
+            {
+                auto& e = capture.events.getReference (nextEvent);
+
+                if ((int64) (e.time * settings.sampleRate) > position)
+                    break;
+
+                if (e.type == CapturedEvent::graphEdited)
+                {
+                    if (ScopedPointer<XmlElement> edit = XmlDocument::parse (e.graphXml))
+                    {
+                        removeOpenWindows (*edit);
+                        filterGraph.updateFromXml (*edit);
+                        edited = true;
+                    }
+                }
+            }
+
+            // the graph rebuilds its render order from the message loop, so give it a turn
+            if (edited)
+            {
+                filterGraph.flushPendingChanges();
+                MessageManager::getInstance()->runDispatchLoopUntil (1);
+            }
+        };
+
+        outputFile.deleteFile();
+        ScopedPointer<FileOutputStream> out (outputFile.createOutputStream());
+
+        if (out == nullptr)
+            return fail ("couldn't write to " + outputFile.getFullPathName());
+
+        WavAudioFormat wav;
+        ScopedPointer<AudioFormatWriter> writer (wav.createWriterFor (out, settings.sampleRate, 2,
+                                                                      bitsPerSample, {}, 0));
+
+        if (writer == nullptr)
+            return fail ("can't write " + String (bitsPerSample) + "-bit WAV files");
+
+        out.release();
+
+        OfflineRenderer renderer (filterGraph.graph);
+        auto report = renderer.render (sequence, settings, writer);
+        writer = nullptr;
+
+        std::cout << "rendered " << String (report.getAudioSeconds(), 2) << " s of audio in "
+                  << String (report.renderSeconds, 3) << " s ("
+                  << String (report.getRealtimeFactor(), 1) << "x realtime)" << std::endl
+                  << "block of " << settings.blockSize << " at " << settings.sampleRate << " Hz"
+                  << (settings.doublePrecision ? ", double precision" : "")
+                  << ": median " << formatMicroseconds (report.getBlockPercentile (0.5))
+                  << ", p99 " << formatMicroseconds (report.getBlockPercentile (0.99))
+                  << ", max " << formatMicroseconds (report.getBlockPercentile (1.0))
+                  << ", budget " << formatMicroseconds (settings.blockSize / settings.sampleRate) << std::endl;
+
+        if (timeNodes)
+        {
+            auto budget = settings.blockSize / settings.sampleRate;
+
+            std::cout << std::endl << "per node, each run on its own:" << std::endl;
+
+            for (auto& t : renderer.timeNodes (sequence, settings))
+            {
+                auto mean = t.numBlocks > 0 ? t.totalSeconds / t.numBlocks : 0.0;
+
+                std::cout << "  " << String ((int) t.nodeID).paddedLeft (' ', 4) << "  "
+                          << t.name.paddedRight (' ', 28).substring (0, 28)
+                          << "  mean " << formatMicroseconds (mean).paddedLeft (' ', 10)
+                          << "  max " << formatMicroseconds (t.maxBlockSeconds).paddedLeft (' ', 10)
+                          << "  " << String (100.0 * mean / budget, 1) << "% of budget" << std::endl;
+            }
+        }
+    }
+
+    return 0;
+}
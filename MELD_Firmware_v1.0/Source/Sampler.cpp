@@ -0,0 +1,699 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "Sampler.h"
+
+
+//==============================================================================
+static int parseRootNote (const String& name)
+{
+    auto trimmed = name.trimEnd();
+    auto numberStart = trimmed.length();
+
+    while (numberStart > 0 && CharacterFunctions::isDigit (trimmed[numberStart - 1]))
+        --numberStart;
+
+    if (numberStart == trimmed.length())
+        return 60;
+
+    auto digits = trimmed.substring (numberStart).getIntValue();
+    auto hasMinus = numberStart > 0 && trimmed[numberStart - 1] == '-';
+    auto octave = hasMinus ? -digits : digits;
+    auto nameEnd = numberStart - (hasMinus ? 1 : 0);
+
+    // a bare number is a MIDI note, a note name and octave is e.g. C3 = 60
+    static const char* const names = "C D EF G A B";
+    auto accidental = 0;
+    auto letterPos = nameEnd - 1;
+
+    if (letterPos > 0 && (trimmed[letterPos] == '#' || trimmed[letterPos] == 'b'))
+    {
+        accidental = trimmed[letterPos] == '#' ? 1 : -1;
+        --letterPos;
+    }
+
+    if (letterPos >= 0)
+    {
+        auto letter = CharacterFunctions::toUpperCase (trimmed[letterPos]);
+        auto isStartOfWord = letterPos == 0 || ! CharacterFunctions::isLetter (trimmed[letterPos - 1]);
+
+        if (isStartOfWord && letter >= 'A' && letter <= 'G')
+        {
+            auto semitone = (int) (std::strchr (names, (char) letter) - names);
+            return jlimit (0, 127, (octave + 2) * 12 + semitone + accidental);
+        }
+    }
+
+    return jlimit (0, 127, digits);
+}
+
+//==============================================================================
+struct SamplerProcessor::Sample
+{
+    Sample (MemoryMappedAudioFormatReader* r, int root)
+        : reader (r),
+          rootNote (root),
+          length (r->lengthInSamples),
+          sampleRate (r->sampleRate),
+          numChannels (jlimit (1, 2, (int) r->numChannels))
+    {
+        attack.setSize (numChannels, (int) jmin ((int64) attackFrames, length));
+        reader->read (&attack, 0, attack.getNumSamples(), 0, true, true);
+    }
+
+    ScopedPointer<MemoryMappedAudioFormatReader> reader;
+    const int rootNote;
+    const int64 length;
+    const double sampleRate;
+    const int numChannels;
+    AudioBuffer<float> attack;
+
+    JUCE_DECLARE_NON_COPYABLE (Sample)
+};
+
+struct SamplerProcessor::Instrument
+{
+    Instrument()
+    {
+        for (auto& s : keyMap)
+            s = nullptr;
+    }
+
+    void buildKeyMap()
+    {
+        for (int key = 0; key < 128; ++key)
+        {
+            keyMap[key] = nullptr;
+
+            for (auto* s : samples)
+                if (keyMap[key] == nullptr || std::abs (s->rootNote - key) < std::abs (keyMap[key]->rootNote - key))
+                    keyMap[key] = s;
+        }
+    }
+
+    OwnedArray<Sample> samples;
+    const Sample* keyMap[128];
+    size_t residentBytes = 0;
+};
+
+//==============================================================================
+/**
+    One playing note. The sample, the stream state and the consumed position are
+    the only things the streaming thread looks at.
+
+    The stream state holds a generation count in its top 16 bits and the number
+    of frames buffered so far in the rest. Restarting or stopping the voice bumps
+    the generation, so a chunk the streamer read for an earlier note can never be
+    published for a later one.
+*/
+struct SamplerProcessor::Voice
+{
+    Voice()  : ring (2, ringFrames)
+    {
+        ring.clear();
+    }
+
+    static int64 getFrames (int64 state) noexcept       { return state & ((((int64) 1) << 48) - 1); }
+
+    bool isPlaying() const noexcept                     { return playing; }
+
+    void start (const Sample& s, int newNote, float velocityGain, double increment, uint32 newAge) noexcept
+    {
+        note = newNote;
+        age = newAge;
+        gain = velocityGain;
+        step = increment;
+        position = 0;
+        level = 1.0f;
+        releaseStep = 0;
+        keyDown = playing = true;
+
+        consumed.store (0);
+        sample.store (&s);
+        stream.store (nextStreamState (s.attack.getNumSamples()), std::memory_order_release);
+    }
+
+    void beginRelease (float stepPerSample) noexcept
+    {
+        keyDown = false;
+        releaseStep = jmax (releaseStep, stepPerSample);
+    }
+
+    void stop() noexcept
+    {
+        playing = keyDown = false;
+        sample.store (nullptr);
+        stream.store (nextStreamState (0), std::memory_order_release);
+    }
+
+    /** Adds the voice to the output, and returns false if any samples hadn't arrived yet. */
+    bool render (float* left, float* right, int num) noexcept
+    {
+        auto& s = *sample.load (std::memory_order_relaxed);
+        auto buffered = getFrames (stream.load (std::memory_order_acquire));
+        auto attackLength = (int64) s.attack.getNumSamples();
+        auto lastChannel = s.numChannels - 1;
+        bool complete = true;
+
+        auto frame = [&] (int64 index, int channel) noexcept -> float
+        {
+            if (index < attackLength)   return s.attack.getSample (jmin (channel, lastChannel), (int) index);
+            if (index >= s.length)      return 0.0f;
+            if (index >= buffered)      { complete = false; return 0.0f; }
+
+            return ring.getSample (channel, (int) (index % ringFrames));
+        };
+
+        for (int i = 0; i < num; ++i)
+        {
+            auto index = (int64) position;
+
+            if (index >= s.length || level <= 0)
+            {
+                stop();
+                return complete;
+            }
+
+            auto frac = (float) (position - (double) index);
+            auto g = gain * level;
+
+            for (int ch = 0; ch < 2; ++ch)
+            {
+                auto a = frame (index, ch);
+                auto b = frame (index + 1, ch);
+                (ch == 0 ? left : right)[i] += g * (a + frac * (b - a));
+            }
+
+            position += step;
+            level -= releaseStep;
+        }
+
+        consumed.store ((int64) position, std::memory_order_release);
+        return complete;
+    }
+
+    // shared with the streamer
+    std::atomic<const Sample*> sample { nullptr };
+    std::atomic<int64> stream { 0 };
+    std::atomic<int64> consumed { 0 };
+    AudioBuffer<float> ring;
+
+    // the audio thread's side
+    int note = -1;
+    uint32 age = 0;
+    bool keyDown = false;
+
+private:
+    // counted unsigned, so the shift just wraps through the top 16 bits however many notes play
+    uint64 generation = 0;
+
+    int64 nextStreamState (int64 frames) noexcept   { return (int64) ((++generation << 48) + (uint64) frames); }
+    double position = 0, step = 1.0;
+    float gain = 0, level = 0, releaseStep = 0;
+    bool playing = false;
+
+    JUCE_DECLARE_NON_COPYABLE (Voice)
+};
+
+//==============================================================================
+struct SamplerProcessor::Streamer  : public Thread
+{
+    Streamer (SamplerProcessor& p)  : Thread ("Sampler streaming"), owner (p)
+    {
+        scratch.setSize (2, chunkFrames);
+        startThread (7);
+    }
+
+    ~Streamer()
+    {
+        signalThreadShouldExit();
+        notify();
+        stopThread (4000);
+    }
+
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            // nothing can still be reading an instrument by the time it comes back round to here
+            delete owner.retiredInstrument.exchange (nullptr);
+
+            // this polls rather than being woken, so the audio thread never has to signal
+            // it; a voice's attack region covers far more than one wait
+            if (! fillNeediestVoice())
+                wait (pollMilliseconds);
+        }
+    }
+
+    bool fillNeediestVoice()
+    {
+        Voice* neediest = nullptr;
+        const Sample* sample = nullptr;
+        int64 state = 0, smallestLead = std::numeric_limits<int64>::max();
+
+        for (auto* v : owner.voices)
+        {
+            // the voice stores its sample before its state, so this can't pair a new state with an old sample
+            auto st = v->stream.load (std::memory_order_acquire);
+            auto* s = v->sample.load (std::memory_order_acquire);
+
+            if (s == nullptr)
+                continue;
+
+            auto buffered = Voice::getFrames (st);
+            auto consumed = v->consumed.load (std::memory_order_acquire);
+            auto wanted = jmin ((int64) chunkFrames, s->length - buffered);
+
+            if (wanted <= 0 || buffered + wanted > consumed + ringFrames)
+                continue;
+
+            if (buffered - consumed < smallestLead)
+            {
+                neediest = v;
+                sample = s;
+                state = st;
+                smallestLead = buffered - consumed;
+            }
+        }
+
+        if (neediest == nullptr)
+            return false;
+
+        auto start = Voice::getFrames (state);
+        auto num = (int) jmin ((int64) chunkFrames, sample->length - start);
+
+        sample->reader->read (&scratch, 0, num, start, true, true);
+
+        auto ringPos = (int) (start % ringFrames);
+        auto firstPart = jmin (num, ringFrames - ringPos);
+
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            neediest->ring.copyFrom (ch, ringPos, scratch, ch, 0, firstPart);
+
+            if (firstPart < num)
+                neediest->ring.copyFrom (ch, 0, scratch, ch, firstPart, num - firstPart);
+        }
+
+        // if the voice has moved on to another note since, this just fails and the chunk is dropped
+        neediest->stream.compare_exchange_strong (state, state + num, std::memory_order_release);
+        return true;
+    }
+
+    enum { pollMilliseconds = 2 };
+
+    SamplerProcessor& owner;
+    AudioBuffer<float> scratch;
+};
+
+//==============================================================================
+struct SamplerProcessor::Loader  : public Thread
+{
+    Loader (SamplerProcessor& p)  : Thread ("Sample loader"), owner (p)
+    {
+        startThread (3);
+    }
+
+    ~Loader()
+    {
+        signalThreadShouldExit();
+        notify();
+        stopThread (4000);
+    }
+
+    void load (const File& f)
+    {
+        {
+            const ScopedLock sl (lock);
+            folderToLoad = f;
+        }
+
+        notify();
+    }
+
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            File f;
+
+            {
+                const ScopedLock sl (lock);
+                std::swap (f, folderToLoad);
+            }
+
+            if (f.isDirectory())
+                read (f);
+
+            wait (-1);
+        }
+    }
+
+    void read (const File& dir)
+    {
+        ScopedPointer<Instrument> newInstrument (new Instrument());
+        WavAudioFormat wav;
+
+        Array<File> files;
+        dir.findChildFiles (files, File::findFiles, false, "*.wav");
+        files.sort();
+
+        for (auto& f : files)
+        {
+            if (threadShouldExit())
+                return;
+
+            ScopedPointer<MemoryMappedAudioFormatReader> reader (wav.createMemoryMappedReader (f));
+
+            if (reader == nullptr || reader->lengthInSamples <= 0 || reader->sampleRate <= 0
+                 || ! reader->mapEntireFile())
+                continue;
+
+            auto* s = newInstrument->samples.add (new Sample (reader.release(), parseRootNote (f.getFileNameWithoutExtension())));
+            newInstrument->residentBytes += (size_t) (s->attack.getNumChannels() * s->attack.getNumSamples()) * sizeof (float);
+        }
+
+        newInstrument->buildKeyMap();
+
+        {
+            const ScopedLock sl (owner.infoLock);
+            owner.folder = dir;
+            owner.numLoadedSamples = newInstrument->samples.size();
+            owner.residentBytes = newInstrument->residentBytes;
+        }
+
+        // one the audio thread hasn't picked up yet can simply be replaced
+        delete owner.pendingInstrument.exchange (newInstrument.release());
+    }
+
+    SamplerProcessor& owner;
+    CriticalSection lock;
+    File folderToLoad;
+};
+
+//==============================================================================
+struct SamplerProcessor::Editor  : public AudioProcessorEditor,
+                                   private Timer
+{
+    Editor (SamplerProcessor& p)  : AudioProcessorEditor (p), owner (p)
+    {
+        loadButton.setButtonText ("Load sample folder...");
+        loadButton.onClick = [this] { chooseFolder(); };
+        addAndMakeVisible (loadButton);
+        addAndMakeVisible (folderLabel);
+        addAndMakeVisible (statusLabel);
+
+        setSize (360, 100);
+        timerCallback();
+        startTimer (500);
+    }
+
+    void paint (Graphics& g) override
+    {
+        g.fillAll (getLookAndFeel().findColour (ResizableWindow::backgroundColourId));
+    }
+
+    void resized() override
+    {
+        auto area = getLocalBounds().reduced (8);
+        loadButton.setBounds (area.removeFromTop (28));
+        folderLabel.setBounds (area.removeFromTop (24));
+        statusLabel.setBounds (area.removeFromTop (24));
+    }
+
+    void timerCallback() override
+    {
+        auto dir = owner.getSampleFolder();
+
+        folderLabel.setText (dir == File() ? String ("No samples")
+                                           : dir.getFileName() + " (" + String (owner.getNumLoadedSamples()) + " samples)",
+                             dontSendNotification);
+
+        statusLabel.setText ("Resident: " + File::descriptionOfSizeInBytes ((int64) owner.getResidentBytes())
+                               + ", stream underruns: " + String (owner.getNumStreamUnderruns()),
+                             dontSendNotification);
+    }
+
+    void chooseFolder()
+    {
+        chooser = new FileChooser ("Choose a folder of samples", owner.getSampleFolder());
+
+        chooser->launchAsync (FileBrowserComponent::openMode | FileBrowserComponent::canSelectDirectories,
+                              [this] (const FileChooser& fc)
+                              {
+                                  if (fc.getResult().isDirectory())
+                                      owner.loadSampleFolder (fc.getResult());
+                              });
+    }
+
+    SamplerProcessor& owner;
+    TextButton loadButton;
+    Label folderLabel, statusLabel;
+    ScopedPointer<FileChooser> chooser;
+};
+
+//==============================================================================
+SamplerProcessor::SamplerProcessor()
+    : InternalPlugin (InternalPluginFormat::samplerName, "Synth",
+                      BusesProperties().withOutput ("Output", AudioChannelSet::stereo()))
+{
+    addParameter (gain    = new AudioParameterFloat ("gain", "Gain", NormalisableRange<float> (-30.0f, 6.0f), 0.0f, "dB"));
+    addParameter (release = new AudioParameterFloat ("release", "Release", NormalisableRange<float> (0.01f, 5.0f), 0.3f, "s"));
+
+    for (int i = 0; i < numVoices; ++i)
+        voices.add (new Voice());
+
+    loader = new Loader (*this);
+}
+
+SamplerProcessor::~SamplerProcessor()
+{
+    loader = nullptr;
+    streamer = nullptr;
+    delete pendingInstrument.exchange (nullptr);
+    delete retiredInstrument.exchange (nullptr);
+}
+
+//==============================================================================
+void SamplerProcessor::loadSampleFolder (const File& f)
+{
+    loader->load (f);
+}
+
+File SamplerProcessor::getSampleFolder() const
+{
+    const ScopedLock sl (infoLock);
+    return folder;
+}
+
+int SamplerProcessor::getNumLoadedSamples() const
+{
+    const ScopedLock sl (infoLock);
+    return numLoadedSamples;
+}
+
+size_t SamplerProcessor::getResidentBytes() const
+{
+    const ScopedLock sl (infoLock);
+    return residentBytes;
+}
+
+void SamplerProcessor::writeState (XmlElement& xml) const
+{
+    xml.setAttribute ("folder", getSampleFolder().getFullPathName());
+}
+
+void SamplerProcessor::readState (const XmlElement& xml)
+{
+    auto path = xml.getStringAttribute ("folder");
+
+    if (File::isAbsolutePath (path))
+        loadSampleFolder (File (path));
+}
+
+//==============================================================================
+void SamplerProcessor::prepareToPlay (double sampleRate, int)
+{
+    streamer = nullptr;
+    stopAllVoices();
+
+    delete retiredInstrument.exchange (nullptr);
+
+    if (auto* next = pendingInstrument.exchange (nullptr))
+        instrument = next;
+
+    currentSampleRate = sampleRate;
+    lastGain = Decibels::decibelsToGain (gain->get(), -30.0f);
+    sustainPedalDown = false;
+    streamUnderruns = 0;
+
+    streamer = new Streamer (*this);
+}
+
+void SamplerProcessor::releaseResources()
+{
+    streamer = nullptr;
+    stopAllVoices();
+}
+
+void SamplerProcessor::takePendingInstrument()
+{
+    // the streamer hasn't let go of the last one yet
+    if (retiredInstrument.load() != nullptr)
+        return;
+
+    if (auto* next = pendingInstrument.exchange (nullptr))
+    {
+        stopAllVoices();
+        retiredInstrument.store (instrument.release());
+        instrument = next;
+    }
+}
+
+void SamplerProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer& midi)
+{
+    ScopedNoDenormals noDenormals;
+    buffer.clear();
+
+    takePendingInstrument();
+
+    if (instrument == nullptr || streamer == nullptr || buffer.getNumChannels() < 2)
+        return;
+
+    MidiBuffer::Iterator it (midi);
+    MidiMessage message;
+    int samplePosition, rendered = 0;
+
+    while (it.getNextEvent (message, samplePosition))
+    {
+        samplePosition = jlimit (rendered, buffer.getNumSamples(), samplePosition);
+        renderVoices (buffer, rendered, samplePosition - rendered);
+        rendered = samplePosition;
+
+        handleMidiEvent (message);
+    }
+
+    renderVoices (buffer, rendered, buffer.getNumSamples() - rendered);
+
+    auto newGain = Decibels::decibelsToGain (gain->get(), -30.0f);
+    buffer.applyGainRamp (0, buffer.getNumSamples(), lastGain, newGain);
+    lastGain = newGain;
+}
+
+//==============================================================================
+void SamplerProcessor::handleMidiEvent (const MidiMessage& m)
+{
+    if (m.isNoteOn())
+    {
+        startVoice (m.getNoteNumber(), m.getFloatVelocity());
+    }
+    else if (m.isNoteOff())
+    {
+        stopVoices (m.getNoteNumber());
+    }
+    else if (m.isSustainPedalOn())
+    {
+        sustainPedalDown = true;
+    }
+    else if (m.isSustainPedalOff())
+    {
+        sustainPedalDown = false;
+        auto step = (float) (1.0 / (release->get() * currentSampleRate));
+
+        for (auto* v : voices)
+            if (v->isPlaying() && ! v->keyDown)
+                v->beginRelease (step);
+    }
+    else if (m.isAllNotesOff() || m.isAllSoundOff())
+    {
+        stopAllVoices();
+    }
+}
+
+void SamplerProcessor::startVoice (int note, float velocity)
+{
+    auto* sample = instrument->keyMap[note];
+
+    if (sample == nullptr)
+        return;
+
+    // a free voice if there is one, otherwise the one that started longest ago
+    Voice* voice = nullptr;
+
+    for (auto* v : voices)
+    {
+        if (! v->isPlaying())
+        {
+            voice = v;
+            break;
+        }
+
+        if (voice == nullptr || (int32) (v->age - voice->age) < 0)
+            voice = v;
+    }
+
+    auto increment = std::pow (2.0, (note - sample->rootNote) / 12.0) * sample->sampleRate / currentSampleRate;
+    voice->start (*sample, note, velocity, increment, ++noteCounter);
+}
+
+void SamplerProcessor::stopVoices (int note)
+{
+    auto step = (float) (1.0 / (release->get() * currentSampleRate));
+
+    for (auto* v : voices)
+    {
+        if (v->isPlaying() && v->keyDown && v->note == note)
+        {
+            if (sustainPedalDown)
+                v->keyDown = false;
+            else
+                v->beginRelease (step);
+        }
+    }
+}
+
+void SamplerProcessor::stopAllVoices()
+{
+    for (auto* v : voices)
+        v->stop();
+}
+
+void SamplerProcessor::renderVoices (AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    if (numSamples <= 0)
+        return;
+
+    for (auto* v : voices)
+        if (v->isPlaying())
+            if (! v->render (buffer.getWritePointer (0, startSample), buffer.getWritePointer (1, startSample), numSamples))
+                ++streamUnderruns;
+}
+
+AudioProcessorEditor* SamplerProcessor::createEditor()
+{
+    return new Editor (*this);
+}
@@ -0,0 +1,129 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "InternalFilters.h"
+
+
+//==============================================================================
+/**
+    A sampler that plays a folder of WAV files straight from disk.
+
+    Each file is opened through a MemoryMappedAudioFormatReader, and only its
+    attack region is read into memory. When a note starts, the voice plays that
+    region while the streaming thread fills the voice's ring buffer with the rest
+    of the sample. The thread always serves the voice with the least audio
+    buffered ahead of it first.
+
+    A voice that reaches the end of its buffered audio plays silence for the
+    missing samples and counts an underrun, rather than waiting for the disk.
+
+    The files' root notes come from a note name or MIDI note number at the end of
+    each file name, e.g. "Piano C#3.wav" or "Piano 61.wav". Every key is mapped
+    to the nearest root.
+*/
+class SamplerProcessor  : public InternalPlugin
+{
+public:
+    SamplerProcessor();
+    ~SamplerProcessor();
+
+    //==============================================================================
+    /** Starts loading a folder of samples. The current ones keep playing until it's ready. */
+    void loadSampleFolder (const File&);
+    File getSampleFolder() const;
+
+    int getNumLoadedSamples() const;
+    size_t getResidentBytes() const;
+
+    /** How many times a voice has caught up with the streaming thread. */
+    int getNumStreamUnderruns() const noexcept              { return streamUnderruns.load(); }
+
+    //==============================================================================
+    void prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock) override;
+    void releaseResources() override;
+    void processBlock (AudioBuffer<float>&, MidiBuffer&) override;
+
+    bool acceptsMidi() const override                       { return true; }
+    bool hasEditor() const override                         { return true; }
+    AudioProcessorEditor* createEditor() override;
+
+    enum
+    {
+        numVoices       = 16,
+        attackFrames    = 16384,
+        ringFrames      = 32768,
+        chunkFrames     = 4096
+    };
+
+protected:
+    void writeState (XmlElement&) const override;
+    void readState (const XmlElement&) override;
+
+private:
+    //==============================================================================
+    struct Sample;
+    struct Instrument;
+    struct Voice;
+    struct Streamer;
+    struct Loader;
+    struct Editor;
+
+    AudioParameterFloat* gain;
+    AudioParameterFloat* release;
+
+    // the folder and a summary of what's in it, for the message thread
+    CriticalSection infoLock;
+    File folder;
+    int numLoadedSamples = 0;
+    size_t residentBytes = 0;
+
+    // the audio thread owns the current instrument and hands instruments back and forth
+    // with the loader and the streamer through these two slots
+    ScopedPointer<Instrument> instrument;
+    std::atomic<Instrument*> pendingInstrument { nullptr };
+    std::atomic<Instrument*> retiredInstrument { nullptr };
+
+    OwnedArray<Voice> voices;
+    uint32 noteCounter = 0;
+    bool sustainPedalDown = false;
+    double currentSampleRate = 44100.0;
+    float lastGain = 1.0f;
+    std::atomic<int> streamUnderruns { 0 };
+
+    ScopedPointer<Streamer> streamer;
+    ScopedPointer<Loader> loader;
+
+    void takePendingInstrument();
+    void handleMidiEvent (const MidiMessage&);
+    void startVoice (int note, float velocity);
+    void stopVoices (int note);
+    void stopAllVoices();
+    void renderVoices (AudioBuffer<float>&, int startSample, int numSamples);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SamplerProcessor)
+};
@@ -0,0 +1,276 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "SerialController.h"
+
+#if ! JUCE_WINDOWS
+ #include <errno.h>
+ #include <fcntl.h>
+ #include <poll.h>
+ #include <termios.h>
+ #include <unistd.h>
+#endif
+
+
+//==============================================================================
+bool ControllerMidiConverter::createMessage (const ControllerEvent& e, MidiMessage& result) noexcept
+{
+    if (e.isEncoder())
+    {
+        // the board counts in a byte that wraps, so the shortest way round is the movement
+        auto previous = lastEncoderValue;
+        lastEncoderValue = e.value & 0xff;
+
+        if (previous < 0)
+            return false;
+
+        auto movement = ((lastEncoderValue - previous + 128) & 0xff) - 128;
+        result = MidiMessage::controllerEvent (midiChannel, encoderController, jlimit (0, 127, 64 + movement));
+        return true;
+    }
+
+    if (e.getButtonIndex() >= 0)
+    {
+        result = MidiMessage::controllerEvent (midiChannel, firstButtonController + e.getButtonIndex(), e.value != 0 ? 127 : 0);
+        return true;
+    }
+
+    return false;
+}
+
+//==============================================================================
+bool ControllerEventQueue::push (const ControllerEvent& e) noexcept
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite (1, start1, size1, start2, size2);
+
+    if (size1 + size2 == 0)
+    {
+        ++numDropped;
+        return false;
+    }
+
+    events[size1 > 0 ? start1 : start2] = e;
+    fifo.finishedWrite (1);
+    return true;
+}
+
+bool ControllerEventQueue::pop (ControllerEvent& e) noexcept
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToRead (1, start1, size1, start2, size2);
+
+    if (size1 + size2 == 0)
+        return false;
+
+    e = events[size1 > 0 ? start1 : start2];
+    fifo.finishedRead (1);
+    return true;
+}
+
+//==============================================================================
+SerialController::SerialController()
+    : Thread ("Serial Controller")
+{
+}
+
+SerialController::~SerialController()
+{
+    stop();
+    cancelPendingUpdate();
+}
+
+Result SerialController::start (const String& devicePath)
+{
+   #if JUCE_WINDOWS
+    ignoreUnused (devicePath);
+    return Result::fail ("The controller board can only be read from a POSIX serial port");
+   #else
+    stop();
+    path = devicePath;
+
+    // high enough that a button press isn't kept waiting behind the UI
+    startThread (8);
+    return Result::ok();
+   #endif
+}
+
+void SerialController::stop()
+{
+    stopThread (2000);
+    connected = false;
+}
+
+//==============================================================================
+int SerialController::openPort() const
+{
+   #if JUCE_WINDOWS
+    return -1;
+   #else
+    auto fd = ::open (path.toRawUTF8(), O_RDONLY | O_NOCTTY | O_NONBLOCK);
+
+    if (fd < 0)
+        return -1;
+
+    termios settings;
+
+    if (tcgetattr (fd, &settings) != 0)
+    {
+        ::close (fd);
+        return -1;
+    }
+
+    // the sketch runs at 19200 baud, 8N1, and reads return straight away with whatever is there
+    cfmakeraw (&settings);
+    cfsetispeed (&settings, B19200);
+    cfsetospeed (&settings, B19200);
+    settings.c_cflag |= (CLOCAL | CREAD);
+    settings.c_cc[VMIN] = 0;
+    settings.c_cc[VTIME] = 0;
+
+    if (tcsetattr (fd, TCSANOW, &settings) != 0)
+    {
+        ::close (fd);
+        return -1;
+    }
+
+    tcflush (fd, TCIFLUSH);
+    return fd;
+   #endif
+}
+
+void SerialController::run()
+{
+   #if ! JUCE_WINDOWS
+    char buffer[256];
+    int fd = -1;
+    bool anyEvents = false;
+
+    auto queueEvent = [this, &anyEvents] (const ControllerEvent& e)
+    {
+        messageThreadQueue.push (e);
+        audioThreadQueue.push (e);
+        anyEvents = true;
+    };
+
+    while (! threadShouldExit())
+    {
+        if (fd < 0)
+        {
+            fd = openPort();
+
+            if (fd < 0)
+            {
+                wait (1000);
+                continue;
+            }
+
+            // a board that's been replugged starts counting again, so there's no movement to work out yet
+            parser.reset();
+            encoderRestarted = true;
+            connected = true;
+        }
+
+        pollfd request { fd, POLLIN, 0 };
+        auto numReady = ::poll (&request, 1, 100);
+
+        if (numReady == 0 || (numReady < 0 && errno == EINTR))
+            continue;
+
+        // whatever arrived before a hang-up is still read, so the last press isn't lost
+        auto hungUp = numReady < 0 || (request.revents & (POLLERR | POLLHUP | POLLNVAL)) != 0;
+        bool lost = false;
+        anyEvents = false;
+
+        while (numReady > 0)
+        {
+            auto numRead = ::read (fd, buffer, sizeof (buffer));
+
+            if (numRead > 0)
+            {
+                parser.feed (buffer, (int) numRead, Time::getMillisecondCounterHiRes() * 0.001, queueEvent);
+                continue;
+            }
+
+            // an unplugged board shows up as EIO, anything else just means there's nothing left
+            lost = numRead < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR;
+            break;
+        }
+
+        if (anyEvents)
+            triggerAsyncUpdate();
+
+        if (lost || hungUp)
+        {
+            ::close (fd);
+            fd = -1;
+            connected = false;
+        }
+    }
+
+    if (fd >= 0)
+        ::close (fd);
+
+    connected = false;
+   #endif
+}
+
+void SerialController::handleAsyncUpdate()
+{
+    ControllerEvent e;
+
+    while (messageThreadQueue.pop (e))
+        if (onEvent != nullptr)
+            onEvent (e);
+}
+
+void SerialController::injectEvent (const ControllerEvent& e) noexcept
+{
+    injectedQueue.push (e);
+}
+
+//==============================================================================
+void SerialController::addNextBlockOfMessages (MidiBuffer& midiMessages, int)
+{
+    if (encoderRestarted.exchange (false))
+        converter.resetEncoder();
+
+    converter.setMidiChannel (midiChannel.load());
+
+    // everything queued arrived before this block began, so it all goes at the start of it
+    ControllerEvent e;
+    MidiMessage m;
+
+    while (audioThreadQueue.pop (e))
+        if (converter.createMessage (e, m))
+            midiMessages.addEvent (m, 0);
+
+    while (injectedQueue.pop (e))
+        if (converter.createMessage (e, m))
+            midiMessages.addEvent (m, 0);
+}
@@ -0,0 +1,257 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+
+#pragma once
+
+#include "FilterGraph.h"
+#include <atomic>
+
+
+//==============================================================================
+/**
+    One message from the controller board: a letter naming the control and a value.
+
+    The board's sketch (MELD_Arduino_Serial_Send_MFW_1.0) sends the encoder's
+    position as X, and its push button and the five Cherry buttons as A to F.
+    B, E and F latch, so the board sends their new toggle state on every press;
+    A, C and D send 1 when pressed and 0 when released.
+*/
+struct ControllerEvent
+{
+    char control = 0;
+    int value = 0;
+
+    /** When the bytes arrived, in seconds on Time::getMillisecondCounterHiRes(). */
+    double time = 0;
+
+    bool isEncoder() const noexcept                 { return control == 'X'; }
+
+    /** 0 for the encoder's button, 1 to 5 for the Cherry buttons, or -1 for the encoder. */
+    int getButtonIndex() const noexcept             { return control >= 'A' && control <= 'F' ? control - 'A' : -1; }
+
+    /** True if this is a button going down, rather than one being released. */
+    bool isPress() const noexcept
+    {
+        return control == 'B' || control == 'E' || control == 'F' || (getButtonIndex() >= 0 && value != 0);
+    }
+
+    /** The controller number it's captured under: the buttons, then the encoder. */
+    int getControllerIndex() const noexcept         { return isEncoder() ? 6 : getButtonIndex(); }
+
+    /** Rebuilds an event from what getControllerIndex() and its value were, as a capture stores them. */
+    static ControllerEvent fromControllerIndex (int index, int value) noexcept
+    {
+        ControllerEvent e;
+        e.control = index == 6 ? 'X' : (char) ('A' + jlimit (0, 5, index));
+        e.value = value;
+        e.time = Time::getMillisecondCounterHiRes() * 0.001;
+        return e;
+    }
+};
+
+//==============================================================================
+/**
+    Turns the board's byte stream into events, a byte at a time, without allocating.
+
+    Each message is a capital letter, some digits and a ']', usually followed by a
+    line break. Anything that doesn't fit is dropped up to the next letter, so it
+    picks up again cleanly after noise or joining the stream part-way through.
+*/
+class ControllerParser
+{
+public:
+    ControllerParser() noexcept {}
+
+    /** Parses the bytes, calling back with each complete event. */
+    template <typename Callback>
+    void feed (const char* data, int numBytes, double time, Callback&& callback) noexcept
+    {
+        for (int i = 0; i < numBytes; ++i)
+        {
+            auto c = data[i];
+
+            if (c >= 'A' && c <= 'Z')
+            {
+                control = c;
+                value = 0;
+                numDigits = 0;
+            }
+            else if (c >= '0' && c <= '9' && control != 0 && numDigits < maxDigits)
+            {
+                value = value * 10 + (c - '0');
+                ++numDigits;
+            }
+            else if (c == ']' && control != 0 && numDigits > 0)
+            {
+                ControllerEvent e;
+                e.control = control;
+                e.value = value;
+                e.time = time;
+                callback (e);
+
+                control = 0;
+            }
+            else if (c != '\r' && c != '\n')
+            {
+                control = 0;
+            }
+        }
+    }
+
+    void reset() noexcept                           { control = 0; }
+
+private:
+    enum { maxDigits = 5 };
+
+    char control = 0;
+    int value = 0, numDigits = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (ControllerParser)
+};
+
+//==============================================================================
+/**
+    Turns controller events into the MIDI controller messages the graph sees. The
+    buttons are controllers 102 to 107, on 127 and off 0, and the encoder is 108,
+    sent as 64 plus its movement since the last position it was given.
+
+    The live controller and MeldRender's capture replay both go through this, so
+    a replayed move reaches the graph as the same message it did live.
+*/
+class ControllerMidiConverter
+{
+public:
+    ControllerMidiConverter() noexcept {}
+
+    /** Creates the message for an event. The encoder's first position only sets where
+        its next movement is counted from, so there's no message for that.
+    */
+    bool createMessage (const ControllerEvent&, MidiMessage& result) noexcept;
+
+    /** Forgets where the encoder was, e.g. when the board has been replugged. */
+    void resetEncoder() noexcept                    { lastEncoderValue = -1; }
+
+    void setMidiChannel (int channel) noexcept      { midiChannel = jlimit (1, 16, channel); }
+
+    enum
+    {
+        firstButtonController = 102,
+        encoderController = 108
+    };
+
+private:
+    int midiChannel = 16, lastEncoderValue = -1;
+
+    JUCE_DECLARE_NON_COPYABLE (ControllerMidiConverter)
+};
+
+//==============================================================================
+/**
+    A fixed-size queue of events from one thread to one other, which never locks or
+    allocates. When it's full, new events are dropped and counted.
+*/
+class ControllerEventQueue
+{
+public:
+    ControllerEventQueue() {}
+
+    bool push (const ControllerEvent&) noexcept;
+    bool pop (ControllerEvent&) noexcept;
+    void reset() noexcept                           { fifo.reset(); }
+
+    int getNumDropped() const noexcept              { return numDropped.load(); }
+
+    enum { queueSize = 256 };
+
+private:
+    AbstractFifo fifo { queueSize };
+    ControllerEvent events[queueSize];
+    std::atomic<int> numDropped { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE (ControllerEventQueue)
+};
+
+//==============================================================================
+/**
+    Reads the controller board's serial port and hands its events to the message
+    thread and the audio thread.
+
+    A thread of its own opens the port raw at 19200 baud with termios, waits on it
+    with poll(), and reads whatever is there without blocking. Each parsed event is
+    pushed into two queues: the message thread drains one and passes the events to
+    onEvent, and the audio thread drains the other, when this is the graph's MIDI
+    source, and turns them into MIDI controller messages at the start of the next
+    block with a ControllerMidiConverter. If the board is unplugged, the thread keeps
+    trying to reopen the port.
+*/
+class SerialController  : public FilterGraph::MidiSource,
+                          private Thread,
+                          private AsyncUpdater
+{
+public:
+    SerialController();
+    ~SerialController();
+
+    /** Starts reading from a device such as /dev/ttyACM0. It needn't be plugged in yet. */
+    Result start (const String& devicePath);
+    void stop();
+
+    bool isConnected() const noexcept               { return connected.load(); }
+
+    /** Called on the message thread with each event, in order. */
+    std::function<void (const ControllerEvent&)> onEvent;
+
+    /** The MIDI channel the controller messages go out on. */
+    void setMidiChannel (int channel) noexcept      { midiChannel = jlimit (1, 16, channel); }
+
+    /** Sends an event to the graph as if the board had, without passing it to onEvent.
+        Call it from the message thread, e.g. to replay a captured move.
+    */
+    void injectEvent (const ControllerEvent&) noexcept;
+
+    //==============================================================================
+    void addNextBlockOfMessages (MidiBuffer&, int numSamples) override;
+
+private:
+    String path;
+    std::atomic<bool> connected { false }, encoderRestarted { true };
+    std::atomic<int> midiChannel { 16 };
+
+    ControllerParser parser;
+
+    // each queue has one writer: the serial thread for the first two, the message thread for the last
+    ControllerEventQueue messageThreadQueue, audioThreadQueue, injectedQueue;
+
+    // only touched by the audio thread
+    ControllerMidiConverter converter;
+
+    void run() override;
+    void handleAsyncUpdate() override;
+    int openPort() const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SerialController)
+};
@@ -0,0 +1,154 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "SpectrumAnalyser.h"
+
+
+//==============================================================================
+SpectrumAnalyser::SpectrumAnalyser()  : Thread ("Spectrum analyser")
+{
+    history.calloc ((size_t) fftSize);
+    fftData.calloc ((size_t) fftSize * 2);
+    smoothed.calloc ((size_t) numBins);
+    FloatVectorOperations::fill (smoothed, -100.0f, numBins);
+
+    startThread (2);
+}
+
+SpectrumAnalyser::~SpectrumAnalyser()
+{
+    stopThread (4000);
+}
+
+//==============================================================================
+void SpectrumAnalyser::push (const float* left, const float* right, int numSamples) noexcept
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite (numSamples, start1, size1, start2, size2);
+
+    if (size1 + size2 < numSamples)
+        return;
+
+    fifoBuffer.copyFrom (0, start1, left, size1);
+    fifoBuffer.copyFrom (1, start1, right, size1);
+
+    if (size2 > 0)
+    {
+        fifoBuffer.copyFrom (0, start2, left + size1, size2);
+        fifoBuffer.copyFrom (1, start2, right + size1, size2);
+    }
+
+    fifo.finishedWrite (size1 + size2);
+}
+
+const SpectrumAnalyser::Frame* SpectrumAnalyser::getNewFrame() noexcept
+{
+    if ((middleIndex.load (std::memory_order_acquire) & newFrameFlag) == 0)
+        return nullptr;
+
+    frontIndex = middleIndex.exchange (frontIndex, std::memory_order_acq_rel) & ~newFrameFlag;
+    return frames + frontIndex;
+}
+
+//==============================================================================
+void SpectrumAnalyser::drainFifo()
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToRead (fifo.getNumReady(), start1, size1, start2, size2);
+
+    auto* left = fifoBuffer.getReadPointer (0);
+    auto* right = fifoBuffer.getReadPointer (1);
+
+    for (int i = 0; i < size1 + size2; ++i)
+    {
+        auto index = i < size1 ? start1 + i : start2 + i - size1;
+        history[historyPos] = 0.5f * (left[index] + right[index]);
+        historyPos = (historyPos + 1) % fftSize;
+    }
+
+    fifo.finishedRead (size1 + size2);
+}
+
+void SpectrumAnalyser::analyse (Frame& frame)
+{
+    // unwrap the history so the oldest sample comes first
+    auto tail = fftSize - historyPos;
+    FloatVectorOperations::copy (fftData, history + historyPos, tail);
+    FloatVectorOperations::copy (fftData + tail, history, historyPos);
+
+    FloatVectorOperations::copy (frame.scope, fftData + fftSize - scopeSize, scopeSize);
+
+    window.multiplyWithWindowingTable (fftData, (size_t) fftSize);
+    fft.performFrequencyOnlyForwardTransform (fftData);
+
+    // a full-scale sine through a Hann window peaks at fftSize / 4
+    const float scale = 4.0f / fftSize;
+
+    for (int i = 0; i < numBins; ++i)
+    {
+        auto level = Decibels::gainToDecibels (fftData[i] * scale, -100.0f);
+
+        // rises straight away, falls back gradually
+        smoothed[i] = level > smoothed[i] ? level : smoothed[i] + 0.2f * (level - smoothed[i]);
+        frame.spectrum[i] = smoothed[i];
+    }
+
+    frame.sampleRate = sampleRate.load();
+    frame.source = lastSource;
+}
+
+void SpectrumAnalyser::run()
+{
+    while (! threadShouldExit())
+    {
+        auto currentSource = getSource();
+
+        if (currentSource != lastSource)
+        {
+            // nothing from the old source should bleed into the new one
+            drainFifo();
+            lastSource = currentSource;
+            historyPos = 0;
+            FloatVectorOperations::clear (history, fftSize);
+            FloatVectorOperations::fill (smoothed, -100.0f, numBins);
+        }
+
+        if (fifo.getNumReady() > 0)
+        {
+            drainFifo();
+
+            if (lastSource >= 0)
+            {
+                analyse (frames[backIndex]);
+                backIndex = middleIndex.exchange (backIndex | newFrameFlag, std::memory_order_acq_rel) & ~newFrameFlag;
+            }
+        }
+
+        wait (1000 / maxFrameRate);
+    }
+}
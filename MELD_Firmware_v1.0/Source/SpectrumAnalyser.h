@@ -0,0 +1,106 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+
+#pragma once
+
+#include <atomic>
+
+
+//==============================================================================
+/**
+    A spectrum and scope for one stereo source at a time.
+
+    The audio thread does nothing but copy its samples into a FIFO. A background
+    thread drains it, runs a windowed FFT with some smoothing, and publishes at
+    most maxFrameRate frames a second through a triple buffer, so the UI always
+    finds a complete frame and neither side ever waits for the other.
+*/
+class SpectrumAnalyser  : private Thread
+{
+public:
+    SpectrumAnalyser();
+    ~SpectrumAnalyser();
+
+    enum
+    {
+        fftOrder        = 11,
+        fftSize         = 1 << fftOrder,
+        numBins         = fftSize / 2,
+        scopeSize       = 512,
+        fifoSize        = 1 << 15,
+        maxFrameRate    = 30
+    };
+
+    struct Frame
+    {
+        float spectrum[numBins];    // in decibels, smoothed
+        float scope[scopeSize];     // the latest samples, mixed to mono
+        double sampleRate = 0;
+        int source = -1;
+    };
+
+    //==============================================================================
+    /** Chooses what the tap feeding this should pass on: an index into its meters, or -1 for nothing. */
+    void setSource (int newSource) noexcept         { source = newSource; }
+    int getSource() const noexcept                  { return source.load (std::memory_order_relaxed); }
+
+    void setSampleRate (double newRate) noexcept    { sampleRate = newRate; }
+
+    /** Called on the audio thread. If the FIFO is full the block is dropped. */
+    void push (const float* left, const float* right, int numSamples) noexcept;
+
+    /** Returns the newest frame if one has been published since the last call, or
+        nullptr. Only call this from one thread; the frame stays valid until the next call.
+    */
+    const Frame* getNewFrame() noexcept;
+
+private:
+    //==============================================================================
+    std::atomic<int> source { -1 };
+    std::atomic<double> sampleRate { 44100.0 };
+
+    AbstractFifo fifo { fifoSize };
+    AudioBuffer<float> fifoBuffer { 2, fifoSize };
+
+    // only touched by the analysis thread
+    dsp::FFT fft { fftOrder };
+    dsp::WindowingFunction<float> window { (size_t) fftSize, dsp::WindowingFunction<float>::hann, false };
+    HeapBlock<float> history, fftData, smoothed;
+    int historyPos = 0, lastSource = -1;
+
+    // the frame being written, the one waiting to be picked up, and the one being read
+    enum { newFrameFlag = 4 };
+    Frame frames[3];
+    int backIndex = 0, frontIndex = 2;
+    std::atomic<int> middleIndex { 1 };
+
+    void drainFifo();
+    void analyse (Frame&);
+    void run() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectrumAnalyser)
+};
@@ -0,0 +1,45 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+
+//==============================================================================
+/**
+    The nearest-rank percentile of some timings, for a fraction from 0 to 1, or 0
+    if there aren't any.
+
+    The renderer and the benchmarks all report through this, so a p99 from one
+    tool means the same as a p99 from another.
+*/
+inline double percentile (Array<double> values, double fraction)
+{
+    if (values.isEmpty())
+        return 0;
+
+    values.sort();
+    return values[jlimit (0, values.size() - 1, (int) std::ceil (fraction * values.size()) - 1)];
+}
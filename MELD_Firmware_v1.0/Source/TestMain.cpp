@@ -0,0 +1,57 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "ToolSupport.h"
+#include <iostream>
+
+/*
+    Runs the host's unit tests:
+
+        MeldTests
+
+    The tests live next to the code they cover, in the *Tests.cpp files, and register
+    themselves by being constructed statically. The exit code is 1 if anything fails.
+*/
+
+//==============================================================================
+int main (int, char*[])
+{
+    ScopedJuceInitialiser_GUI juceInitialiser;
+    ToolEnvironment environment ("MELD Tests");
+
+    UnitTestRunner runner;
+    runner.setAssertOnFailure (false);
+    runner.runAllTests();
+
+    int numFailures = 0;
+
+    for (int i = 0; i < runner.getNumResults(); ++i)
+        numFailures += runner.getResult (i)->failures;
+
+    std::cout << (numFailures == 0 ? "All tests passed" : String (numFailures) + " failure(s)") << std::endl;
+    return numFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,85 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "MainHostWindow.h"
+#include "ToolSupport.h"
+
+
+//==============================================================================
+static ApplicationCommandManager* commandManager = nullptr;
+static ApplicationProperties* appProperties = nullptr;
+
+ApplicationCommandManager& getCommandManager()
+{
+    jassert (commandManager != nullptr); // the tool needs a ToolEnvironment before it makes a graph
+    return *commandManager;
+}
+
+ApplicationProperties& getAppProperties()
+{
+    jassert (appProperties != nullptr);
+    return *appProperties;
+}
+
+//==============================================================================
+ToolEnvironment::ToolEnvironment (const String& applicationName)
+{
+    PropertiesFile::Options options;
+    options.applicationName     = applicationName;
+    options.filenameSuffix      = "settings";
+    options.osxLibrarySubFolder = "Preferences";
+
+    properties.setStorageParameters (options);
+
+    appProperties = &properties;
+    commandManager = &commands;
+}
+
+ToolEnvironment::~ToolEnvironment()
+{
+    appProperties = nullptr;
+    commandManager = nullptr;
+}
+
+//==============================================================================
+void removeOpenWindows (XmlElement& filterGraphXml)
+{
+    forEachXmlChildElementWithTagName (filterGraphXml, e, "FILTER")
+        for (int i = 0; i < (int) PluginWindow::Type::numTypes; ++i)
+            e->removeAttribute (PluginWindow::getOpenProp ((PluginWindow::Type) i));
+}
+
+Array<int64> parseList (const String& text)
+{
+    Array<int64> values;
+
+    for (auto& s : StringArray::fromTokens (text, ",", {}))
+        if (s.trim().isNotEmpty())
+            values.add (s.trim().getLargeIntValue());
+
+    return values;
+}
@@ -0,0 +1,68 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+
+//==============================================================================
+/**
+    What the host's code expects the app to provide, for the command-line tools
+    that are built from the same sources without HostStartup.cpp.
+
+    The graph reaches for getCommandManager() and getAppProperties(), so a tool
+    creates one of these in main(), after initialising JUCE, and keeps it until
+    every graph has gone.
+*/
+class ToolEnvironment
+{
+public:
+    ToolEnvironment (const String& applicationName);
+    ~ToolEnvironment();
+
+private:
+    ApplicationProperties properties;
+    ApplicationCommandManager commands;
+
+    JUCE_DECLARE_NON_COPYABLE (ToolEnvironment)
+};
+
+//==============================================================================
+/** Strips the attributes that would make a restored graph reopen its plugin
+    windows, as a tool has nowhere to show them.
+*/
+void removeOpenWindows (XmlElement& filterGraphXml);
+
+/** Parses a comma-separated list of numbers, as the tools take on their command lines. */
+Array<int64> parseList (const String&);
+
+//==============================================================================
+/** Throws away everything that's logged, so the graph and the plugins don't swamp
+    a tool's results.
+*/
+struct QuietLogger  : public Logger
+{
+    void logMessage (const String&) override {}
+};
@@ -0,0 +1,327 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "VirtualAudioDevice.h"
+
+
+//==============================================================================
+class VirtualAudioIODeviceType::Device  : public AudioIODevice,
+                                          private Thread
+{
+public:
+    Device (Mode m, double jitterMs)
+        : AudioIODevice (getDeviceName (m), typeName),
+          Thread ("Virtual audio device"),
+          mode (m), maxJitterMs (jitterMs)
+    {
+    }
+
+    ~Device()
+    {
+        close();
+    }
+
+    enum { numChannels = 8 };
+
+    Mode getMode() const noexcept               { return mode; }
+
+    //==============================================================================
+    StringArray getOutputChannelNames() override    { return getChannelNames ("Output"); }
+    StringArray getInputChannelNames() override     { return getChannelNames ("Input"); }
+
+    Array<double> getAvailableSampleRates() override
+    {
+        return { 44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0 };
+    }
+
+    Array<int> getAvailableBufferSizes() override
+    {
+        return { 16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 2048, 4096 };
+    }
+
+    int getDefaultBufferSize() override         { return 256; }
+
+    String open (const BigInteger& inputChannels, const BigInteger& outputChannels,
+                 double newSampleRate, int newBufferSize) override
+    {
+        close();
+
+        sampleRate = newSampleRate > 0 ? newSampleRate : 44100.0;
+        bufferSize = newBufferSize > 0 ? newBufferSize : getDefaultBufferSize();
+
+        activeInputs = inputChannels;
+        activeInputs.setRange (numChannels, jmax (0, activeInputs.getHighestBit() + 1 - numChannels), false);
+        activeOutputs = outputChannels;
+        activeOutputs.setRange (numChannels, jmax (0, activeOutputs.getHighestBit() + 1 - numChannels), false);
+
+        // like a real device, only the active channels are passed to the callback
+        numActiveInputs = activeInputs.countNumberOfSetBits();
+        numActiveOutputs = activeOutputs.countNumberOfSetBits();
+
+        inputBuffer.setSize (jmax (1, numActiveInputs), bufferSize);
+        outputBuffer.setSize (jmax (1, numActiveOutputs), bufferSize);
+        inputBuffer.clear();
+
+        inputPointers.calloc ((size_t) numActiveInputs + 1);
+        outputPointers.calloc ((size_t) numActiveOutputs + 1);
+
+        for (int i = 0; i < numActiveInputs; ++i)
+            inputPointers[i] = inputBuffer.getReadPointer (i);
+
+        for (int i = 0; i < numActiveOutputs; ++i)
+            outputPointers[i] = outputBuffer.getWritePointer (i);
+
+        xruns = 0;
+        isDeviceOpen = true;
+        return {};
+    }
+
+    void close() override
+    {
+        stop();
+        isDeviceOpen = false;
+    }
+
+    bool isOpen() override                      { return isDeviceOpen; }
+
+    void start (AudioIODeviceCallback* newCallback) override
+    {
+        if (! isDeviceOpen || newCallback == nullptr || newCallback == callback)
+            return;
+
+        stop();
+        newCallback->audioDeviceAboutToStart (this);
+
+        {
+            const ScopedLock sl (callbackLock);
+            callback = newCallback;
+        }
+
+        startThread (mode == asFastAsPossible ? 5 : 9);
+    }
+
+    void stop() override
+    {
+        stopThread (2000);
+
+        AudioIODeviceCallback* oldCallback;
+
+        {
+            const ScopedLock sl (callbackLock);
+            oldCallback = callback;
+            callback = nullptr;
+        }
+
+        if (oldCallback != nullptr)
+            oldCallback->audioDeviceStopped();
+    }
+
+    bool isPlaying() override                   { return callback != nullptr; }
+    String getLastError() override              { return {}; }
+
+    int getCurrentBufferSizeSamples() override  { return bufferSize; }
+    double getCurrentSampleRate() override      { return sampleRate; }
+    int getCurrentBitDepth() override           { return 32; }
+
+    BigInteger getActiveOutputChannels() const override     { return activeOutputs; }
+    BigInteger getActiveInputChannels() const override      { return activeInputs; }
+
+    int getOutputLatencyInSamples() override    { return 0; }
+    int getInputLatencyInSamples() override     { return 0; }
+
+    int getXRunCount() const noexcept override  { return xruns.get(); }
+
+private:
+    //==============================================================================
+    const Mode mode;
+    const double maxJitterMs;
+
+    double sampleRate = 44100.0;
+    int bufferSize = 256;
+    bool isDeviceOpen = false;
+
+    BigInteger activeInputs, activeOutputs;
+    int numActiveInputs = 0, numActiveOutputs = 0;
+    AudioBuffer<float> inputBuffer, outputBuffer;
+    HeapBlock<const float*> inputPointers;
+    HeapBlock<float*> outputPointers;
+
+    CriticalSection callbackLock;
+    AudioIODeviceCallback* callback = nullptr;
+    Atomic<int> xruns;
+    Random random;
+
+    static StringArray getChannelNames (const String& prefix)
+    {
+        StringArray names;
+
+        for (int i = 0; i < numChannels; ++i)
+            names.add (prefix + " " + String (i + 1));
+
+        return names;
+    }
+
+    //==============================================================================
+    void run() override
+    {
+        auto ticksPerBlock = Time::secondsToHighResolutionTicks (bufferSize / sampleRate);
+        auto nextBlock = Time::getHighResolutionTicks();
+
+        while (! threadShouldExit())
+        {
+            if (mode != asFastAsPossible)
+            {
+                auto due = nextBlock;
+
+                if (mode == timedWithJitter)
+                    due += Time::secondsToHighResolutionTicks (random.nextDouble() * maxJitterMs * 0.001);
+
+                waitUntil (due);
+
+                if (threadShouldExit())
+                    break;
+
+                auto now = Time::getHighResolutionTicks();
+
+                // a whole block late: count it and start the schedule again from here
+                if (now - due > ticksPerBlock)
+                {
+                    ++xruns;
+                    nextBlock = now;
+                }
+
+                nextBlock += ticksPerBlock;
+            }
+
+            {
+                const ScopedLock sl (callbackLock);
+
+                if (callback != nullptr)
+                {
+                    outputBuffer.clear();
+                    callback->audioDeviceIOCallback (inputPointers, numActiveInputs,
+                                                     outputPointers, numActiveOutputs, bufferSize);
+
+                    // what went out of the last channel comes back in on the next block
+                    if (mode == loopback && activeInputs[numChannels - 1] && activeOutputs[numChannels - 1])
+                        inputBuffer.copyFrom (numActiveInputs - 1, 0, outputBuffer, numActiveOutputs - 1, 0, bufferSize);
+                }
+            }
+
+            // give the message thread a chance at the lock when adding or removing callbacks
+            if (mode == asFastAsPossible)
+                Thread::yield();
+        }
+    }
+
+    void waitUntil (int64 ticks)
+    {
+        for (;;)
+        {
+            auto msLeft = Time::highResolutionTicksToSeconds (ticks - Time::getHighResolutionTicks()) * 1000.0;
+
+            if (msLeft <= 0 || threadShouldExit())
+                return;
+
+            // sleep for most of the wait, then yield through the last millisecond or two,
+            // since the scheduler's wake-up is only good to about a millisecond
+            if (msLeft > 2.0)
+                wait ((int) msLeft - 1);
+            else
+                Thread::yield();
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Device)
+};
+
+//==============================================================================
+const char* const VirtualAudioIODeviceType::typeName = "Virtual";
+
+VirtualAudioIODeviceType::VirtualAudioIODeviceType (double jitterMs)
+    : AudioIODeviceType (typeName), maxJitterMs (jmax (0.0, jitterMs))
+{
+}
+
+VirtualAudioIODeviceType::~VirtualAudioIODeviceType() {}
+
+const char* VirtualAudioIODeviceType::getDeviceName (Mode mode)
+{
+    switch (mode)
+    {
+        case timed:             return "Timed";
+        case timedWithJitter:   return "Timed with jitter";
+        case asFastAsPossible:  return "As fast as possible";
+        case loopback:          return "Loopback";
+        case numModes:
+        default:                break;
+    }
+
+    return "";
+}
+
+void VirtualAudioIODeviceType::scanForDevices() {}
+
+StringArray VirtualAudioIODeviceType::getDeviceNames (bool) const
+{
+    StringArray names;
+
+    for (int i = 0; i < numModes; ++i)
+        names.add (getDeviceName ((Mode) i));
+
+    return names;
+}
+
+int VirtualAudioIODeviceType::getDefaultDeviceIndex (bool) const
+{
+    return timed;
+}
+
+int VirtualAudioIODeviceType::getIndexOfDevice (AudioIODevice* device, bool) const
+{
+    if (auto* d = dynamic_cast<Device*> (device))
+        return (int) d->getMode();
+
+    return -1;
+}
+
+bool VirtualAudioIODeviceType::hasSeparateInputsAndOutputs() const
+{
+    return false;
+}
+
+AudioIODevice* VirtualAudioIODeviceType::createDevice (const String& outputDeviceName, const String& inputDeviceName)
+{
+    auto name = outputDeviceName.isNotEmpty() ? outputDeviceName : inputDeviceName;
+    auto index = getDeviceNames (false).indexOf (name);
+
+    if (index < 0)
+        return nullptr;
+
+    return new Device ((Mode) index, maxJitterMs);
+}
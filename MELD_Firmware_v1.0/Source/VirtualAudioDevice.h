@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2017 - ROLI Ltd.
+
+   JUCE is an open source library subject to commercial or open-source
+   licensing.
+
+   By using JUCE, you agree to the terms of both the JUCE 5 End-User License
+   Agreement and JUCE 5 Privacy Policy (both updated and effective as of the
+   27th April 2017).
+
+   End User License Agreement: www.juce.com/juce-5-licence
+   Privacy Policy: www.juce.com/juce-5-privacy-policy
+
+   Or: You may also use this code under the terms of the GPL v3 (see
+   www.gnu.org/licenses).
+
+   JUCE IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+   EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+   DISCLAIMED.
+
+  ==============================================================================
+*/
+
+
+#pragma once
+
+
+//==============================================================================
+/**
+    An audio device type that needs no hardware.
+
+    Its devices run the audio callback from a thread of their own, at whatever
+    sample rate and block size the device manager opens them with, so the whole
+    host can be soak-tested or profiled on a machine without a sound card. Inputs
+    are silent and outputs are discarded.
+
+    There are four devices:
+     - "Timed" calls back once per block period, keeping to the ideal schedule
+       rather than drifting with each late wake-up.
+     - "Timed with jitter" does the same, but delays each callback by a random
+       amount up to the jitter set on the type.
+     - "As fast as possible" calls back in a tight loop, for throughput tests.
+     - "Loopback" is timed too, but its last output comes back in on its last
+       input a block later, like a cable between them, so latency measurements
+       have something to find. It's kept apart so the others' inputs stay silent.
+
+    A timed callback that starts more than a block late counts as an xrun, and the
+    schedule is restarted from there rather than trying to catch up.
+*/
+class VirtualAudioIODeviceType  : public AudioIODeviceType
+{
+public:
+    VirtualAudioIODeviceType (double maxJitterMs = 2.0);
+    ~VirtualAudioIODeviceType();
+
+    static const char* const typeName;
+
+    enum Mode
+    {
+        timed = 0,
+        timedWithJitter,
+        asFastAsPossible,
+        loopback,
+        numModes
+    };
+
+    static const char* getDeviceName (Mode);
+
+    //==============================================================================
+    void scanForDevices() override;
+    StringArray getDeviceNames (bool wantInputNames) const override;
+    int getDefaultDeviceIndex (bool forInput) const override;
+    int getIndexOfDevice (AudioIODevice*, bool asInput) const override;
+    bool hasSeparateInputsAndOutputs() const override;
+    AudioIODevice* createDevice (const String& outputDeviceName, const String& inputDeviceName) override;
+
+private:
+    class Device;
+
+    double maxJitterMs;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (VirtualAudioIODeviceType)
+};